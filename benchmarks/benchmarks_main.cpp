@@ -0,0 +1,2205 @@
+#include "atomic_delegate.hpp"
+#include "coalescing_dispatcher.hpp"
+#include "concurrent_multicast_delegate.hpp"
+#include "delegate.hpp"
+#include "delegate_coroutine.hpp"
+#include "delegate_pipeline.hpp"
+#include "delegate_queue.hpp"
+#include "delegate_ref.hpp"
+#include "delegate_table.hpp"
+#include "delegate_vector.hpp"
+#include "event_reactor.hpp"
+#include "inplace_delegate.hpp"
+#include "memoized_delegate.hpp"
+#include "multicast_delegate.hpp"
+#include "simple_heap_delegate.hpp"
+#include "task_scheduler.hpp"
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+// Allocation accounting. Counters are thread local so that the hooks stay cheap and the numbers
+// reported for a measurement only cover the thread running it.
+namespace
+{
+thread_local std::uint64_t t_allocCount = 0;
+thread_local std::uint64_t t_allocBytes = 0;
+
+void* CountedAlloc(std::size_t size)
+{
+    ++t_allocCount;
+    t_allocBytes += size;
+
+    if (void* ptr = std::malloc(size != 0 ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* CountedAlignedAlloc(std::size_t size, std::align_val_t align)
+{
+    ++t_allocCount;
+    t_allocBytes += size;
+
+    const auto alignment = static_cast<std::size_t>(align);
+    if (void* ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return CountedAlloc(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return CountedAlloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    return CountedAlignedAlloc(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return CountedAlignedAlloc(size, align);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE
+#endif
+
+namespace
+{
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// Hides the pointee from the optimizer so that calls through it can not be devirtualized or inlined.
+template<typename T>
+inline T* Launder(T* ptr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+r"(ptr));
+#endif
+    return ptr;
+}
+
+struct AllocScope
+{
+    AllocScope()
+        : count(t_allocCount)
+        , bytes(t_allocBytes)
+    {
+    }
+
+    std::uint64_t Count() const
+    {
+        return t_allocCount - count;
+    }
+
+    std::uint64_t Bytes() const
+    {
+        return t_allocBytes - bytes;
+    }
+
+    std::uint64_t count;
+    std::uint64_t bytes;
+};
+
+class Stopwatch
+{
+public:
+    Stopwatch()
+        : m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    double ElapsedNs() const
+    {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+struct Config
+{
+    std::size_t count = 1 << 16;
+    std::size_t hotIterations = 1 << 24;
+};
+
+void PrintHeader()
+{
+    std::printf("%-24s %-14s %-6s %-12s %10s %12s %14s\n", "impl", "shape", "bind", "op", "ns/op", "allocs/op", "bytes/delegate");
+}
+
+void PrintRow(const char* impl, const char* shape, const char* bind, const char* op, double nsPerOp, double allocsPerOp,
+              double bytesPerDelegate)
+{
+    std::printf("%-24s %-14s %-6s %-12s %10.2f %12.3f %14.1f\n", impl, shape, bind, op, nsPerOp, allocsPerOp, bytesPerDelegate);
+}
+
+// Bound payload that does not fit into the default DelegateStorageStackSize.
+struct Blob
+{
+    static constexpr std::size_t kSize = 48;
+    int data[kSize / sizeof(int)];
+};
+
+constexpr int kSmallBind = 3;
+
+Blob MakeBlob()
+{
+    Blob blob;
+    std::iota(std::begin(blob.data), std::end(blob.data), 1);
+    return blob;
+}
+
+int global_small(int x, int b)
+{
+    return x + b;
+}
+
+int global_large(int x, const Blob& b)
+{
+    return x + b.data[0];
+}
+
+class Target
+{
+public:
+    int member_small(int x, int b)
+    {
+        return value + x + b;
+    }
+
+    int member_large(int x, const Blob& b)
+    {
+        return value + x + b.data[0];
+    }
+
+    int member_small_const(int x, int b) const
+    {
+        return value + x + b;
+    }
+
+    int member_large_const(int x, const Blob& b) const
+    {
+        return value + x + b.data[0];
+    }
+
+    int value = 1;
+};
+
+Target g_target;
+
+template<typename TDelegate, typename = void>
+struct HasHeapSize : std::false_type
+{};
+
+template<typename TDelegate>
+struct HasHeapSize<TDelegate, std::void_t<decltype(std::declval<const TDelegate&>().GetHeapSize())>> : std::true_type
+{};
+
+// Library delegates report their own heap footprint, which also covers blocks served by a pool without
+// reaching operator new. Other types are measured through the allocation counters.
+template<typename TDelegate>
+double GetBytesPerDelegate(const TDelegate& delegate, std::uint64_t allocatedBytes, std::size_t count)
+{
+    if constexpr (HasHeapSize<TDelegate>::value)
+    {
+        return static_cast<double>(sizeof(TDelegate) + delegate.GetHeapSize());
+    }
+    else
+    {
+        return sizeof(TDelegate) + static_cast<double>(allocatedBytes) / count;
+    }
+}
+
+template<typename TDelegate, typename TFactory>
+void RunSuite(const Config& config, const char* impl, const char* shape, const char* bind, TFactory&& factory)
+{
+    double bytesPerDelegate = 0.0;
+
+    std::vector<TDelegate> delegates;
+    delegates.reserve(config.count);
+
+    // construct
+    {
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (std::size_t i = 0; i < config.count; i++)
+        {
+            delegates.push_back(factory());
+        }
+        const double ns = sw.ElapsedNs();
+
+        bytesPerDelegate = GetBytesPerDelegate(delegates.front(), allocs.Bytes(), config.count);
+        PrintRow(impl, shape, bind, "construct", ns / config.count, static_cast<double>(allocs.Count()) / config.count, bytesPerDelegate);
+    }
+
+    // move
+    std::vector<TDelegate> moved;
+    moved.reserve(config.count);
+    {
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (auto& d : delegates)
+        {
+            moved.push_back(std::move(d));
+        }
+        const double ns = sw.ElapsedNs();
+
+        PrintRow(impl, shape, bind, "move", ns / config.count, static_cast<double>(allocs.Count()) / config.count, bytesPerDelegate);
+    }
+    delegates.clear();
+
+    // invoke, same delegate in a hot loop
+    {
+        const TDelegate* d = Launder(&moved[config.count / 2]);
+
+        const AllocScope allocs;
+        const Stopwatch sw;
+        int sum = 0;
+        for (std::size_t i = 0; i < config.hotIterations; i++)
+        {
+            sum += (*d)(static_cast<int>(i));
+        }
+        const double ns = sw.ElapsedNs();
+        DoNotOptimize(sum);
+
+        PrintRow(impl, shape, bind, "invoke-hot", ns / config.hotIterations, static_cast<double>(allocs.Count()) / config.hotIterations,
+                 bytesPerDelegate);
+    }
+
+    // invoke, every delegate once in a scattered order
+    {
+        std::vector<std::uint32_t> order(config.count);
+        std::iota(order.begin(), order.end(), 0u);
+        std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+        const TDelegate* data = Launder(moved.data());
+
+        const AllocScope allocs;
+        const Stopwatch sw;
+        int sum = 0;
+        for (const std::uint32_t index : order)
+        {
+            sum += data[index](static_cast<int>(index));
+        }
+        const double ns = sw.ElapsedNs();
+        DoNotOptimize(sum);
+
+        PrintRow(impl, shape, bind, "invoke-cold", ns / config.count, static_cast<double>(allocs.Count()) / config.count,
+                 bytesPerDelegate);
+    }
+
+    // destroy
+    {
+        const AllocScope allocs;
+        const Stopwatch sw;
+        moved.clear();
+        const double ns = sw.ElapsedNs();
+
+        PrintRow(impl, shape, bind, "destroy", ns / config.count, static_cast<double>(allocs.Count()) / config.count, bytesPerDelegate);
+    }
+}
+
+// A null resource selects the global operator new.
+template<typename TDelegate>
+void RunLibraryDelegate(const Config& config, const char* impl, std::pmr::memory_resource* resource)
+{
+    const Blob blob = MakeBlob();
+
+    RunSuite<TDelegate>(config, impl, "global", "small",
+                        [=] { return TDelegate::CreateGlobal(std::allocator_arg, resource, &global_small, kSmallBind); });
+    RunSuite<TDelegate>(config, impl, "global", "large",
+                        [&] { return TDelegate::CreateGlobal(std::allocator_arg, resource, &global_large, blob); });
+    RunSuite<TDelegate>(config, impl, "member", "small", [=] {
+        return TDelegate::CreateMember(std::allocator_arg, resource, &g_target, &Target::member_small, kSmallBind);
+    });
+    RunSuite<TDelegate>(config, impl, "member", "large",
+                        [&] { return TDelegate::CreateMember(std::allocator_arg, resource, &g_target, &Target::member_large, blob); });
+    RunSuite<TDelegate>(config, impl, "member-const", "small", [=] {
+        return TDelegate::CreateMember(std::allocator_arg, resource, static_cast<const Target*>(&g_target), &Target::member_small_const,
+                                       kSmallBind);
+    });
+    RunSuite<TDelegate>(config, impl, "member-const", "large", [&] {
+        return TDelegate::CreateMember(std::allocator_arg, resource, static_cast<const Target*>(&g_target), &Target::member_large_const,
+                                       blob);
+    });
+    RunSuite<TDelegate>(config, impl, "lambda", "small", [=] {
+        return TDelegate::CreateLambda(std::allocator_arg, resource, [](int x, int b) { return x + b; }, kSmallBind);
+    });
+    RunSuite<TDelegate>(config, impl, "lambda", "large", [&] {
+        return TDelegate::CreateLambda(std::allocator_arg, resource, [](int x, const Blob& b) { return x + b.data[0]; }, blob);
+    });
+}
+
+// Targets bound as template arguments, only the object pointer and bind arguments are stored.
+void RunStaticTargetDelegate(const Config& config)
+{
+    using Delegate = sdaineka::Delegate<int(int)>;
+
+    const Blob blob = MakeBlob();
+    const char* impl = "Delegate::Create<>";
+
+    RunSuite<Delegate>(config, impl, "global", "small", [] { return Delegate::Create<&global_small>(kSmallBind); });
+    RunSuite<Delegate>(config, impl, "global", "large", [&] { return Delegate::Create<&global_large>(blob); });
+    RunSuite<Delegate>(config, impl, "member", "small", [] { return Delegate::Create<&Target::member_small>(&g_target, kSmallBind); });
+    RunSuite<Delegate>(config, impl, "member", "large", [&] { return Delegate::Create<&Target::member_large>(&g_target, blob); });
+    RunSuite<Delegate>(config, impl, "member-const", "small", [] {
+        return Delegate::Create<&Target::member_small_const>(static_cast<const Target*>(&g_target), kSmallBind);
+    });
+    RunSuite<Delegate>(config, impl, "member-const", "large", [&] {
+        return Delegate::Create<&Target::member_large_const>(static_cast<const Target*>(&g_target), blob);
+    });
+}
+
+// Sized for the largest binding below, nothing is allocated.
+void RunInplaceDelegate(const Config& config)
+{
+    using Delegate =
+        sdaineka::InplaceDelegateFor<int(int), sdaineka::delegate_target_t<decltype(&Target::member_large), Target*, Blob>>;
+
+    const Blob blob = MakeBlob();
+    const char* impl = "InplaceDelegate";
+
+    RunSuite<Delegate>(config, impl, "global", "small", [] { return Delegate::CreateGlobal(&global_small, kSmallBind); });
+    RunSuite<Delegate>(config, impl, "global", "large", [&] { return Delegate::CreateGlobal(&global_large, blob); });
+    RunSuite<Delegate>(config, impl, "member", "small", [] { return Delegate::CreateMember(&g_target, &Target::member_small, kSmallBind); });
+    RunSuite<Delegate>(config, impl, "member", "large", [&] { return Delegate::CreateMember(&g_target, &Target::member_large, blob); });
+    RunSuite<Delegate>(config, impl, "lambda", "small",
+                       [] { return Delegate::CreateLambda([](int x, int b) { return x + b; }, kSmallBind); });
+    RunSuite<Delegate>(config, impl, "lambda", "large",
+                       [&] { return Delegate::CreateLambda([](int x, const Blob& b) { return x + b.data[0]; }, blob); });
+}
+
+void RunStdFunction(const Config& config)
+{
+    using StdFunction = std::function<int(int)>;
+    using std::placeholders::_1;
+
+    const Blob blob = MakeBlob();
+    const char* impl = "std::function";
+
+    RunSuite<StdFunction>(config, impl, "global", "small", [] { return StdFunction(std::bind(&global_small, _1, kSmallBind)); });
+    RunSuite<StdFunction>(config, impl, "global", "large", [&] { return StdFunction(std::bind(&global_large, _1, blob)); });
+    RunSuite<StdFunction>(config, impl, "member", "small",
+                          [] { return StdFunction(std::bind(&Target::member_small, &g_target, _1, kSmallBind)); });
+    RunSuite<StdFunction>(config, impl, "member", "large",
+                          [&] { return StdFunction(std::bind(&Target::member_large, &g_target, _1, blob)); });
+    RunSuite<StdFunction>(config, impl, "member-const", "small", [] {
+        return StdFunction(std::bind(&Target::member_small_const, static_cast<const Target*>(&g_target), _1, kSmallBind));
+    });
+    RunSuite<StdFunction>(config, impl, "member-const", "large", [&] {
+        return StdFunction(std::bind(&Target::member_large_const, static_cast<const Target*>(&g_target), _1, blob));
+    });
+    RunSuite<StdFunction>(config, impl, "lambda", "small", [] {
+        return StdFunction([b = kSmallBind](int x) { return x + b; });
+    });
+    RunSuite<StdFunction>(config, impl, "lambda", "large", [&] {
+        return StdFunction([b = blob](int x) { return x + b.data[0]; });
+    });
+}
+
+// Synchronous visitor taking a callback parameter, the callback is built at every call site.
+// Kept out of line like an API boundary would be.
+template<typename TCallback>
+BENCHMARK_NOINLINE int VisitValues(const std::vector<int>& values, const TCallback& callback)
+{
+    int sum = 0;
+    for (const int value : values)
+    {
+        sum += callback(value);
+    }
+
+    return sum;
+}
+
+template<typename TCallback, typename TWrap>
+void RunCallbackParameter(const Config& config, const char* impl, TWrap&& wrap)
+{
+    const std::vector<int> values(16, 1);
+    const std::vector<int>* v = Launder(&values);
+    const std::size_t iterations = config.hotIterations / values.size();
+
+    const AllocScope allocs;
+    const Stopwatch sw;
+    int sum = 0;
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        const int offset = static_cast<int>(i);
+        auto lambda = [&offset](int x) { return x + offset; };
+        sum += VisitValues<TCallback>(*v, wrap(lambda));
+    }
+    const double ns = sw.ElapsedNs();
+    DoNotOptimize(sum);
+
+    PrintRow(impl, "lambda", "ref", "visit-16", ns / iterations, static_cast<double>(allocs.Count()) / iterations, sizeof(TCallback));
+}
+
+// Per-entity update list: many member delegates bound to a handful of methods, added in random order.
+struct Entity
+{
+    void Move(float dt)
+    {
+        position += velocity * dt;
+    }
+
+    void Damp(float dt)
+    {
+        velocity -= velocity * 0.1f * dt;
+    }
+
+    void Accelerate(float dt)
+    {
+        velocity += 9.81f * dt;
+    }
+
+    void Age(float dt)
+    {
+        age += dt;
+    }
+
+    float position = 0.0f;
+    float velocity = 1.0f;
+    float age = 0.0f;
+};
+
+template<typename TUpdate>
+void RunUpdateList(const Config& config, const char* impl, const char* shape, std::size_t entities, double bytesPerEntry, TUpdate&& update)
+{
+    const std::size_t iterations = std::max<std::size_t>(1, config.hotIterations / entities);
+
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        update(0.016f);
+    }
+    const double ns = sw.ElapsedNs();
+
+    PrintRow(impl, shape, "none", "update-all", ns / (iterations * entities), 0.0, bytesPerEntry);
+}
+
+void RunDelegateVector(const Config& config)
+{
+    using Delegate = sdaineka::Delegate<void(float)>;
+    using MemberFunc = void (Entity::*)(float);
+
+    const std::size_t entities = config.count;
+    std::vector<Entity> world(entities);
+
+    // Each entity gets one update method, so the four targets are interleaved in the list.
+    std::vector<int> kinds(entities);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pick(0, 3);
+    for (int& kind : kinds)
+    {
+        kind = pick(rng);
+    }
+
+    const MemberFunc methods[] = {&Entity::Move, &Entity::Damp, &Entity::Accelerate, &Entity::Age};
+    const auto createStatic = [](int kind, Entity* entity) {
+        switch (kind)
+        {
+        case 0:
+            return Delegate::Create<&Entity::Move>(entity);
+        case 1:
+            return Delegate::Create<&Entity::Damp>(entity);
+        case 2:
+            return Delegate::Create<&Entity::Accelerate>(entity);
+        default:
+            return Delegate::Create<&Entity::Age>(entity);
+        }
+    };
+
+    {
+        std::vector<Delegate> list;
+        list.reserve(entities);
+        for (std::size_t i = 0; i < entities; i++)
+        {
+            list.push_back(Delegate::CreateMember(&world[i], methods[kinds[i]]));
+        }
+
+        RunUpdateList(config, "vector<Delegate>", "member", entities, sizeof(Delegate), [&](float dt) {
+            for (const Delegate& d : list)
+            {
+                d(dt);
+            }
+        });
+    }
+
+    {
+        std::vector<Delegate> list;
+        list.reserve(entities);
+        for (std::size_t i = 0; i < entities; i++)
+        {
+            list.push_back(createStatic(kinds[i], &world[i]));
+        }
+
+        RunUpdateList(config, "vector<Delegate>", "Create<>", entities, sizeof(Delegate), [&](float dt) {
+            for (const Delegate& d : list)
+            {
+                d(dt);
+            }
+        });
+    }
+
+    {
+        sdaineka::DelegateVector<void(float)> list;
+        for (std::size_t i = 0; i < entities; i++)
+        {
+            list.Add(Delegate::CreateMember(&world[i], methods[kinds[i]]));
+        }
+
+        RunUpdateList(config, "DelegateVector", "member", entities, 24.0, [&](float dt) { list.InvokeAll(dt); });
+    }
+
+    {
+        sdaineka::DelegateVector<void(float)> list;
+        for (std::size_t i = 0; i < entities; i++)
+        {
+            list.Add(createStatic(kinds[i], &world[i]));
+        }
+
+        RunUpdateList(config, "DelegateVector", "Create<>", entities, 8.0, [&](float dt) { list.InvokeAll(dt); });
+    }
+
+    DoNotOptimize(world);
+}
+
+// Connection handler churn: a window of live delegates of mixed storage types, each replaced at random.
+void RunStorageChurn(const Config& config, const char* impl, std::pmr::memory_resource* resource)
+{
+    using Delegate = sdaineka::SimpleHeapDelegate<int(int)>;
+
+    const Blob blob = MakeBlob();
+    const std::size_t window = std::max<std::size_t>(1, config.count / 16);
+    const std::size_t iterations = config.hotIterations / 16;
+
+    const auto create = [&](std::uint32_t kind) {
+        switch (kind % 3)
+        {
+        case 0:
+            return Delegate::CreateGlobal(std::allocator_arg, resource, &global_small, kSmallBind);
+        case 1:
+            return Delegate::CreateMember(std::allocator_arg, resource, &g_target, &Target::member_large, blob);
+        default:
+            return Delegate::CreateLambda(std::allocator_arg, resource, [](int x, int b) { return x + b; }, kSmallBind);
+        }
+    };
+
+    std::vector<Delegate> live;
+    live.reserve(window);
+    for (std::size_t i = 0; i < window; i++)
+    {
+        live.push_back(create(static_cast<std::uint32_t>(i)));
+    }
+
+    std::mt19937 rng(42);
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        const std::uint32_t r = static_cast<std::uint32_t>(rng());
+        live[r % window] = create(r >> 16);
+    }
+    const double ns = sw.ElapsedNs();
+
+    PrintRow(impl, "mixed", "mixed", "churn", ns / iterations, static_cast<double>(allocs.Count()) / iterations, sizeof(Delegate));
+}
+
+// Completion callback that hands a bound 4 KiB buffer back to its owner: a regular call gives the target a
+// copy, a one-shot call moves the buffer through.
+template<bool Once>
+void RunCompletionHandoff(const Config& config)
+{
+    using Delegate = sdaineka::Delegate<int(int)>;
+
+    std::vector<std::uint8_t> recycled(4096, 1);
+    const auto complete = [&recycled](int x, std::vector<std::uint8_t> buffer) {
+        recycled = std::move(buffer);
+        return x + recycled[0];
+    };
+
+    const std::size_t iterations = config.hotIterations / 16;
+    int sum = 0;
+
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        auto d = Delegate::CreateLambda(complete, std::move(recycled));
+        if constexpr (Once)
+        {
+            sum += std::move(d)(static_cast<int>(i));
+        }
+        else
+        {
+            sum += d(static_cast<int>(i));
+        }
+    }
+    const double ns = sw.ElapsedNs();
+    DoNotOptimize(sum);
+
+    PrintRow("Delegate", "lambda", "4KiB", Once ? "invoke-once" : "invoke-copy", ns / iterations,
+             static_cast<double>(allocs.Count()) / iterations, sizeof(Delegate));
+}
+
+// Broadcast of one event to many listeners, each bound to its own slot of a shared array.
+template<typename TBroadcast>
+void RunBroadcastSuite(const Config& config, const char* impl, std::size_t listeners, double bytesPerListener, TBroadcast&& broadcast)
+{
+    const std::size_t iterations = std::max<std::size_t>(1, config.hotIterations / listeners);
+
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        broadcast(static_cast<int>(i));
+    }
+    const double ns = sw.ElapsedNs();
+
+    PrintRow(impl, "lambda", "small", "broadcast", ns / (iterations * listeners),
+             static_cast<double>(allocs.Count()) / (iterations * listeners), bytesPerListener);
+}
+
+void RunBroadcast(const Config& config)
+{
+    using Event = sdaineka::MulticastDelegate<void(int)>;
+
+    const std::size_t listeners = std::max<std::size_t>(1, config.count / 16);
+    std::vector<int> sinks(listeners);
+    int* data = Launder(sinks.data());
+
+    const auto listener = [](int x, int* sink) { *sink += x; };
+
+    {
+        Event event;
+        event.Reserve(listeners);
+        for (std::size_t i = 0; i < listeners; i++)
+        {
+            event.Subscribe(Event::DelegateType::CreateLambda(listener, data + i));
+        }
+
+        RunBroadcastSuite(config, "MulticastDelegate", listeners, sizeof(Event::DelegateType), [&](int x) { event.Broadcast(x); });
+    }
+
+    {
+        std::vector<sdaineka::SimpleHeapDelegate<void(int)>> event;
+        event.reserve(listeners);
+        for (std::size_t i = 0; i < listeners; i++)
+        {
+            event.push_back(sdaineka::SimpleHeapDelegate<void(int)>::CreateLambda(listener, data + i));
+        }
+
+        RunBroadcastSuite(config, "vector<SimpleHeap...>", listeners, GetBytesPerDelegate(event.front(), 0, listeners), [&](int x) {
+            for (const auto& d : event)
+            {
+                d(x);
+            }
+        });
+    }
+
+    {
+        std::vector<std::function<void(int)>> event;
+        event.reserve(listeners);
+        for (std::size_t i = 0; i < listeners; i++)
+        {
+            event.emplace_back([sink = data + i](int x) { *sink += x; });
+        }
+
+        RunBroadcastSuite(config, "vector<std::function>", listeners, sizeof(std::function<void(int)>), [&](int x) {
+            for (const auto& f : event)
+            {
+                f(x);
+            }
+        });
+    }
+
+    DoNotOptimize(sinks);
+}
+
+// Aggregate broadcast throughput of readers hammering one event. ns/op is wall time divided by the
+// broadcasts of all readers, so it drops as readers are added if broadcasts do not serialize.
+template<typename TBroadcast>
+void RunReaderScaling(const Config& config, const char* impl, std::size_t listeners, TBroadcast&& broadcast)
+{
+    const std::size_t maxReaders = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t broadcasts = std::max<std::size_t>(1, config.hotIterations / listeners / 4);
+
+    for (std::size_t readers = 1; readers <= maxReaders; readers *= 2)
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(readers);
+
+        const Stopwatch sw;
+        for (std::size_t r = 0; r < readers; r++)
+        {
+            threads.emplace_back([&] {
+                for (std::size_t i = 0; i < broadcasts; i++)
+                {
+                    broadcast(static_cast<int>(i));
+                }
+            });
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        const double ns = sw.ElapsedNs();
+
+        const std::string shape = "readers=" + std::to_string(readers);
+        PrintRow(impl, shape.c_str(), "small", "broadcast", ns / (broadcasts * readers), 0.0,
+                 static_cast<double>(sizeof(sdaineka::Delegate<void(int)>)));
+    }
+}
+
+void RunConcurrentBroadcast(const Config& config)
+{
+    using Delegate = sdaineka::Delegate<void(int)>;
+
+    constexpr std::size_t kListeners = 64;
+
+    // Each listener owns a cache line so that the counters do not dominate the measurement.
+    struct alignas(64) Counter
+    {
+        std::atomic<long> value{0};
+    };
+    std::vector<Counter> counters(kListeners);
+
+    const auto listener = [](int x, Counter* counter) { counter->value.fetch_add(x, std::memory_order_relaxed); };
+
+    {
+        sdaineka::ConcurrentMulticastDelegate<void(int)> event;
+        for (std::size_t i = 0; i < kListeners; i++)
+        {
+            event.Subscribe(Delegate::CreateLambda(listener, &counters[i]));
+        }
+
+        RunReaderScaling(config, "ConcurrentMulticast", kListeners, [&](int x) { event.Broadcast(x); });
+    }
+
+    {
+        std::mutex mutex;
+        std::vector<Delegate> event;
+        for (std::size_t i = 0; i < kListeners; i++)
+        {
+            event.push_back(Delegate::CreateLambda(listener, &counters[i]));
+        }
+
+        RunReaderScaling(config, "mutex+vector<Delegate>", kListeners, [&](int x) {
+            const std::lock_guard<std::mutex> lock(mutex);
+            for (const Delegate& d : event)
+            {
+                d(x);
+            }
+        });
+    }
+}
+
+// Calls through a replaceable handler slot. "invoke-hot" calls an unchanging slot, "invoke-swap" does the
+// same while another thread replaces the handler every 1000 calls, which is far more often than
+// a logging sink or a route is swapped in practice.
+template<typename TCall, typename TStore>
+void RunHandlerSlot(const Config& config, const char* impl, TCall&& call, TStore&& store)
+{
+    const std::size_t iterations = config.hotIterations / 4;
+
+    for (const bool swapping : {false, true})
+    {
+        std::atomic<std::size_t> progress{0};
+        std::atomic<bool> done{false};
+        std::thread writer;
+        if (swapping)
+        {
+            writer = std::thread([&] {
+                std::size_t swapped = 0;
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    const std::size_t now = progress.load(std::memory_order_relaxed) / 1000;
+                    for (; swapped < now; swapped++)
+                    {
+                        store(static_cast<int>(swapped));
+                    }
+                    std::this_thread::yield();
+                }
+            });
+        }
+
+        int sum = 0;
+        const Stopwatch sw;
+        for (std::size_t i = 0; i < iterations; i++)
+        {
+            sum += call(static_cast<int>(i));
+            progress.store(i, std::memory_order_relaxed);
+        }
+        const double ns = sw.ElapsedNs();
+        DoNotOptimize(sum);
+
+        done = true;
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+
+        PrintRow(impl, "lambda", "small", swapping ? "invoke-swap" : "invoke-hot", ns / iterations, 0.0,
+                 sizeof(sdaineka::Delegate<int(int)>));
+    }
+}
+
+void RunHandlerSlots(const Config& config)
+{
+    using Delegate = sdaineka::Delegate<int(int)>;
+
+    const auto make = [](int b) { return Delegate::CreateLambda([b](int x) { return x + b; }); };
+
+    {
+        Delegate handler = make(kSmallBind);
+        Delegate* slot = Launder(&handler);
+        // Unsynchronized, only the reference point: the plain slot is not swapped.
+        RunHandlerSlot(config, "Delegate", [&](int x) { return (*slot)(x); }, [](int) {});
+    }
+
+    {
+        sdaineka::AtomicDelegate<int(int)> slot(make(kSmallBind));
+        RunHandlerSlot(config, "AtomicDelegate", [&](int x) { return slot(x); }, [&](int b) { slot.Store(make(b)); });
+    }
+
+    {
+        std::mutex mutex;
+        Delegate handler = make(kSmallBind);
+        RunHandlerSlot(
+            config, "mutex+Delegate",
+            [&](int x) {
+                const std::lock_guard<std::mutex> lock(mutex);
+                return handler(x);
+            },
+            [&](int b) {
+                Delegate replacement = make(b);
+                const std::lock_guard<std::mutex> lock(mutex);
+                handler = std::move(replacement);
+            });
+    }
+
+    {
+        auto handler = std::make_shared<const Delegate>(make(kSmallBind));
+        RunHandlerSlot(
+            config, "shared_ptr<Delegate>", [&](int x) { return (*std::atomic_load(&handler))(x); },
+            [&](int b) { std::atomic_store(&handler, std::make_shared<const Delegate>(make(b))); });
+    }
+}
+
+// Deferred calls handed from a producer to a consumer thread. The messages carry a Blob argument, as a
+// network packet would. "post+drain" runs both sides on one thread in batches, "spsc" and "mpsc" on
+// separate threads, one producer per row.
+template<typename TPost, typename TDrain>
+void RunMessagePassing(const Config& config, const char* impl, TPost&& post, TDrain&& drain)
+{
+    constexpr std::size_t kBatch = 256;
+    const std::size_t batches = std::max<std::size_t>(1, config.count / kBatch);
+
+    {
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (std::size_t b = 0; b < batches; b++)
+        {
+            for (std::size_t i = 0; i < kBatch; i++)
+            {
+                post(static_cast<int>(i));
+            }
+            drain();
+        }
+        const double ns = sw.ElapsedNs();
+
+        PrintRow(impl, "member", "large", "post+drain", ns / (batches * kBatch),
+                 static_cast<double>(allocs.Count()) / (batches * kBatch), 0.0);
+    }
+
+    {
+        const std::size_t messages = batches * kBatch;
+        std::atomic<std::size_t> received{0};
+
+        const Stopwatch sw;
+        std::thread producer([&] {
+            for (std::size_t i = 0; i < messages; i++)
+            {
+                post(static_cast<int>(i));
+            }
+        });
+
+        while (received.load(std::memory_order_relaxed) < messages)
+        {
+            const std::size_t count = drain();
+            if (count == 0)
+            {
+                std::this_thread::yield();
+            }
+            received.fetch_add(count, std::memory_order_relaxed);
+        }
+        producer.join();
+        const double ns = sw.ElapsedNs();
+
+        PrintRow(impl, "member", "large", "threads", ns / messages, 0.0, 0.0);
+    }
+}
+
+class Simulation
+{
+public:
+    void OnPacket(int id, const Blob& packet)
+    {
+        checksum += id + packet.data[0];
+    }
+
+    long checksum = 0;
+};
+
+void RunDelegateQueue(const Config& config)
+{
+    using Queue = sdaineka::DelegateQueue<void(int, const Blob&), sdaineka::DelegateQueueMode::SingleProducer>;
+    using MpscQueue = sdaineka::DelegateQueue<void(int, const Blob&), sdaineka::DelegateQueueMode::MultiProducer>;
+
+    const Blob blob = MakeBlob();
+    Simulation simulation;
+
+    {
+        Queue queue(1024);
+        RunMessagePassing(
+            config, "DelegateQueue(spsc)",
+            [&](int id) { queue.Post(Queue::DelegateType::Create<&Simulation::OnPacket>(&simulation), id, blob); },
+            [&] { return queue.Drain(); });
+    }
+
+    {
+        MpscQueue queue(1024);
+        RunMessagePassing(
+            config, "DelegateQueue(mpsc)",
+            [&](int id) { queue.Post(MpscQueue::DelegateType::Create<&Simulation::OnPacket>(&simulation), id, blob); },
+            [&] { return queue.Drain(); });
+    }
+
+    // What the queue replaces: a heap closure per message behind a mutex.
+    {
+        using Closure = sdaineka::SimpleHeapDelegate<void()>;
+
+        std::mutex mutex;
+        std::vector<Closure> pending;
+        std::vector<Closure> running;
+
+        RunMessagePassing(
+            config, "mutex+SimpleHeap closure",
+            [&](int id) {
+                Closure closure = Closure::CreateLambda([&simulation, id, blob] { simulation.OnPacket(id, blob); });
+                const std::lock_guard<std::mutex> lock(mutex);
+                pending.push_back(std::move(closure));
+            },
+            [&] {
+                {
+                    const std::lock_guard<std::mutex> lock(mutex);
+                    running.swap(pending);
+                }
+
+                for (const Closure& closure : running)
+                {
+                    closure();
+                }
+
+                const std::size_t count = running.size();
+                running.clear();
+                return count;
+            });
+    }
+
+    DoNotOptimize(simulation.checksum);
+}
+
+// What the scheduler replaces: a shared queue of std::function behind a mutex.
+class StdFunctionPool
+{
+public:
+    explicit StdFunctionPool(std::size_t workerCount)
+    {
+        for (std::size_t i = 0; i < workerCount; i++)
+        {
+            m_threads.emplace_back([this] { WorkerMain(); });
+        }
+    }
+
+    ~StdFunctionPool()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+            ++m_pending;
+        }
+        m_wake.notify_one();
+    }
+
+    void WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_pending == 0; });
+    }
+
+private:
+    void WorkerMain()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_wake.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty())
+            {
+                return;
+            }
+
+            std::function<void()> task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+
+            lock.unlock();
+            task();
+            lock.lock();
+
+            if (--m_pending == 0)
+            {
+                m_idle.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<std::function<void()>> m_tasks;
+    std::size_t m_pending = 0;
+    bool m_stop = false;
+};
+
+// Per connection idle timeouts: every operation is activity on a random connection, which pushes its
+// timeout to about 30000 ticks ahead; time moves one tick every 64 operations and fires the timeouts that
+// expire. "timer-reset" postpones the pending timer, "timer-rearm" cancels it and schedules a new one. The
+// heap baseline cancels lazily, stale entries are dropped when they surface.
+template<typename TReset, typename TAdvance>
+void RunTimeoutSuite(const Config& config, const char* impl, const char* op, TReset&& reset, TAdvance&& advance)
+{
+    const std::size_t connections = config.count;
+    const std::size_t iterations = config.hotIterations / 16;
+
+    for (std::size_t c = 0; c < connections; c++)
+    {
+        reset(c, 30000 + c % 1000);
+    }
+
+    std::mt19937 rng(42);
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        const std::uint32_t r = static_cast<std::uint32_t>(rng());
+        reset(r % connections, 30000 + (r >> 22));
+        if (i % 64 == 63)
+        {
+            advance();
+        }
+    }
+    const double ns = sw.ElapsedNs();
+
+    PrintRow(impl, "lambda", "small", op, ns / iterations, static_cast<double>(allocs.Count()) / iterations, 0.0);
+}
+
+void RunTimeouts(const Config& config)
+{
+    std::vector<std::uint64_t> timeouts(config.count);
+
+    for (const bool rearm : {false, true})
+    {
+        sdaineka::TimerWheel wheel;
+        std::vector<sdaineka::TimerHandle> handles(config.count);
+        wheel.Reserve(config.count);
+
+        RunTimeoutSuite(
+            config, "TimerWheel", rearm ? "timer-rearm" : "timer-reset",
+            [&](std::size_t c, std::uint64_t delay) {
+                if (rearm)
+                {
+                    wheel.Cancel(handles[c]);
+                }
+                else if (wheel.Reschedule(handles[c], delay))
+                {
+                    return;
+                }
+
+                handles[c] = wheel.Schedule(delay, sdaineka::Delegate<void()>::CreateLambda([&timeouts, c] { ++timeouts[c]; }));
+            },
+            [&] { wheel.Advance(1); });
+    }
+
+    {
+        struct Entry
+        {
+            bool operator<(const Entry& other) const
+            {
+                return expiry > other.expiry;
+            }
+
+            std::uint64_t expiry;
+            std::size_t connection;
+            std::uint64_t generation;
+            std::function<void()> callback;
+        };
+
+        std::priority_queue<Entry> heap;
+        std::vector<std::uint64_t> generations(config.count);
+        std::uint64_t now = 0;
+
+        RunTimeoutSuite(
+            config, "priority_queue<function>", "timer-reset",
+            [&](std::size_t c, std::uint64_t delay) {
+                heap.push({now + delay, c, ++generations[c], [&timeouts, c] { ++timeouts[c]; }});
+            },
+            [&] {
+                ++now;
+                while (!heap.empty() && heap.top().expiry <= now)
+                {
+                    if (heap.top().generation == generations[heap.top().connection])
+                    {
+                        heap.top().callback();
+                    }
+                    heap.pop();
+                }
+            });
+    }
+
+    DoNotOptimize(timeouts.data());
+}
+
+#if defined(__linux__)
+// Readiness dispatch: level triggered eventfds that are signalled once and never read, so every poll
+// reports all of them. ns/op is per dispatched event including the epoll_wait call. The baseline keeps
+// std::function handlers in an unordered_map keyed by the descriptor.
+template<typename TPoll>
+void RunReadinessSuite(const Config& config, const char* impl, std::size_t events, TPoll&& poll)
+{
+    const std::size_t polls = std::max<std::size_t>(1, config.hotIterations / 64 / events);
+
+    std::size_t dispatched = 0;
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < polls; i++)
+    {
+        dispatched += poll();
+    }
+    const double ns = sw.ElapsedNs();
+
+    const double perEvent = static_cast<double>(std::max<std::size_t>(1, dispatched));
+    PrintRow(impl, "lambda", "small", "fd-dispatch", ns / perEvent, static_cast<double>(allocs.Count()) / perEvent, 0.0);
+}
+
+void RunEventReactor(const Config& config)
+{
+    // Stays below the usual limit of 1024 open descriptors.
+    constexpr std::size_t kDescriptors = 512;
+
+    std::vector<int> fds;
+    for (std::size_t i = 0; i < kDescriptors; i++)
+    {
+        const int fd = eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (fd < 0)
+        {
+            break;
+        }
+        fds.push_back(fd);
+    }
+
+    std::vector<std::uint64_t> counts(fds.size());
+
+    {
+        sdaineka::EventReactor reactor(fds.size());
+        for (std::size_t i = 0; i < fds.size(); i++)
+        {
+            reactor.Add(fds[i], EPOLLIN, sdaineka::EventReactor::Handler::CreateLambda([&counts, i](int, std::uint32_t) { ++counts[i]; }));
+        }
+
+        RunReadinessSuite(config, "EventReactor", fds.size(), [&] { return static_cast<std::size_t>(reactor.Poll(0)); });
+    }
+
+    {
+        const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+        std::unordered_map<int, std::function<void(int, std::uint32_t)>> handlers;
+        for (std::size_t i = 0; i < fds.size(); i++)
+        {
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = fds[i];
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fds[i], &event);
+            handlers.emplace(fds[i], [&counts, i](int, std::uint32_t) { ++counts[i]; });
+        }
+
+        std::vector<epoll_event> events(fds.size());
+        RunReadinessSuite(config, "unordered_map<function>", fds.size(), [&] {
+            const int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 0);
+            for (int i = 0; i < count; i++)
+            {
+                const auto it = handlers.find(events[i].data.fd);
+                if (it != handlers.end())
+                {
+                    it->second(events[i].data.fd, events[i].events);
+                }
+            }
+            return static_cast<std::size_t>(std::max(count, 0));
+        });
+
+        close(epollFd);
+    }
+
+    for (const int fd : fds)
+    {
+        close(fd);
+    }
+
+    DoNotOptimize(counts.data());
+}
+#endif
+
+// Cached calls to an expensive pure function, a few hundred ns of dependent arithmetic standing in for a
+// pricing lookup. Keys come from 4096 values skewed towards the low ones and the caches hold 1024
+// results, which hit about 88% of the calls. The baseline is the usual unordered_map plus std::list LRU cache in front of a std::function.
+std::uint64_t expensive_cost(int key)
+{
+    std::uint64_t h = static_cast<std::uint64_t>(key) + 1;
+    for (int i = 0; i < 128; i++)
+    {
+        h = h * 6364136223846793005ull + 1442695040888963407ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+template<typename TCall>
+void RunMemoizeSuite(const Config& config, const char* impl, TCall&& call)
+{
+    const std::size_t iterations = config.hotIterations / 16;
+
+    std::vector<int> keys(1 << 16);
+    std::mt19937 rng(42);
+    for (int& key : keys)
+    {
+        // Uniform below a power of two that is itself uniform in [1, 4096]: small keys are the hot ones.
+        const std::uint32_t r = static_cast<std::uint32_t>(rng());
+        key = static_cast<int>(r % (2u << (r >> 28 & 0xf) % 12));
+    }
+
+    std::uint64_t sum = 0;
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < iterations; i++)
+    {
+        sum += call(keys[i & (keys.size() - 1)]);
+    }
+    const double ns = sw.ElapsedNs();
+    DoNotOptimize(sum);
+
+    PrintRow(impl, "global", "none", "memoized", ns / iterations, static_cast<double>(allocs.Count()) / iterations, 0.0);
+}
+
+void RunMemoization(const Config& config)
+{
+    using Delegate = sdaineka::Delegate<std::uint64_t(int)>;
+    constexpr std::size_t kCapacity = 1024;
+
+    {
+        const Delegate target = Delegate::CreateGlobal(&expensive_cost);
+        RunMemoizeSuite(config, "Delegate (uncached)", [&](int key) { return target(key); });
+    }
+
+    {
+        sdaineka::MemoizedDelegate<std::uint64_t(int)> cached(Delegate::CreateGlobal(&expensive_cost), kCapacity);
+        RunMemoizeSuite(config, "MemoizedDelegate", [&](int key) { return cached(key); });
+    }
+
+    {
+        sdaineka::MemoizedDelegate<std::uint64_t(int)> cached(Delegate::CreateGlobal(&expensive_cost), kCapacity, 8);
+        RunMemoizeSuite(config, "MemoizedDelegate+shards", [&](int key) { return cached(key); });
+    }
+
+    {
+        using Lru = std::list<std::pair<int, std::uint64_t>>;
+        const std::function<std::uint64_t(int)> target = &expensive_cost;
+        Lru lru;
+        std::unordered_map<int, Lru::iterator> index;
+        RunMemoizeSuite(config, "unordered_map+list LRU", [&](int key) {
+            const auto it = index.find(key);
+            if (it != index.end())
+            {
+                lru.splice(lru.begin(), lru, it->second);
+                return it->second->second;
+            }
+
+            const std::uint64_t value = target(key);
+            if (lru.size() == kCapacity)
+            {
+                index.erase(lru.back().first);
+                lru.pop_back();
+            }
+            lru.emplace_front(key, value);
+            index.emplace(key, lru.begin());
+            return value;
+        });
+    }
+}
+
+// A filter -> transform -> sink chain run over a batch of values. "Delegate x3" and "std::function x3"
+// call three separately stored stages, Compose fuses the lambdas into one delegate, the delegate
+// stages keep their own indirect calls. ns/op is per value.
+template<typename TRun>
+void RunPipelineSuite(const Config& config, const char* impl, const char* shape, TRun&& run)
+{
+    std::vector<int> values(1024);
+    std::iota(values.begin(), values.end(), 0);
+    const std::size_t rounds = std::max<std::size_t>(1, config.hotIterations / 4 / values.size());
+
+    const Stopwatch sw;
+    for (std::size_t r = 0; r < rounds; r++)
+    {
+        run(values);
+    }
+    const double ns = sw.ElapsedNs();
+
+    PrintRow(impl, shape, "none", "pipeline", ns / static_cast<double>(rounds * values.size()), 0.0, 0.0);
+}
+
+void RunPipelines(const Config& config)
+{
+    std::int64_t sum = 0;
+    const auto filter = [](int x) { return (x & 3) != 0; };
+    const auto transform = [](int x) { return x * 3 + 1; };
+    const auto sink = [&sum](int x) { sum += x; };
+    const auto filterStage = [](int x) { return (x & 3) != 0 ? std::optional<int>(x) : std::nullopt; };
+
+    {
+        const auto f = sdaineka::Delegate<bool(int)>::CreateLambda(filter);
+        const auto t = sdaineka::Delegate<int(int)>::CreateLambda(transform);
+        const auto s = sdaineka::Delegate<void(int)>::CreateLambda(sink);
+        const auto* filterDelegate = Launder(&f);
+        const auto* transformDelegate = Launder(&t);
+        const auto* sinkDelegate = Launder(&s);
+        RunPipelineSuite(config, "Delegate x3", "lambda", [&](const std::vector<int>& values) {
+            for (const int x : values)
+            {
+                if ((*filterDelegate)(x))
+                {
+                    (*sinkDelegate)((*transformDelegate)(x));
+                }
+            }
+        });
+    }
+
+    {
+        const auto pipeline = sdaineka::Compose<void(int)>(filterStage, transform, sink);
+        const auto* fused = Launder(&pipeline);
+        RunPipelineSuite(config, "Compose", "lambda", [&](const std::vector<int>& values) {
+            for (const int x : values)
+            {
+                (*fused)(x);
+            }
+        });
+    }
+
+    {
+        const auto pipeline = sdaineka::Compose<void(int)>(sdaineka::Delegate<std::optional<int>(int)>::CreateLambda(filterStage),
+                                                           sdaineka::Delegate<int(int)>::CreateLambda(transform),
+                                                           sdaineka::Delegate<void(int)>::CreateLambda(sink));
+        const auto* chained = Launder(&pipeline);
+        RunPipelineSuite(config, "Compose", "delegates", [&](const std::vector<int>& values) {
+            for (const int x : values)
+            {
+                (*chained)(x);
+            }
+        });
+    }
+
+    {
+        const std::function<bool(int)> f = filter;
+        const std::function<int(int)> t = transform;
+        const std::function<void(int)> s = sink;
+        RunPipelineSuite(config, "std::function x3", "lambda", [&](const std::vector<int>& values) {
+            for (const int x : values)
+            {
+                if (f(x))
+                {
+                    s(t(x));
+                }
+            }
+        });
+    }
+
+    DoNotOptimize(sum);
+}
+
+// Dirty notifications: a frame posts 16384 (entity, value) calls over 1024 entities and ends with a
+// flush; the handler stands in for per entity work of a few dozen ns. "Delegate" calls the handler on
+// every post, the others once per entity and frame. ns/op is per post including the flush.
+std::uint64_t refresh_entity(std::uint64_t state, int entity, int value)
+{
+    std::uint64_t h = state ^ (static_cast<std::uint64_t>(entity) << 32 | static_cast<std::uint32_t>(value));
+    for (int i = 0; i < 48; i++)
+    {
+        h = h * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    return h;
+}
+
+template<typename TPost, typename TFlush>
+void RunCoalescingSuite(const Config& config, const char* impl, TPost&& post, TFlush&& flush)
+{
+    constexpr std::size_t kPostsPerFrame = 16384;
+    const std::size_t frames = std::max<std::size_t>(1, config.hotIterations / 16 / kPostsPerFrame);
+
+    std::vector<int> entities(kPostsPerFrame);
+    std::mt19937 rng(42);
+    for (int& entity : entities)
+    {
+        entity = static_cast<int>(rng() % 1024);
+    }
+
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t f = 0; f < frames; f++)
+    {
+        for (std::size_t i = 0; i < kPostsPerFrame; i++)
+        {
+            post(entities[i], static_cast<int>(i));
+        }
+        flush();
+    }
+    const double ns = sw.ElapsedNs();
+
+    const double posts = static_cast<double>(frames * kPostsPerFrame);
+    PrintRow(impl, "lambda", "small", "post+flush", ns / posts, static_cast<double>(allocs.Count()) / posts, 0.0);
+}
+
+void RunCoalescing(const Config& config)
+{
+    std::uint64_t state = 0;
+    const auto refresh = [&state](int entity, int value) { state = refresh_entity(state, entity, value); };
+
+    {
+        const auto handler = sdaineka::Delegate<void(int, int)>::CreateLambda(refresh);
+        const auto* target = Launder(&handler);
+        RunCoalescingSuite(config, "Delegate", [&](int entity, int value) { (*target)(entity, value); }, [] {});
+    }
+
+    {
+        using Dispatcher = sdaineka::CoalescingDispatcher<int, void(int)>;
+        Dispatcher dispatcher(Dispatcher::Handler::CreateLambda([&refresh](const int& entity, int value) { refresh(entity, value); }));
+        RunCoalescingSuite(
+            config, "CoalescingDispatcher", [&](int entity, int value) { dispatcher.Post(entity, value); }, [&] { dispatcher.Flush(); });
+    }
+
+    {
+        const std::function<void(int, int)> handler = refresh;
+        std::unordered_map<int, std::size_t> index;
+        std::vector<std::pair<int, int>> pending;
+        RunCoalescingSuite(
+            config, "unordered_map<function>",
+            [&](int entity, int value) {
+                const auto inserted = index.try_emplace(entity, pending.size());
+                if (inserted.second)
+                {
+                    pending.emplace_back(entity, value);
+                }
+                else
+                {
+                    pending[inserted.first->second].second = value;
+                }
+            },
+            [&] {
+                for (const std::pair<int, int>& call : pending)
+                {
+                    handler(call.first, call.second);
+                }
+                pending.clear();
+                index.clear();
+            });
+    }
+
+    DoNotOptimize(state);
+}
+
+// Opcode dispatch of a small interpreter: 4096 random instructions over 8 handlers, each updating an
+// accumulator. "dense" keys are 0-7, "sparse" keys message ids spread over 32 bits. The maps are
+// built before timing, their construction is reported separately as "build" per table; DelegateTable
+// is computed at compile time and has nothing to build.
+struct TableMachine
+{
+    std::uint64_t acc = 1;
+};
+
+template<int N>
+void table_op(TableMachine& m, std::uint32_t operand)
+{
+    m.acc = m.acc * (2 * N + 1) + operand;
+}
+
+constexpr std::uint32_t kSparseIds[8] = {0x0101, 0x0207, 0x1000, 0x2345, 0x10000, 0x7fff0000, 0x80000001, 0xfffffff0};
+
+template<std::uint32_t... Ids, int... Ns>
+auto MakeOpTable(std::integer_sequence<std::uint32_t, Ids...>, std::integer_sequence<int, Ns...>)
+    -> sdaineka::DelegateTable<std::uint32_t, void(TableMachine&, std::uint32_t), sdaineka::DelegateTableEntry<Ids, &table_op<Ns>>...>;
+
+// "sparse256": 256 message ids spread over 32 bits, dispatched to the same 8 handlers.
+constexpr std::uint32_t LargeTableId(int i)
+{
+    return static_cast<std::uint32_t>(i) * 0x9e3779b1u + 17u;
+}
+
+template<int... Is>
+auto MakeLargeOpTable(std::integer_sequence<int, Is...>)
+    -> sdaineka::DelegateTable<std::uint32_t, void(TableMachine&, std::uint32_t),
+                               sdaineka::DelegateTableEntry<LargeTableId(Is), &table_op<Is % 8>>...>;
+
+template<typename TDispatch>
+void RunDispatchSuite(const Config& config, const char* impl, const char* shape, const std::vector<std::uint32_t>& keys,
+                      TDispatch&& dispatch)
+{
+    const std::size_t rounds = std::max<std::size_t>(1, config.hotIterations / 8 / keys.size());
+
+    TableMachine machine;
+    const Stopwatch sw;
+    for (std::size_t r = 0; r < rounds; r++)
+    {
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            dispatch(keys[i], machine, static_cast<std::uint32_t>(i));
+        }
+    }
+    const double ns = sw.ElapsedNs();
+    DoNotOptimize(machine.acc);
+
+    PrintRow(impl, shape, "none", "dispatch", ns / static_cast<double>(rounds * keys.size()), 0.0, 0.0);
+}
+
+template<typename TMap, typename TMake>
+void RunDispatchMaps(const Config& config, const char* impl, const std::uint32_t* ids, const std::vector<std::uint32_t>& keys,
+                     const char* shape, TMake&& make)
+{
+    const auto build = [&] {
+        TMap map;
+        map.emplace(ids[0], make(&table_op<0>));
+        map.emplace(ids[1], make(&table_op<1>));
+        map.emplace(ids[2], make(&table_op<2>));
+        map.emplace(ids[3], make(&table_op<3>));
+        map.emplace(ids[4], make(&table_op<4>));
+        map.emplace(ids[5], make(&table_op<5>));
+        map.emplace(ids[6], make(&table_op<6>));
+        map.emplace(ids[7], make(&table_op<7>));
+        return map;
+    };
+
+    const std::size_t builds = std::max<std::size_t>(1, config.hotIterations / 1024);
+    const AllocScope allocs;
+    const Stopwatch sw;
+    for (std::size_t i = 0; i < builds; i++)
+    {
+        const TMap map = build();
+        DoNotOptimize(map);
+    }
+    const double ns = sw.ElapsedNs();
+    PrintRow(impl, shape, "none", "build", ns / builds, static_cast<double>(allocs.Count()) / builds, 0.0);
+
+    const TMap map = build();
+    RunDispatchSuite(config, impl, shape, keys,
+                     [&](std::uint32_t key, TableMachine& m, std::uint32_t operand) { map.at(key)(m, operand); });
+}
+
+void RunDispatchTables(const Config& config)
+{
+    constexpr std::uint32_t kDenseIds[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+    std::mt19937 rng(42);
+    std::vector<std::uint32_t> dense(4096);
+    std::vector<std::uint32_t> sparse(dense.size());
+    for (std::size_t i = 0; i < dense.size(); i++)
+    {
+        dense[i] = rng() % 8;
+        sparse[i] = kSparseIds[dense[i]];
+    }
+
+    using Handlers = std::make_integer_sequence<int, 8>;
+    using DenseTable = decltype(MakeOpTable(std::integer_sequence<std::uint32_t, 0, 1, 2, 3, 4, 5, 6, 7>(), Handlers()));
+    using SparseTable = decltype(MakeOpTable(std::integer_sequence<std::uint32_t, kSparseIds[0], kSparseIds[1], kSparseIds[2],
+                                                                   kSparseIds[3], kSparseIds[4], kSparseIds[5], kSparseIds[6],
+                                                                   kSparseIds[7]>(),
+                                             Handlers()));
+
+    RunDispatchSuite(config, "switch", "dense", dense, [](std::uint32_t key, TableMachine& m, std::uint32_t operand) {
+        switch (key)
+        {
+        case 0:
+            table_op<0>(m, operand);
+            break;
+        case 1:
+            table_op<1>(m, operand);
+            break;
+        case 2:
+            table_op<2>(m, operand);
+            break;
+        case 3:
+            table_op<3>(m, operand);
+            break;
+        case 4:
+            table_op<4>(m, operand);
+            break;
+        case 5:
+            table_op<5>(m, operand);
+            break;
+        case 6:
+            table_op<6>(m, operand);
+            break;
+        default:
+            table_op<7>(m, operand);
+            break;
+        }
+    });
+
+    for (const bool isDense : {true, false})
+    {
+        const char* shape = isDense ? "dense" : "sparse";
+        const std::vector<std::uint32_t>& keys = isDense ? dense : sparse;
+        const std::uint32_t* ids = isDense ? kDenseIds : kSparseIds;
+
+        if (isDense)
+        {
+            RunDispatchSuite(config, "DelegateTable", shape, keys, [](std::uint32_t key, TableMachine& m, std::uint32_t operand) {
+                DenseTable::Invoke(key, m, operand);
+            });
+        }
+        else
+        {
+            RunDispatchSuite(config, "DelegateTable", shape, keys, [](std::uint32_t key, TableMachine& m, std::uint32_t operand) {
+                SparseTable::Invoke(key, m, operand);
+            });
+        }
+
+        using Function = std::function<void(TableMachine&, std::uint32_t)>;
+        using Delegate = sdaineka::Delegate<void(TableMachine&, std::uint32_t)>;
+        RunDispatchMaps<std::unordered_map<std::uint32_t, Function>>(config, "unordered_map<function>", ids, keys, shape,
+                                                                     [](auto func) { return Function(func); });
+        RunDispatchMaps<std::unordered_map<std::uint32_t, Delegate>>(config, "unordered_map<Delegate>", ids, keys, shape,
+                                                                     [](auto func) { return Delegate::CreateGlobal(func); });
+    }
+
+    using LargeTable = decltype(MakeLargeOpTable(std::make_integer_sequence<int, 256>()));
+    std::vector<std::uint32_t> large(dense.size());
+    for (std::uint32_t& key : large)
+    {
+        key = LargeTableId(static_cast<int>(rng() % 256));
+    }
+
+    RunDispatchSuite(config, "DelegateTable", "sparse256", large, [](std::uint32_t key, TableMachine& m, std::uint32_t operand) {
+        LargeTable::Invoke(key, m, operand);
+    });
+
+    std::unordered_map<std::uint32_t, sdaineka::Delegate<void(TableMachine&, std::uint32_t)>> map;
+    for (int i = 0; i < 256; i++)
+    {
+        map.emplace(LargeTableId(i), LargeTable::GetDelegate(LargeTableId(i)));
+    }
+    RunDispatchSuite(config, "unordered_map<Delegate>", "sparse256", large,
+                     [&map](std::uint32_t key, TableMachine& m, std::uint32_t operand) { map.at(key)(m, operand); });
+}
+
+#if SDAINEKA_DELEGATE_COROUTINES
+// Requests of three asynchronous steps whose completions are queued and run by an event loop, as I/O
+// completions would be; 64 requests are in flight at a time. "callbacks" chains member function
+// continuations, "Task" awaits the same operations through AsyncDelegate, with one frame per request and
+// one per step from the slab resource. ns/op and allocs/op are per request.
+using CoCompletion = sdaineka::Delegate<void(int)>;
+
+struct CoLoop
+{
+    void Step(int value, CoCompletion&& done)
+    {
+        ready.emplace_back(std::move(done), value * 3 + 1);
+    }
+
+    void Run()
+    {
+        while (!ready.empty())
+        {
+            running.swap(ready);
+            for (std::pair<CoCompletion, int>& completion : running)
+            {
+                completion.first(completion.second);
+            }
+            running.clear();
+        }
+    }
+
+    std::vector<std::pair<CoCompletion, int>> ready;
+    std::vector<std::pair<CoCompletion, int>> running;
+};
+
+struct CoCallbackRequest
+{
+    void Start(int value)
+    {
+        loop->Step(value, CoCompletion::CreateMember(this, &CoCallbackRequest::Second));
+    }
+
+    void Second(int value)
+    {
+        loop->Step(value, CoCompletion::CreateMember(this, &CoCallbackRequest::Third));
+    }
+
+    void Third(int value)
+    {
+        loop->Step(value, CoCompletion::CreateMember(this, &CoCallbackRequest::Done));
+    }
+
+    void Done(int value)
+    {
+        *sum += static_cast<std::uint64_t>(value);
+    }
+
+    CoLoop* loop;
+    std::uint64_t* sum;
+};
+
+using CoStep = sdaineka::AsyncDelegate<sdaineka::Task<int>(int)>;
+
+sdaineka::Task<void> co_handle_request(const CoStep& step, int value, std::uint64_t& sum)
+{
+    const int first = co_await step(value);
+    const int second = co_await step(first);
+    const int third = co_await step(second);
+    sum += static_cast<std::uint64_t>(third);
+}
+
+void RunCoroutines(const Config& config)
+{
+    constexpr std::size_t kInFlight = 64;
+    const std::size_t rounds = std::max<std::size_t>(1, config.hotIterations / 64 / kInFlight);
+    const double requests = static_cast<double>(rounds * kInFlight);
+
+    CoLoop loop;
+    std::uint64_t sum = 0;
+
+    {
+        std::vector<CoCallbackRequest> inFlight(kInFlight, CoCallbackRequest{&loop, &sum});
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            for (std::size_t i = 0; i < kInFlight; i++)
+            {
+                inFlight[i].Start(static_cast<int>(i));
+            }
+            loop.Run();
+        }
+        PrintRow("callbacks", "3 steps", "member", "request", sw.ElapsedNs() / requests, static_cast<double>(allocs.Count()) / requests,
+                 0.0);
+    }
+
+    {
+        const CoStep step(CoStep::CallbackType::Create<&CoLoop::Step>(&loop));
+        std::vector<sdaineka::Task<void>> inFlight(kInFlight);
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            for (std::size_t i = 0; i < kInFlight; i++)
+            {
+                inFlight[i] = co_handle_request(step, static_cast<int>(i), sum);
+                inFlight[i].Start();
+            }
+            loop.Run();
+        }
+        PrintRow("Task+AsyncDelegate", "3 steps", "member", "request", sw.ElapsedNs() / requests,
+                 static_cast<double>(allocs.Count()) / requests, 0.0);
+    }
+
+    // Waking 64 coroutines that await an event against calling 64 subscribers; ns/op is per resume or call.
+    {
+        sdaineka::AsyncEvent<void(int)> event;
+        std::vector<sdaineka::Task<void>> waiters;
+        bool stop = false;
+        for (std::size_t i = 0; i < kInFlight; i++)
+        {
+            waiters.push_back([](sdaineka::AsyncEvent<void(int)>& e, std::uint64_t& s, const bool& done) -> sdaineka::Task<void>
+                              {
+                                  while (!done)
+                                  {
+                                      s += static_cast<std::uint64_t>(co_await e);
+                                  }
+                              }(event, sum, stop));
+            waiters.back().Start();
+        }
+
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            event.Broadcast(static_cast<int>(r));
+        }
+        PrintRow("AsyncEvent", "64 waiters", "none", "resume", sw.ElapsedNs() / requests, static_cast<double>(allocs.Count()) / requests,
+                 0.0);
+
+        stop = true;
+        event.Broadcast(0);
+    }
+
+    {
+        sdaineka::MulticastDelegate<void(int)> event;
+        for (std::size_t i = 0; i < kInFlight; i++)
+        {
+            event.Subscribe(sdaineka::Delegate<void(int)>::CreateLambda([&sum](int value) { sum += static_cast<std::uint64_t>(value); }));
+        }
+
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            event.Broadcast(static_cast<int>(r));
+        }
+        PrintRow("MulticastDelegate", "64 subscribers", "lambda", "call", sw.ElapsedNs() / requests,
+                 static_cast<double>(allocs.Count()) / requests, 0.0);
+    }
+
+    DoNotOptimize(sum);
+}
+#endif
+
+// Fan-out of small jobs, each capturing a pointer and an index. ns/op is the wall time per job including
+// the wait, allocs/op counts the submitting thread only.
+void RunTaskFanOut(const Config& config)
+{
+    const std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t jobs = config.count;
+
+    std::vector<long> results(jobs);
+    long* data = Launder(results.data());
+
+    {
+        sdaineka::TaskScheduler scheduler(workers);
+
+        const AllocScope allocs;
+        const Stopwatch sw;
+        sdaineka::TaskGroup group;
+        for (std::size_t i = 0; i < jobs; i++)
+        {
+            scheduler.Submit(group, sdaineka::TaskScheduler::Task::CreateLambda([data, i] { data[i] += static_cast<long>(i); }));
+        }
+        scheduler.Wait(group);
+        const double ns = sw.ElapsedNs();
+
+        PrintRow("TaskScheduler", "lambda", "small", "submit+wait", ns / jobs, static_cast<double>(allocs.Count()) / jobs,
+                 sizeof(sdaineka::TaskScheduler::Task));
+    }
+
+    // Fan-out from within a task, as a pipeline stage would do: submissions go to the worker's own deque.
+    {
+        sdaineka::TaskScheduler scheduler(workers);
+
+        const Stopwatch sw;
+        sdaineka::TaskGroup root;
+        scheduler.Submit(root, sdaineka::TaskScheduler::Task::CreateLambda([&scheduler, data, jobs] {
+            sdaineka::TaskGroup group;
+            for (std::size_t i = 0; i < jobs; i++)
+            {
+                scheduler.Submit(group, sdaineka::TaskScheduler::Task::CreateLambda([data, i] { data[i] += static_cast<long>(i); }));
+            }
+            scheduler.Wait(group);
+        }));
+        scheduler.Wait(root);
+        const double ns = sw.ElapsedNs();
+
+        PrintRow("TaskScheduler", "lambda", "small", "nested", ns / jobs, 0.0, sizeof(sdaineka::TaskScheduler::Task));
+    }
+
+    {
+        sdaineka::TaskScheduler scheduler(workers);
+
+        const AllocScope allocs;
+        const Stopwatch sw;
+        scheduler.ParallelFor(0, jobs, 256, [data](std::size_t i) { data[i] += static_cast<long>(i); });
+        const double ns = sw.ElapsedNs();
+
+        PrintRow("TaskScheduler", "lambda", "small", "parallel-for", ns / jobs, static_cast<double>(allocs.Count()) / jobs,
+                 sizeof(sdaineka::TaskScheduler::Task));
+    }
+
+    {
+        StdFunctionPool pool(workers);
+
+        const AllocScope allocs;
+        const Stopwatch sw;
+        for (std::size_t i = 0; i < jobs; i++)
+        {
+            pool.Submit([data, i] { data[i] += static_cast<long>(i); });
+        }
+        pool.WaitIdle();
+        const double ns = sw.ElapsedNs();
+
+        PrintRow("std::function pool", "lambda", "small", "submit+wait", ns / jobs, static_cast<double>(allocs.Count()) / jobs,
+                 sizeof(std::function<void()>));
+    }
+
+    DoNotOptimize(results);
+}
+
+// The same delegate applied to every element of an array, one call per element against one InvokeBatch.
+template<typename TDelegate>
+void RunBatch(const Config& config, const char* impl, const char* shape, const TDelegate& delegate)
+{
+    std::vector<int> input(config.count);
+    std::iota(input.begin(), input.end(), 0);
+    std::vector<int> output(config.count);
+
+    const TDelegate* d = Launder(&delegate);
+    const std::size_t rounds = std::max<std::size_t>(1, config.hotIterations / config.count);
+
+    {
+        const Stopwatch sw;
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            for (std::size_t i = 0; i < input.size(); i++)
+            {
+                output[i] = (*d)(input[i]);
+            }
+            DoNotOptimize(output);
+        }
+        const double ns = sw.ElapsedNs();
+
+        PrintRow(impl, shape, "small", "invoke-loop", ns / (rounds * input.size()), 0.0, 0.0);
+    }
+
+    {
+        const Stopwatch sw;
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            d->InvokeBatch(output.data(), input.size(), input.data());
+            DoNotOptimize(output);
+        }
+        const double ns = sw.ElapsedNs();
+
+        PrintRow(impl, shape, "small", "invoke-batch", ns / (rounds * input.size()), 0.0, 0.0);
+    }
+}
+
+void RunBatches(const Config& config)
+{
+    using Delegate = sdaineka::Delegate<int(int)>;
+    using SimpleHeapDelegate = sdaineka::SimpleHeapDelegate<int(int)>;
+
+    const auto lambda = [](int x, int b) { return x * b + 1; };
+
+    RunBatch(config, "Delegate", "lambda", Delegate::CreateLambda(lambda, kSmallBind));
+    RunBatch(config, "Delegate", "global", Delegate::CreateGlobal(&global_small, kSmallBind));
+    RunBatch(config, "Delegate::Create<>", "global", Delegate::Create<&global_small>(kSmallBind));
+    RunBatch(config, "SimpleHeapDelegate", "lambda", SimpleHeapDelegate::CreateLambda(lambda, kSmallBind));
+    RunBatch(config, "SimpleHeapDelegate", "global", SimpleHeapDelegate::CreateGlobal(&global_small, kSmallBind));
+}
+
+// Reference point for invocation: a plain call through a function pointer.
+void RunRawFunctionPointer(const Config& config)
+{
+    using FuncPtr = int (*)(int, int);
+
+    FuncPtr func = global_small;
+    const FuncPtr* f = Launder(&func);
+
+    const Stopwatch sw;
+    int sum = 0;
+    for (std::size_t i = 0; i < config.hotIterations; i++)
+    {
+        sum += (*f)(static_cast<int>(i), kSmallBind);
+    }
+    const double ns = sw.ElapsedNs();
+    DoNotOptimize(sum);
+
+    PrintRow("raw function pointer", "global", "small", "invoke-hot", ns / config.hotIterations, 0.0, sizeof(FuncPtr));
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Config config;
+    if (argc > 1)
+    {
+        // Optional scale divisor for quick runs, e.g. `benchmarks 16`.
+        const std::size_t divisor = std::max<long>(1, std::strtol(argv[1], nullptr, 10));
+        config.count = std::max<std::size_t>(1, config.count / divisor);
+        config.hotIterations = std::max<std::size_t>(1, config.hotIterations / divisor);
+    }
+
+    std::printf("delegates: %zu, hot iterations: %zu, Delegate<int(int)> stack storage: %zu bytes, instrumentation: %s\n\n",
+                config.count, config.hotIterations, sdaineka::Delegate<int(int)>::GetStorageStackSize(),
+                SDAINEKA_DELEGATE_INSTRUMENTATION ? "on" : "off");
+
+    PrintHeader();
+    RunRawFunctionPointer(config);
+    RunLibraryDelegate<sdaineka::Delegate<int(int)>>(config, "Delegate", nullptr);
+    RunLibraryDelegate<sdaineka::Delegate<int(int)>>(config, "Delegate+pool", sdaineka::DelegatePoolResource::Get());
+    RunStaticTargetDelegate(config);
+    RunLibraryDelegate<sdaineka::SimpleHeapDelegate<int(int)>>(config, "SimpleHeapDelegate", nullptr);
+    RunLibraryDelegate<sdaineka::SimpleHeapDelegate<int(int)>>(config, "SimpleHeapDelegate+pool", sdaineka::DelegatePoolResource::Get());
+    RunLibraryDelegate<sdaineka::SimpleHeapDelegate<int(int)>>(config, "SimpleHeapDelegate+slab", sdaineka::DelegateSlabResource::Get());
+    RunInplaceDelegate(config);
+    RunStdFunction(config);
+
+    RunStorageChurn(config, "SimpleHeapDelegate", nullptr);
+    RunStorageChurn(config, "SimpleHeapDelegate+pool", sdaineka::DelegatePoolResource::Get());
+    RunStorageChurn(config, "SimpleHeapDelegate+slab", sdaineka::DelegateSlabResource::Get());
+
+    RunCompletionHandoff<false>(config);
+    RunCompletionHandoff<true>(config);
+
+    RunBatches(config);
+    RunDelegateVector(config);
+    RunBroadcast(config);
+    RunConcurrentBroadcast(config);
+    RunHandlerSlots(config);
+    RunDelegateQueue(config);
+    RunTaskFanOut(config);
+    RunTimeouts(config);
+#if defined(__linux__)
+    RunEventReactor(config);
+#endif
+    RunMemoization(config);
+    RunPipelines(config);
+    RunCoalescing(config);
+    RunDispatchTables(config);
+#if SDAINEKA_DELEGATE_COROUTINES
+    RunCoroutines(config);
+#endif
+
+    RunCallbackParameter<sdaineka::DelegateRef<int(int)>>(config, "DelegateRef",
+                                                          [](auto& f) { return sdaineka::DelegateRef<int(int)>(f); });
+    RunCallbackParameter<sdaineka::Delegate<int(int)>>(config, "Delegate",
+                                                       [](auto& f) { return sdaineka::Delegate<int(int)>::CreateLambda(f); });
+    RunCallbackParameter<std::function<int(int)>>(config, "std::function", [](auto& f) { return std::function<int(int)>(f); });
+
+#if SDAINEKA_DELEGATE_INSTRUMENTATION
+    // The rows above include the cost of recording these.
+    std::printf("\n");
+    std::fflush(stdout);
+    sdaineka::DelegateInstrumentation::Get()->WriteCsv(std::cout);
+#endif
+
+#if SDAINEKA_DELEGATE_TELEMETRY
+    std::printf("\n");
+    std::fflush(stdout);
+    sdaineka::DelegateStorageTelemetry::Get()->WriteCsv(std::cout);
+#endif
+
+    return 0;
+}
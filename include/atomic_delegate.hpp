@@ -0,0 +1,142 @@
+#pragma once
+#include "delegate.hpp"
+#include "delegate_epoch.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sdaineka
+{
+template<typename>
+class AtomicDelegate;
+
+// Delegate slot whose target can be replaced while other threads call it, e.g. a logging sink or a routing
+// callback.
+//
+// The stored delegate lives on the heap and is published through an atomic pointer. A call enters an
+// EpochDomain critical section, loads the pointer and calls through it: it takes no lock, writes only its
+// own thread's epoch record and completes in a bounded number of steps. Store() publishes the new
+// delegate with a single atomic exchange and retires the previous one, which the EpochDomain destroys once
+// no call can still be running it; neither Store() nor Exchange() waits for running calls. Calls that
+// started before a Store() may still run the previous target. Targets may replace the delegate they are
+// called through.
+template<typename TReturn, typename... TArgs>
+class AtomicDelegate<TReturn(TArgs...)>
+{
+public:
+    using DelegateType = Delegate<TReturn(TArgs...)>;
+    using HandoffType = Delegate<void(DelegateType&&)>;
+
+public:
+    AtomicDelegate() = default;
+
+    explicit AtomicDelegate(DelegateType delegate)
+        : m_delegate(Box(std::move(delegate)))
+    {
+    }
+
+    AtomicDelegate(const AtomicDelegate&) = delete;
+    AtomicDelegate& operator=(const AtomicDelegate&) = delete;
+
+    // Must not race with calls.
+    ~AtomicDelegate()
+    {
+        delete m_delegate.load(std::memory_order_relaxed);
+    }
+
+    // Calling an empty slot is undefined, as for Delegate.
+    TReturn operator()(TArgs... args) const
+    {
+        const EpochGuard guard;
+
+        const DelegateType* delegate = m_delegate.load(std::memory_order_acquire);
+        assert(delegate != nullptr && "calling an empty AtomicDelegate");
+        return (*delegate)(std::forward<TArgs>(args)...);
+    }
+
+    // Calls the stored delegate, if any, and returns whether there was one.
+    template<typename TResult = TReturn, std::enable_if_t<std::is_void_v<TResult>, int> = 0>
+    bool TryInvoke(TArgs... args) const
+    {
+        const EpochGuard guard;
+
+        const DelegateType* delegate = m_delegate.load(std::memory_order_acquire);
+        if (delegate == nullptr)
+        {
+            return false;
+        }
+
+        (*delegate)(std::forward<TArgs>(args)...);
+        return true;
+    }
+
+    // Lock free apart from the allocations of the new delegate and of the retirement of the previous one.
+    void Store(DelegateType delegate)
+    {
+        Retire(m_delegate.exchange(Box(std::move(delegate)), std::memory_order_acq_rel));
+    }
+
+    void Reset()
+    {
+        Store(DelegateType());
+    }
+
+    // Stores a delegate and passes the previous one to the handoff once no call is running it. The handoff
+    // runs outside of any lock on the thread that reclaims the previous delegate: one that retires an object
+    // of the EpochDomain, e.g. through a later Store(), or calls EpochDomain::Reclaim() or Synchronize().
+    // It runs right away with an empty delegate when the slot was empty, and must not throw. Lock free like
+    // Store().
+    void Exchange(DelegateType delegate, HandoffType handoff)
+    {
+        DelegateType* previous = m_delegate.exchange(Box(std::move(delegate)), std::memory_order_acq_rel);
+        if (previous == nullptr)
+        {
+            handoff(DelegateType());
+            return;
+        }
+
+        EpochDomain::Get()->Retire(new Handoff{previous, std::move(handoff)}, &Handoff::Run);
+    }
+
+    // A snapshot, the slot may change right after.
+    operator bool() const
+    {
+        return m_delegate.load(std::memory_order_acquire) != nullptr;
+    }
+
+private:
+    // An empty delegate is stored as a null pointer.
+    static DelegateType* Box(DelegateType&& delegate)
+    {
+        return delegate ? new DelegateType(std::move(delegate)) : nullptr;
+    }
+
+    // The retired delegate may be destroyed right away, which runs its payload destructor.
+    static void Retire(DelegateType* delegate)
+    {
+        if (delegate != nullptr)
+        {
+            EpochDomain::Get()->Retire(delegate);
+        }
+    }
+
+    // Retired in place of the previous delegate by Exchange().
+    struct Handoff
+    {
+        static void Run(void* ptr)
+        {
+            const std::unique_ptr<Handoff> handoff(static_cast<Handoff*>(ptr));
+            const std::unique_ptr<DelegateType> previous(handoff->previous);
+            handoff->handoff(std::move(*previous));
+        }
+
+        DelegateType* previous;
+        HandoffType handoff;
+    };
+
+    std::atomic<DelegateType*> m_delegate{nullptr};
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,284 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sdaineka
+{
+template<typename TKey, typename, typename THash = std::hash<TKey>, typename TKeyEqual = std::equal_to<TKey>>
+class CoalescingDispatcher;
+
+// Collects calls per key and delivers each pending key once per Flush(), e.g. dirty entity notifications
+// that fire many times a frame.
+//
+// Post() stores the arguments of the first call for a key; later calls before the flush either replace
+// them, the last value wins, or are folded in by a merge delegate that receives the pending arguments by
+// reference followed by the new ones. Flush() calls the handler with the key and the pending arguments
+// in the order the keys were first posted. Pending keys live in a dense array indexed by an open
+// addressing table, both are reused, so a steady state of posting and flushing does not allocate.
+//
+// With a debounce window a key is only delivered once no call arrived for `window` time units, and,
+// with a maximum wait, at the latest `maxWait` units after its first call. Time is whatever unit is
+// passed to Flush(now), frames or milliseconds; calls are stamped with the time of the last flush.
+//
+// Handlers may post, including the key being delivered, which goes to the next flush. Not thread safe.
+template<typename TKey, typename... TArgs, typename THash, typename TKeyEqual>
+class CoalescingDispatcher<TKey, void(TArgs...), THash, TKeyEqual>
+{
+public:
+    using Handler = Delegate<void(const TKey& /*key*/, TArgs...)>;
+    using Merge = Delegate<void(std::decay_t<TArgs>& /*pending*/..., TArgs... /*incoming*/)>;
+
+public:
+    explicit CoalescingDispatcher(Handler handler, Merge merge = Merge(), THash hash = THash(), TKeyEqual equal = TKeyEqual())
+        : m_handler(std::move(handler))
+        , m_merge(std::move(merge))
+        , m_hash(std::move(hash))
+        , m_equal(std::move(equal))
+    {
+        assert(m_handler && "the handler of a CoalescingDispatcher can not be empty");
+    }
+
+    CoalescingDispatcher(const CoalescingDispatcher&) = delete;
+    CoalescingDispatcher& operator=(const CoalescingDispatcher&) = delete;
+
+    // A window of 0, the default, delivers every pending key on the next flush. A maxWait of 0 lets a key
+    // that keeps being posted wait indefinitely.
+    void SetDebounce(std::uint64_t window, std::uint64_t maxWait = 0)
+    {
+        m_window = window;
+        m_maxWait = maxWait;
+    }
+
+    // Returns true if the key was not pending yet, false if the call was coalesced into a pending one.
+    bool Post(const TKey& key, TArgs... args)
+    {
+        if (m_slots.empty())
+        {
+            Rehash(16);
+        }
+
+        const std::uint64_t hash = Hash(key);
+        const std::size_t slot = FindSlot(key, hash);
+        if (m_slots[slot] != kEmpty)
+        {
+            Entry& entry = m_pending[m_slots[slot]];
+            if (m_merge)
+            {
+                std::apply([&](auto&... pending) { m_merge(pending..., std::forward<TArgs>(args)...); }, entry.args);
+            }
+            else
+            {
+                entry.args = Args(std::forward<TArgs>(args)...);
+            }
+
+            entry.lastPost = m_now;
+            ++m_coalesced;
+            return false;
+        }
+
+        Append(Entry{key, Args(std::forward<TArgs>(args)...), hash, 0, m_now, m_now, false});
+        return true;
+    }
+
+    // Delivers the pending keys that are due at `now` and returns how many were delivered. Must not be
+    // called from a handler.
+    std::size_t Flush(std::uint64_t now = 0)
+    {
+        assert(!m_flushing && "Flush must not be called from a handler");
+
+        m_now = now > m_now ? now : m_now;
+        m_dispatch.swap(m_pending);
+        for (const Entry& entry : m_dispatch)
+        {
+            m_slots[entry.slot] = kEmpty;
+        }
+
+        // Keys that are not due stay pending ahead of the ones posted by the handlers.
+        for (Entry& entry : m_dispatch)
+        {
+            entry.due = IsDue(entry);
+            if (!entry.due)
+            {
+                Append(std::move(entry));
+            }
+        }
+
+        // Handlers that throw drop the rest of the batch.
+        struct FlushScope
+        {
+            ~FlushScope()
+            {
+                self->m_dispatch.clear();
+                self->m_flushing = false;
+            }
+
+            CoalescingDispatcher* self;
+        };
+
+        m_flushing = true;
+        const FlushScope scope{this};
+
+        std::size_t delivered = 0;
+        for (Entry& entry : m_dispatch)
+        {
+            if (entry.due)
+            {
+                std::apply([&](auto&... args) { m_handler(entry.key, std::forward<TArgs>(args)...); }, entry.args);
+                ++delivered;
+            }
+        }
+
+        m_delivered += delivered;
+        return delivered;
+    }
+
+    bool IsPending(const TKey& key) const
+    {
+        return !m_slots.empty() && m_slots[FindSlot(key, Hash(key))] != kEmpty;
+    }
+
+    // Drops the pending calls without delivering them.
+    void Clear()
+    {
+        for (const Entry& entry : m_pending)
+        {
+            m_slots[entry.slot] = kEmpty;
+        }
+        m_pending.clear();
+    }
+
+    std::size_t Size() const
+    {
+        return m_pending.size();
+    }
+
+    bool Empty() const
+    {
+        return m_pending.empty();
+    }
+
+    // Calls folded into a pending one so far, i.e. handler calls saved.
+    std::uint64_t GetCoalescedCount() const
+    {
+        return m_coalesced;
+    }
+
+    std::uint64_t GetDeliveredCount() const
+    {
+        return m_delivered;
+    }
+
+private:
+    static constexpr std::uint32_t kEmpty = ~std::uint32_t(0);
+
+    using Args = std::tuple<std::decay_t<TArgs>...>;
+
+    struct Entry
+    {
+        TKey key;
+        Args args;
+        std::uint64_t hash;
+        std::size_t slot;
+        std::uint64_t firstPost;
+        std::uint64_t lastPost;
+        bool due;
+    };
+
+    // Fibonacci hashing: the top bits of the product index the table, they depend on all bits of the
+    // hash, so aligned pointers spread out and consecutive integers land without collisions.
+    std::uint64_t Hash(const TKey& key) const
+    {
+        return static_cast<std::uint64_t>(m_hash(key)) * 0x9e3779b97f4a7c15ull;
+    }
+
+    bool IsDue(const Entry& entry) const
+    {
+        return m_now - entry.lastPost >= m_window || (m_maxWait != 0 && m_now - entry.firstPost >= m_maxWait);
+    }
+
+    // Slot holding the key, or the empty slot where it belongs.
+    std::size_t FindSlot(const TKey& key, std::uint64_t hash) const
+    {
+        const std::size_t mask = m_slots.size() - 1;
+        std::size_t i = hash >> m_shift;
+        while (m_slots[i] != kEmpty)
+        {
+            const Entry& entry = m_pending[m_slots[i]];
+            if (entry.hash == hash && m_equal(entry.key, key))
+            {
+                break;
+            }
+            i = (i + 1) & mask;
+        }
+
+        return i;
+    }
+
+    void Append(Entry&& entry)
+    {
+        // Slots are kept at most half full.
+        if ((m_pending.size() + 1) * 2 > m_slots.size())
+        {
+            Rehash(m_slots.size() * 2);
+        }
+
+        const std::size_t mask = m_slots.size() - 1;
+        std::size_t i = entry.hash >> m_shift;
+        while (m_slots[i] != kEmpty)
+        {
+            i = (i + 1) & mask;
+        }
+
+        entry.slot = i;
+        m_slots[i] = static_cast<std::uint32_t>(m_pending.size());
+        m_pending.push_back(std::move(entry));
+    }
+
+    void Rehash(std::size_t size)
+    {
+        m_slots.assign(size, kEmpty);
+        m_shift = 64;
+        for (std::size_t s = size; s > 1; s /= 2)
+        {
+            --m_shift;
+        }
+
+        for (std::size_t e = 0; e < m_pending.size(); e++)
+        {
+            std::size_t i = m_pending[e].hash >> m_shift;
+            while (m_slots[i] != kEmpty)
+            {
+                i = (i + 1) & (size - 1);
+            }
+
+            m_pending[e].slot = i;
+            m_slots[i] = static_cast<std::uint32_t>(e);
+        }
+    }
+
+    Handler m_handler;
+    Merge m_merge;
+    THash m_hash;
+    TKeyEqual m_equal;
+
+    std::vector<Entry> m_pending;
+    std::vector<Entry> m_dispatch;
+    std::vector<std::uint32_t> m_slots;
+
+    unsigned m_shift = 64;
+    std::uint64_t m_now = 0;
+    std::uint64_t m_window = 0;
+    std::uint64_t m_maxWait = 0;
+    std::uint64_t m_coalesced = 0;
+    std::uint64_t m_delivered = 0;
+    bool m_flushing = false;
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+#include "delegate.hpp"
+#include "delegate_epoch.hpp"
+#include "delegate_ref.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace sdaineka
+{
+// Identifies a subscription of a ConcurrentMulticastDelegate. Ids are never reused.
+struct ConcurrentMulticastDelegateHandle
+{
+    std::uint64_t id = 0;
+};
+
+template<typename>
+class ConcurrentMulticastDelegate;
+
+// Thread safe event that broadcasts without taking locks.
+//
+// Broadcast() reads an immutable snapshot of the subscribers: a contiguous array of DelegateRef to the
+// subscribed delegates. Subscribe and Unsubscribe are serialized by a mutex, copy the array into a new
+// snapshot, publish it and retire the previous one, and the delegates removed from it, through the
+// EpochDomain. A broadcast racing with an unsubscribe may still call the removed subscriber, but its
+// storage stays alive until the broadcast returns. Subscribers may subscribe and unsubscribe, including
+// themselves, from within a broadcast. Writes cost O(n) in the number of subscribers.
+template<typename... TArgs>
+class ConcurrentMulticastDelegate<void(TArgs...)>
+{
+public:
+    using DelegateType = Delegate<void(TArgs...)>;
+    using Handle = ConcurrentMulticastDelegateHandle;
+
+public:
+    ConcurrentMulticastDelegate() = default;
+
+    ConcurrentMulticastDelegate(const ConcurrentMulticastDelegate&) = delete;
+    ConcurrentMulticastDelegate& operator=(const ConcurrentMulticastDelegate&) = delete;
+
+    // Must not race with Broadcast().
+    ~ConcurrentMulticastDelegate()
+    {
+        delete m_snapshot.load(std::memory_order_relaxed);
+    }
+
+    Handle Subscribe(DelegateType delegate)
+    {
+        assert(delegate && "empty delegates can not be subscribed");
+
+        Snapshot* previous;
+        std::uint64_t id;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+
+            id = ++m_lastId;
+            m_subscribers.push_back({id, std::make_unique<DelegateType>(std::move(delegate))});
+            previous = Publish();
+        }
+
+        Retire(previous);
+        return {id};
+    }
+
+    // Returns false if the handle does not refer to a live subscription.
+    bool Unsubscribe(Handle handle)
+    {
+        Snapshot* previous;
+        std::unique_ptr<DelegateType> delegate;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_subscribers.begin();
+            while (it != m_subscribers.end() && it->id != handle.id)
+            {
+                ++it;
+            }
+
+            if (it == m_subscribers.end())
+            {
+                return false;
+            }
+
+            delegate = std::move(it->delegate);
+            m_subscribers.erase(it);
+            previous = Publish();
+        }
+
+        Retire(previous);
+        EpochDomain::Get()->Retire(delegate.release());
+        return true;
+    }
+
+    bool IsSubscribed(Handle handle) const
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (const Subscriber& subscriber : m_subscribers)
+        {
+            if (subscriber.id == handle.id)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Lock free. Subscribers run in subscription order.
+    void Broadcast(TArgs... args) const
+    {
+        const EpochGuard guard;
+
+        if (const Snapshot* snapshot = m_snapshot.load(std::memory_order_acquire))
+        {
+            for (const RefType& ref : snapshot->refs)
+            {
+                ref(args...);
+            }
+        }
+    }
+
+    void Clear()
+    {
+        Snapshot* previous;
+        std::vector<Subscriber> subscribers;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+
+            subscribers.swap(m_subscribers);
+            previous = Publish();
+        }
+
+        Retire(previous);
+        for (Subscriber& subscriber : subscribers)
+        {
+            EpochDomain::Get()->Retire(subscriber.delegate.release());
+        }
+    }
+
+    std::size_t Size() const
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        return m_subscribers.size();
+    }
+
+private:
+    using RefType = DelegateRef<void(TArgs...)>;
+
+    struct Snapshot
+    {
+        std::vector<RefType> refs;
+    };
+
+    struct Subscriber
+    {
+        std::uint64_t id;
+        std::unique_ptr<DelegateType> delegate;
+    };
+
+    // Called with m_mutex held, returns the replaced snapshot. An empty event publishes a null snapshot.
+    Snapshot* Publish()
+    {
+        Snapshot* snapshot = nullptr;
+        if (!m_subscribers.empty())
+        {
+            snapshot = new Snapshot();
+            snapshot->refs.reserve(m_subscribers.size());
+            for (const Subscriber& subscriber : m_subscribers)
+            {
+                snapshot->refs.emplace_back(*subscriber.delegate);
+            }
+        }
+
+        return m_snapshot.exchange(snapshot, std::memory_order_acq_rel);
+    }
+
+    // Retired objects may be destroyed right away, which runs payload destructors, so this is done after
+    // m_mutex is released.
+    static void Retire(Snapshot* snapshot)
+    {
+        if (snapshot != nullptr)
+        {
+            EpochDomain::Get()->Retire(snapshot);
+        }
+    }
+
+    std::atomic<Snapshot*> m_snapshot{nullptr};
+
+    mutable std::mutex m_mutex;
+    std::vector<Subscriber> m_subscribers;
+    std::uint64_t m_lastId = 0;
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -1,34 +1,324 @@
 #pragma once
+#include "delegate_allocator.hpp"
 #include "delegate_common.hpp"
 
-#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <new>
 #include <tuple>
 #include <type_traits>
 #include <utility>
-#include <variant>
 
 namespace sdaineka
 {
 namespace detail
 {
+// Stored in place of the payload when it does not fit into the stack storage.
+struct DelegateHeapBlock
+{
+    std::byte* data;
+    std::pmr::memory_resource* resource;
+};
+
 template<std::size_t StackSize>
 struct DelegateStackStorage
 {
+    static_assert(StackSize >= sizeof(DelegateHeapBlock), "stack storage must be able to hold a heap block");
+
     DelegateStackStorage() = default;
 
-    std::byte data[StackSize];
+    alignas(void*) std::byte data[StackSize];
+};
+
+// Per target type table of storage operations. A null entry selects the trivial path.
+struct DelegateOps
+{
+    // Moves the payload from src to dst and ends its lifetime in src; null means memcpy of the storage.
+    void (*relocate)(std::byte* dst, std::byte* src);
+    // Ends the payload lifetime and frees its heap block; null means nothing to do.
+    void (*destroy)(std::byte* storage);
+    // Copy constructs the payload into dst; null means the payload is not copyable.
+    void (*copy)(std::byte* dst, const std::byte* src);
+    std::size_t heapSize;
+};
+
+// Placement of a Delegate payload: inside the stack storage when it fits, is not over aligned and can be moved
+// without throwing, so that Delegate moves remain noexcept, and in a heap block from the given resource
+// otherwise. The location is known per target type at compile time, so the invoker resolves it without a branch.
+template<std::size_t StackSize>
+struct DelegateSmallStorage
+{
+    using StackStorage = DelegateStackStorage<StackSize>;
+
+    // Packed payloads are laid out in multiples of it, see DelegateVector.
+    static constexpr std::size_t kAlignment = alignof(StackStorage);
+
+    template<typename TSavedArgsTuple>
+    static constexpr bool IsStoredOnHeap()
+    {
+        return sizeof(TSavedArgsTuple) > StackSize || alignof(TSavedArgsTuple) > kAlignment
+            || !std::is_nothrow_move_constructible_v<TSavedArgsTuple>;
+    }
+
+    static DelegateHeapBlock GetHeapBlock(const std::byte* storage)
+    {
+        DelegateHeapBlock block;
+        std::memcpy(&block, storage, sizeof(block));
+        return block;
+    }
+
+    template<typename TSavedArgsTuple>
+    static TSavedArgsTuple& GetSavedArgs(std::byte* storage)
+    {
+        if constexpr (IsStoredOnHeap<TSavedArgsTuple>())
+        {
+            return *std::launder(reinterpret_cast<TSavedArgsTuple*>(GetHeapBlock(storage).data));
+        }
+        else
+        {
+            return *std::launder(reinterpret_cast<TSavedArgsTuple*>(storage));
+        }
+    }
+
+    template<typename TSavedArgsTuple, typename... TCtorArgs>
+    static void ConstructSavedArgs(std::byte* storage, std::pmr::memory_resource* resource, TCtorArgs&&... ctorArgs)
+    {
+        if constexpr (IsStoredOnHeap<TSavedArgsTuple>())
+        {
+            DelegateAllocation allocation(resource, sizeof(TSavedArgsTuple), alignof(TSavedArgsTuple));
+            new (allocation.Get()) TSavedArgsTuple(std::forward<TCtorArgs>(ctorArgs)...);
+
+            const DelegateHeapBlock block = {allocation.Release(), resource};
+            std::memcpy(storage, &block, sizeof(block));
+        }
+        else
+        {
+            new (storage) TSavedArgsTuple(std::forward<TCtorArgs>(ctorArgs)...);
+        }
+    }
+
+    template<typename TSavedArgsTuple>
+    static void DestroySavedArgs(std::byte* storage)
+    {
+        GetSavedArgs<TSavedArgsTuple>(storage).~TSavedArgsTuple();
+
+        if constexpr (IsStoredOnHeap<TSavedArgsTuple>())
+        {
+            const DelegateHeapBlock block = GetHeapBlock(storage);
+            DelegateDeallocate(block.resource, block.data, sizeof(TSavedArgsTuple), alignof(TSavedArgsTuple));
+        }
+    }
+
+    template<typename TSavedArgsTuple>
+    static void CopySavedArgs(std::byte* dst, const std::byte* src)
+    {
+        std::pmr::memory_resource* resource = nullptr;
+        if constexpr (IsStoredOnHeap<TSavedArgsTuple>())
+        {
+            resource = GetHeapBlock(src).resource;
+        }
+
+        ConstructSavedArgs<TSavedArgsTuple>(dst, resource, GetSavedArgs<TSavedArgsTuple>(const_cast<std::byte*>(src)));
+    }
 };
 
-struct DelegateHeapStorage
+// Placement of an InplaceDelegate payload: always inside the object, which only accepts payloads that fit.
+template<std::size_t Alignment>
+struct DelegateInplaceStorage
 {
-    DelegateHeapStorage(std::size_t size)
-        : size(size)
-        , data(std::make_unique<std::byte[]>(size))
+    static constexpr std::size_t kAlignment = Alignment;
+
+    template<typename TSavedArgsTuple>
+    static constexpr bool IsStoredOnHeap()
+    {
+        return false;
+    }
+
+    template<typename TSavedArgsTuple>
+    static TSavedArgsTuple& GetSavedArgs(std::byte* storage)
+    {
+        return *std::launder(reinterpret_cast<TSavedArgsTuple*>(storage));
+    }
+
+    template<typename TSavedArgsTuple, typename... TCtorArgs>
+    static void ConstructSavedArgs(std::byte* storage, std::pmr::memory_resource* /*resource*/, TCtorArgs&&... ctorArgs)
+    {
+        new (storage) TSavedArgsTuple(std::forward<TCtorArgs>(ctorArgs)...);
+    }
+
+    template<typename TSavedArgsTuple>
+    static void DestroySavedArgs(std::byte* storage)
     {
+        GetSavedArgs<TSavedArgsTuple>(storage).~TSavedArgsTuple();
     }
 
-    std::unique_ptr<std::byte[]> data;
-    std::size_t size;
+    template<typename TSavedArgsTuple>
+    static void CopySavedArgs(std::byte* dst, const std::byte* src)
+    {
+        new (dst) TSavedArgsTuple(GetSavedArgs<TSavedArgsTuple>(const_cast<std::byte*>(src)));
+    }
+};
+
+// Invokers and ops tables of the bound target types of a delegate that places its payloads with TStorage, see
+// DelegateSmallStorage and DelegateInplaceStorage.
+template<typename, typename TStorage>
+struct DelegateInvokers;
+
+template<typename TReturn, typename... TArgs, typename TStorage>
+struct DelegateInvokers<TReturn(TArgs...), TStorage>
+{
+    using InvokeFunc = TReturn (*)(std::byte* /*storage*/, TArgs... /*args*/);
+    using InvokeBatchFunc = void (*)(std::byte* /*storage*/, delegate_batch_result_t<TReturn> /*results*/, std::size_t /*count*/,
+                                     delegate_batch_arg_t<TArgs>... /*args*/);
+    using InvokeEachFunc = void (*)(std::byte* /*payloads*/, std::size_t /*count*/, TArgs... /*args*/);
+
+    // Storage operations extended with the one-shot and batched invokers of the target.
+    struct Ops : DelegateOps
+    {
+        // Moves the target and the bound arguments into the call, the payload must be destroyed afterwards.
+        InvokeFunc invokeOnce;
+        InvokeBatchFunc invokeBatch;
+        // Calls count payloads packed payloadStride bytes apart with the same arguments, see DelegateVector.
+        // Null when the arguments can not be passed more than once, e.g. rvalue reference parameters.
+        InvokeEachFunc invokeEach;
+        std::size_t payloadStride;
+    };
+
+    template<typename TSavedArgsTuple, InvokeFunc Invoker, InvokeFunc OnceInvoker>
+    static const Ops* GetOps()
+    {
+        static constexpr Ops ops = MakeOps<TSavedArgsTuple, Invoker, OnceInvoker>();
+        return &ops;
+    }
+
+    template<std::size_t FuncArgsSize, std::size_t BindArgsSize, typename TSavedArgsTuple, bool Once>
+    static TReturn Invoke(std::byte* storage, TArgs... args)
+    {
+        auto& savedArgsTuple = TStorage::template GetSavedArgs<TSavedArgsTuple>(storage);
+        SDAINEKA_DELEGATE_TIME_TARGET_CALL(TSavedArgsTuple, std::get<0>(savedArgsTuple));
+        return BoundCall::template Invoke<Once>(savedArgsTuple, std::make_index_sequence<FuncArgsSize>(),
+                                                make_index_sequence<FuncArgsSize, BindArgsSize>(), std::forward<TArgs>(args)...);
+    }
+
+    template<auto Func, std::size_t ObjectArgsSize, std::size_t BindArgsSize, typename TSavedArgsTuple, bool Once>
+    static TReturn InvokeStatic(std::byte* storage, TArgs... args)
+    {
+        SDAINEKA_DELEGATE_TIME_CALL(std::integral_constant<decltype(Func), Func>);
+        auto& savedArgsTuple = TStorage::template GetSavedArgs<TSavedArgsTuple>(storage);
+        return InvokeStaticInternal<Func, Once>(savedArgsTuple, std::make_index_sequence<ObjectArgsSize>(),
+                                                make_index_sequence<ObjectArgsSize, BindArgsSize>(), std::forward<TArgs>(args)...);
+    }
+
+private:
+    using BoundCall = DelegateBoundCall<TReturn, TArgs...>;
+
+    // Inline payloads that can be moved with memcpy and need no destructor skip the ops table calls.
+    template<typename TSavedArgsTuple>
+    static constexpr bool IsTriviallyRelocatable()
+    {
+        return TStorage::template IsStoredOnHeap<TSavedArgsTuple>() || std::is_trivially_copyable_v<TSavedArgsTuple>;
+    }
+
+    template<typename TSavedArgsTuple>
+    static void Relocate(std::byte* dst, std::byte* src)
+    {
+        auto& savedArgsTuple = TStorage::template GetSavedArgs<TSavedArgsTuple>(src);
+        new (dst) TSavedArgsTuple(std::move(savedArgsTuple));
+        savedArgsTuple.~TSavedArgsTuple();
+    }
+
+    template<InvokeFunc Invoker>
+    static void InvokeBatchImpl(std::byte* storage, delegate_batch_result_t<TReturn> results, std::size_t count,
+                                delegate_batch_arg_t<TArgs>... args)
+    {
+        const auto call = [storage](TArgs... callArgs) { return Invoker(storage, std::forward<TArgs>(callArgs)...); };
+        DelegateBatch<TReturn, TArgs...>::Run(call, results, count, args...);
+    }
+
+    // Bytes of the storage used by the payload, rounded up so that packed payloads stay aligned.
+    template<typename TSavedArgsTuple>
+    static constexpr std::size_t GetPayloadStride()
+    {
+        constexpr std::size_t size =
+            TStorage::template IsStoredOnHeap<TSavedArgsTuple>() ? sizeof(DelegateHeapBlock) : sizeof(TSavedArgsTuple);
+        return (size + TStorage::kAlignment - 1) / TStorage::kAlignment * TStorage::kAlignment;
+    }
+
+    template<typename TSavedArgsTuple, InvokeFunc Invoker>
+    static void InvokeEachImpl(std::byte* payloads, std::size_t count, TArgs... args)
+    {
+        constexpr std::size_t Stride = GetPayloadStride<TSavedArgsTuple>();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Invoker(payloads + i * Stride, args...);
+        }
+    }
+
+    template<typename TSavedArgsTuple, InvokeFunc Invoker, InvokeFunc OnceInvoker>
+    static constexpr Ops MakeOps()
+    {
+        Ops ops = {};
+        ops.invokeOnce = OnceInvoker;
+        ops.invokeBatch = &InvokeBatchImpl<Invoker>;
+        ops.payloadStride = GetPayloadStride<TSavedArgsTuple>();
+
+        if constexpr ((std::is_constructible_v<TArgs, TArgs&> && ...))
+        {
+            ops.invokeEach = &InvokeEachImpl<TSavedArgsTuple, Invoker>;
+        }
+
+        if constexpr (!IsTriviallyRelocatable<TSavedArgsTuple>())
+        {
+            ops.relocate = &Relocate<TSavedArgsTuple>;
+        }
+
+        if constexpr (TStorage::template IsStoredOnHeap<TSavedArgsTuple>() || !std::is_trivially_destructible_v<TSavedArgsTuple>)
+        {
+            ops.destroy = &TStorage::template DestroySavedArgs<TSavedArgsTuple>;
+        }
+
+        if constexpr (std::is_copy_constructible_v<TSavedArgsTuple>)
+        {
+            ops.copy = &TStorage::template CopySavedArgs<TSavedArgsTuple>;
+        }
+
+        if constexpr (TStorage::template IsStoredOnHeap<TSavedArgsTuple>())
+        {
+            ops.heapSize = sizeof(TSavedArgsTuple);
+        }
+
+        return ops;
+    }
+
+    template<auto Func, bool Once, typename TSavedArgsTuple, std::size_t... ObjectIs, std::size_t... BindIs>
+    static TReturn InvokeStaticInternal(TSavedArgsTuple& savedArgsTuple, std::index_sequence<ObjectIs...>, std::index_sequence<BindIs...>,
+                                        TArgs... args)
+    {
+        // The function is not saved, prepend it so that the indices line up.
+        using FuncTuple = decltype(std::tuple_cat(std::declval<std::tuple<decltype(Func)>>(), std::declval<TSavedArgsTuple>()));
+        if constexpr (!Once
+                      && BoundCall::template RequiresInvokeOnce<FuncTuple>(std::index_sequence<0, ObjectIs + 1 ...>(),
+                                                                           std::index_sequence<BindIs + 1 ...>()))
+        {
+            assert(!"bound arguments that can only be moved require InvokeOnce");
+            std::terminate();
+        }
+        else if constexpr (Once)
+        {
+            return std::invoke(Func, std::move(std::get<ObjectIs>(savedArgsTuple))..., std::forward<TArgs>(args)...,
+                               std::move(std::get<BindIs>(savedArgsTuple))...);
+        }
+        else
+        {
+            return std::invoke(Func, std::get<ObjectIs>(savedArgsTuple)..., std::forward<TArgs>(args)...,
+                               std::get<BindIs>(savedArgsTuple)...);
+        }
+    }
 };
 } // namespace detail
 
@@ -44,6 +334,12 @@ struct DelegateStorageStackSize
 template<typename>
 class Delegate;
 
+template<typename>
+class DelegateRef;
+
+template<typename>
+class DelegateVector;
+
 template<typename TReturn, typename... TArgs>
 class Delegate<TReturn(TArgs...)>
 {
@@ -55,41 +351,199 @@ public:
     template<typename TClass, typename... TBindArgs>
     using MemberFuncPtrConst = TReturn (TClass::*)(TArgs..., delegate_bind_arg_t<TBindArgs>...) const;
 
+    // Targets taking bound arguments over, see delegate_bind_once_arg_t.
+    template<typename... TBindArgs>
+    using OnceGlobalFuncPtr = TReturn (*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using OnceMemberFuncPtr = TReturn (TClass::*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using OnceMemberFuncPtrConst = TReturn (TClass::*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...) const;
+
+private:
+    // The one-shot factory overloads only exist where they differ from the regular ones.
+    template<typename... TBindArgs>
+    static constexpr bool HasOnceTarget()
+    {
+        return !std::is_same_v<GlobalFuncPtr<TBindArgs...>, OnceGlobalFuncPtr<TBindArgs...>>;
+    }
+
 public:
     Delegate() = default;
 
     Delegate(const Delegate&) = delete;
     Delegate& operator=(const Delegate&) = delete;
-    Delegate(Delegate&&) noexcept = default;
-    Delegate& operator=(Delegate&&) noexcept = default;
+
+    Delegate(Delegate&& other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    Delegate& operator=(Delegate&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Release();
+            MoveFrom(other);
+        }
+
+        return *this;
+    }
+
+    ~Delegate()
+    {
+        Release();
+    }
 
     template<typename... TBindArgs>
     static Delegate CreateGlobal(GlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
     {
-        return Delegate(GlobalFuncTag{}, func, std::move(bindArgs)...);
+        return Delegate(GlobalFuncTag{}, nullptr, func, std::move(bindArgs)...);
     }
 
     template<typename TClass, typename... TBindArgs>
     static Delegate CreateMember(TClass* cls, MemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
     {
-        return Delegate(MemberFuncTag{}, cls, func, std::move(bindArgs)...);
+        return Delegate(MemberFuncTag{}, nullptr, cls, func, std::move(bindArgs)...);
     }
 
     template<typename TClass, typename... TBindArgs>
     static Delegate CreateMember(const TClass* cls, MemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
     {
-        return Delegate(MemberFuncTag{}, cls, func, std::move(bindArgs)...);
+        return Delegate(MemberFuncTag{}, nullptr, cls, func, std::move(bindArgs)...);
     }
 
-    template<typename TFunc, typename... TBindArgs>
+    // Targets that take bound arguments over, only callable with InvokeOnce().
+    template<typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static Delegate CreateGlobal(OnceGlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Delegate(GlobalFuncTag{}, nullptr, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static Delegate CreateMember(TClass* cls, OnceMemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Delegate(MemberFuncTag{}, nullptr, cls, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static Delegate CreateMember(const TClass* cls, OnceMemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Delegate(MemberFuncTag{}, nullptr, cls, func, std::move(bindArgs)...);
+    }
+
+    template<typename TFunc, typename... TBindArgs, std::enable_if_t<!detail::is_allocator_arg_v<TFunc>, int> = 0>
     static Delegate CreateLambda(TFunc&& func, TBindArgs... bindArgs)
     {
-        return Delegate(LambdaFuncTag{}, std::forward<TFunc>(func), std::move(bindArgs)...);
+        return Delegate(LambdaFuncTag{}, nullptr, std::forward<TFunc>(func), std::move(bindArgs)...);
+    }
+
+    // Binds a target known at compile time, so only the bind arguments are stored and the invoker calls the target
+    // directly. For a member function the first bind argument is the object pointer, e.g. Create<&Bar::add_2>(&bar, 5).
+    template<auto Func, typename... TBindArgs, std::enable_if_t<!detail::starts_with_allocator_arg_v<TBindArgs...>, int> = 0>
+    static Delegate Create(TBindArgs... bindArgs)
+    {
+        return Delegate(StaticFuncTag<Func>{}, nullptr, std::move(bindArgs)...);
     }
 
-    TReturn operator()(TArgs... args) const
+    // Overloads taking a memory resource for bound arguments that do not fit into the stack storage,
+    // e.g. DelegatePoolResource::Get() or a per-frame std::pmr::monotonic_buffer_resource.
+    // The resource must outlive the delegate and all of its clones.
+    template<typename... TBindArgs>
+    static Delegate CreateGlobal(std::allocator_arg_t, std::pmr::memory_resource* resource, GlobalFuncPtr<TBindArgs...> func,
+                                 TBindArgs... bindArgs)
     {
-        return m_invoker(GetData(), std::forward<TArgs>(args)...);
+        return Delegate(GlobalFuncTag{}, resource, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs>
+    static Delegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, TClass* cls,
+                                 MemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Delegate(MemberFuncTag{}, resource, cls, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs>
+    static Delegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, const TClass* cls,
+                                 MemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Delegate(MemberFuncTag{}, resource, cls, func, std::move(bindArgs)...);
+    }
+
+    template<typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static Delegate CreateGlobal(std::allocator_arg_t, std::pmr::memory_resource* resource, OnceGlobalFuncPtr<TBindArgs...> func,
+                                 TBindArgs... bindArgs)
+    {
+        return Delegate(GlobalFuncTag{}, resource, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static Delegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, TClass* cls,
+                                 OnceMemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Delegate(MemberFuncTag{}, resource, cls, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static Delegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, const TClass* cls,
+                                 OnceMemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Delegate(MemberFuncTag{}, resource, cls, func, std::move(bindArgs)...);
+    }
+
+    template<typename TFunc, typename... TBindArgs>
+    static Delegate CreateLambda(std::allocator_arg_t, std::pmr::memory_resource* resource, TFunc&& func, TBindArgs... bindArgs)
+    {
+        return Delegate(LambdaFuncTag{}, resource, std::forward<TFunc>(func), std::move(bindArgs)...);
+    }
+
+    template<auto Func, typename... TBindArgs>
+    static Delegate Create(std::allocator_arg_t, std::pmr::memory_resource* resource, TBindArgs... bindArgs)
+    {
+        return Delegate(StaticFuncTag<Func>{}, resource, std::move(bindArgs)...);
+    }
+
+    TReturn operator()(TArgs... args) const&
+    {
+        return m_invoker(const_cast<std::byte*>(m_storage.data), std::forward<TArgs>(args)...);
+    }
+
+    // Calling an rvalue delegate is a one-shot call, see InvokeOnce().
+    TReturn operator()(TArgs... args) &&
+    {
+        return InvokeOnce(std::forward<TArgs>(args)...);
+    }
+
+    // Calls the target with the target object and the bound arguments moved out of the delegate, which is
+    // empty afterwards, also when the target throws. A bound argument that the target takes by value or by
+    // rvalue reference, see DelegateBindArg, is handed over without a copy. Targets whose bound arguments can
+    // only be moved must be called this way.
+    TReturn InvokeOnce(TArgs... args)
+    {
+        const ReleaseOnExit release{this};
+        return m_ops->invokeOnce(m_storage.data, std::forward<TArgs>(args)...);
+    }
+
+    // Calls the delegate count times, the i-th call receiving the i-th element of every argument array. The
+    // loop is generated per bound target type and reached through a single indirect call, so a lambda or a
+    // Create<Func>() target is inlined into it.
+    void InvokeBatch(std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const
+    {
+        m_ops->invokeBatch(const_cast<std::byte*>(m_storage.data), nullptr, count, args...);
+    }
+
+    // As above, storing the result of the i-th call to results[i].
+    template<typename TResult = TReturn, std::enable_if_t<std::is_object_v<TResult>, int> = 0>
+    void InvokeBatch(TResult* results, std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const
+    {
+        m_ops->invokeBatch(const_cast<std::byte*>(m_storage.data), results, count, args...);
+    }
+
+    // Calls the delegate for every element of a contiguous range, e.g. a std::vector or an array.
+    template<typename TRange>
+    void ForEach(TRange&& range) const
+    {
+        static_assert(sizeof...(TArgs) == 1, "ForEach requires a delegate taking a single argument");
+        InvokeBatch(std::size(range), std::data(range));
     }
 
     operator bool() const
@@ -97,14 +551,30 @@ public:
         return m_invoker != nullptr;
     }
 
-    std::size_t GetHeapSize() const
+    // True when the bound target and arguments are copy constructible, see Clone().
+    bool IsCopyable() const
+    {
+        return m_ops != nullptr && m_ops->copy != nullptr;
+    }
+
+    // Returns a copy of this delegate, or an empty delegate if it is empty or not copyable.
+    Delegate Clone() const
     {
-        if (const auto* heapData = std::get_if<HeapStorage>(&m_storage))
+        Delegate result;
+
+        if (IsCopyable())
         {
-            return heapData->size;
+            m_ops->copy(result.m_storage.data, m_storage.data);
+            result.m_invoker = m_invoker;
+            result.m_ops = m_ops;
         }
 
-        return 0;
+        return result;
+    }
+
+    std::size_t GetHeapSize() const
+    {
+        return m_ops != nullptr ? m_ops->heapSize : 0;
     }
 
     static constexpr std::size_t GetStorageStackSize()
@@ -113,84 +583,116 @@ public:
     }
 
 private:
+    friend class DelegateRef<TReturn(TArgs...)>;
+    friend class DelegateVector<TReturn(TArgs...)>;
+
     struct GlobalFuncTag
     {};
     struct MemberFuncTag
     {};
     struct LambdaFuncTag
     {};
+    template<auto Func>
+    struct StaticFuncTag
+    {};
 
-    template<typename TSavedArgsTuple>
-    void Construct(TSavedArgsTuple&& v)
+    using Storage = detail::DelegateSmallStorage<DelegateStorageStackSize<TReturn(TArgs...)>::size()>;
+    using Invokers = detail::DelegateInvokers<TReturn(TArgs...), Storage>;
+    using InvokeFunc = typename Invokers::InvokeFunc;
+    using Ops = typename Invokers::Ops;
+
+    struct ReleaseOnExit
     {
-        if constexpr (sizeof(TSavedArgsTuple) > GetStorageStackSize())
+        ~ReleaseOnExit()
         {
-            m_storage.template emplace<HeapStorage>(sizeof(TSavedArgsTuple));
+            delegate->Release();
         }
 
-        new (GetData()) TSavedArgsTuple(std::forward<TSavedArgsTuple>(v));
-    }
+        Delegate* delegate;
+    };
 
-    template<typename... TBindArgs>
-    Delegate(GlobalFuncTag, GlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
-        : m_invoker(Invoke<1, sizeof...(TBindArgs), std::tuple<GlobalFuncPtr<TBindArgs...>, TBindArgs...>>)
+    template<typename TSavedArgsTuple, InvokeFunc Invoker, InvokeFunc OnceInvoker, typename... TCtorArgs>
+    void Construct(std::pmr::memory_resource* resource, TCtorArgs&&... ctorArgs)
     {
-        Construct(std::make_tuple(func, std::move(bindArgs)...));
+        Storage::template ConstructSavedArgs<TSavedArgsTuple>(m_storage.data, resource, std::forward<TCtorArgs>(ctorArgs)...);
+        SDAINEKA_DELEGATE_RECORD_STORAGE(Delegate, GetStorageStackSize(), sizeof(TSavedArgsTuple),
+                                         Storage::template IsStoredOnHeap<TSavedArgsTuple>(), sizeof(TSavedArgsTuple));
+
+        m_invoker = Invoker;
+        m_ops = Invokers::template GetOps<TSavedArgsTuple, Invoker, OnceInvoker>();
     }
 
-    template<typename TClass, typename... TBindArgs>
-    Delegate(MemberFuncTag, TClass* cls, MemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
-        : m_invoker(Invoke<2, sizeof...(TBindArgs), std::tuple<MemberFuncPtr<TClass, TBindArgs...>, TClass*, TBindArgs...>>)
+    void MoveFrom(Delegate& other)
     {
-        Construct(std::make_tuple(func, cls, std::move(bindArgs)...));
+        if (other.m_ops != nullptr && other.m_ops->relocate != nullptr)
+        {
+            other.m_ops->relocate(m_storage.data, other.m_storage.data);
+        }
+        else
+        {
+            std::memcpy(m_storage.data, other.m_storage.data, sizeof(m_storage.data));
+        }
+
+        m_invoker = other.m_invoker;
+        m_ops = other.m_ops;
+
+        other.m_invoker = nullptr;
+        other.m_ops = nullptr;
     }
 
-    template<typename TClass, typename... TBindArgs>
-    Delegate(MemberFuncTag, const TClass* cls, MemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
-        : m_invoker(Invoke<2, sizeof...(TBindArgs), std::tuple<MemberFuncPtrConst<TClass, TBindArgs...>, const TClass*, TBindArgs...>>)
+    void Release()
     {
-        Construct(std::make_tuple(func, cls, std::move(bindArgs)...));
+        if (m_ops != nullptr && m_ops->destroy != nullptr)
+        {
+            m_ops->destroy(m_storage.data);
+        }
+
+        m_invoker = nullptr;
+        m_ops = nullptr;
     }
 
-    template<typename TFunc, typename... TBindArgs>
-    Delegate(LambdaFuncTag, TFunc&& func, TBindArgs... bindArgs)
-        : m_invoker(Invoke<1, sizeof...(TBindArgs), std::tuple<TFunc, TBindArgs...>>)
+    template<typename TFuncPtr, typename... TBindArgs>
+    Delegate(GlobalFuncTag, std::pmr::memory_resource* resource, TFuncPtr func, TBindArgs... bindArgs)
     {
-        Construct(std::make_tuple(std::forward<TFunc>(func), std::move(bindArgs)...));
+        using SavedArgsTuple = std::tuple<TFuncPtr, TBindArgs...>;
+        Construct<SavedArgsTuple, Invokers::template Invoke<1, sizeof...(TBindArgs), SavedArgsTuple, false>,
+                  Invokers::template Invoke<1, sizeof...(TBindArgs), SavedArgsTuple, true>>(resource, func, std::move(bindArgs)...);
     }
 
-private:
-    using StackStorage = detail::DelegateStackStorage<GetStorageStackSize()>;
-    using HeapStorage = detail::DelegateHeapStorage;
-
-    using InvokeFunc = TReturn (*)(std::byte* /*data*/, TArgs... /*args*/);
-    InvokeFunc m_invoker = nullptr;
-
-    template<std::size_t FuncArgsSize, std::size_t BindArgsSize, typename TSavedArgsTuple>
-    static TReturn Invoke(std::byte* data, TArgs... args)
+    // TClass is const for const member functions.
+    template<typename TClass, typename TFuncPtr, typename... TBindArgs>
+    Delegate(MemberFuncTag, std::pmr::memory_resource* resource, TClass* cls, TFuncPtr func, TBindArgs... bindArgs)
     {
-        auto& savedArgsTuple = *reinterpret_cast<TSavedArgsTuple*>(data);
-        return InvokeInternal(savedArgsTuple, std::make_index_sequence<FuncArgsSize>(),
-                              detail::make_index_sequence<FuncArgsSize, BindArgsSize>(), std::forward<TArgs>(args)...);
+        using SavedArgsTuple = std::tuple<TFuncPtr, TClass*, TBindArgs...>;
+        Construct<SavedArgsTuple, Invokers::template Invoke<2, sizeof...(TBindArgs), SavedArgsTuple, false>,
+                  Invokers::template Invoke<2, sizeof...(TBindArgs), SavedArgsTuple, true>>(resource, func, cls, std::move(bindArgs)...);
     }
 
-    template<typename TSavedArgsTuple, std::size_t... FuncIs, std::size_t... BindIs>
-    static TReturn InvokeInternal(TSavedArgsTuple& savedArgsTuple, std::index_sequence<FuncIs...>, std::index_sequence<BindIs...>,
-                                  TArgs... args)
+    template<typename TFunc, typename... TBindArgs>
+    Delegate(LambdaFuncTag, std::pmr::memory_resource* resource, TFunc&& func, TBindArgs... bindArgs)
     {
-        return std::invoke(std::get<FuncIs>(savedArgsTuple)..., std::forward<TArgs>(args)..., std::get<BindIs>(savedArgsTuple)...);
+        using SavedArgsTuple = std::tuple<std::decay_t<TFunc>, TBindArgs...>;
+        Construct<SavedArgsTuple, Invokers::template Invoke<1, sizeof...(TBindArgs), SavedArgsTuple, false>,
+                  Invokers::template Invoke<1, sizeof...(TBindArgs), SavedArgsTuple, true>>(resource, std::forward<TFunc>(func),
+                                                                                             std::move(bindArgs)...);
     }
 
-    std::byte* GetData(std::size_t offset = 0) const
+    template<auto Func, typename... TBindArgs>
+    Delegate(StaticFuncTag<Func>, std::pmr::memory_resource* resource, TBindArgs... bindArgs)
     {
-        if (auto* stack = std::get_if<StackStorage>(&m_storage))
-        {
-            return const_cast<std::byte*>(&stack->data[offset]);
-        }
-
-        return std::get<HeapStorage>(m_storage).data.get() + offset;
+        // The object pointer of a member function target is saved in front of the bind arguments.
+        constexpr std::size_t ObjectArgsSize = std::is_member_pointer_v<decltype(Func)> ? 1 : 0;
+        static_assert(sizeof...(TBindArgs) >= ObjectArgsSize, "member function targets need an object pointer");
+
+        using SavedArgsTuple = std::tuple<TBindArgs...>;
+        constexpr std::size_t BindArgsSize = sizeof...(TBindArgs) - ObjectArgsSize;
+        Construct<SavedArgsTuple, Invokers::template InvokeStatic<Func, ObjectArgsSize, BindArgsSize, SavedArgsTuple, false>,
+                  Invokers::template InvokeStatic<Func, ObjectArgsSize, BindArgsSize, SavedArgsTuple, true>>(resource,
+                                                                                                             std::move(bindArgs)...);
     }
 
-    std::variant<StackStorage, HeapStorage> m_storage;
+    InvokeFunc m_invoker = nullptr;
+    const Ops* m_ops = nullptr;
+    typename Storage::StackStorage m_storage;
 };
 } // namespace sdaineka
\ No newline at end of file
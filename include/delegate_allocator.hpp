@@ -0,0 +1,611 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sdaineka
+{
+namespace detail
+{
+// Keeps forwarding-reference factories from claiming the std::allocator_arg overloads.
+template<typename T>
+constexpr bool is_allocator_arg_v = std::is_same_v<std::decay_t<T>, std::allocator_arg_t>;
+
+template<typename... Ts>
+constexpr bool starts_with_allocator_arg_v = false;
+
+template<typename T, typename... Ts>
+constexpr bool starts_with_allocator_arg_v<T, Ts...> = is_allocator_arg_v<T>;
+
+// A null resource selects the global aligned operator new/delete.
+inline std::byte* DelegateAllocate(std::pmr::memory_resource* resource, std::size_t size, std::size_t alignment)
+{
+    if (resource != nullptr)
+    {
+        return static_cast<std::byte*>(resource->allocate(size, alignment));
+    }
+
+    return static_cast<std::byte*>(::operator new(size, std::align_val_t{alignment}));
+}
+
+inline void DelegateDeallocate(std::pmr::memory_resource* resource, std::byte* data, std::size_t size, std::size_t alignment)
+{
+    if (resource != nullptr)
+    {
+        resource->deallocate(data, size, alignment);
+        return;
+    }
+
+    ::operator delete(data, size, std::align_val_t{alignment});
+}
+
+// Owns a raw block until Release(), so that a throwing payload constructor does not leak it.
+class DelegateAllocation
+{
+public:
+    DelegateAllocation(std::pmr::memory_resource* resource, std::size_t size, std::size_t alignment)
+        : m_resource(resource)
+        , m_size(size)
+        , m_alignment(alignment)
+        , m_data(DelegateAllocate(resource, size, alignment))
+    {
+    }
+
+    DelegateAllocation(const DelegateAllocation&) = delete;
+    DelegateAllocation& operator=(const DelegateAllocation&) = delete;
+
+    ~DelegateAllocation()
+    {
+        if (m_data != nullptr)
+        {
+            DelegateDeallocate(m_resource, m_data, m_size, m_alignment);
+        }
+    }
+
+    std::byte* Get() const
+    {
+        return m_data;
+    }
+
+    std::byte* Release()
+    {
+        return std::exchange(m_data, nullptr);
+    }
+
+private:
+    std::pmr::memory_resource* m_resource;
+    std::size_t m_size;
+    std::size_t m_alignment;
+    std::byte* m_data;
+};
+} // namespace detail
+
+// Process wide size-class pool for delegate storage.
+//
+// Blocks up to kMaxBlockSize bytes are served from per-thread free lists without locking. Threads exchange
+// blocks with a shared depot in batches, so a delegate may be destroyed on a different thread than the one
+// that created it. Memory is carved from upstream chunks that are kept for the lifetime of the process.
+// For per-frame or per-request delegates that are freed in bulk, a std::pmr::monotonic_buffer_resource can
+// be passed to the factories instead.
+class DelegatePoolResource final : public std::pmr::memory_resource
+{
+public:
+    static constexpr std::size_t kGranularity = 16;
+    static constexpr std::size_t kMaxBlockSize = 256;
+
+    static DelegatePoolResource* Get()
+    {
+        // Intentionally never destroyed: thread caches flush into it while threads and statics are torn down.
+        static DelegatePoolResource* instance = new DelegatePoolResource(std::pmr::new_delete_resource());
+        return instance;
+    }
+
+private:
+    static constexpr std::size_t kSizeClassCount = kMaxBlockSize / kGranularity;
+    static constexpr std::size_t kBatchSize = 32;
+    static constexpr std::size_t kMaxCachedBlocks = 2 * kBatchSize;
+    static constexpr std::size_t kChunkSize = 64 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct FreeList
+    {
+        FreeBlock* head = nullptr;
+        std::size_t count = 0;
+
+        void Push(void* ptr)
+        {
+            head = new (ptr) FreeBlock{head};
+            ++count;
+        }
+
+        void* Pop()
+        {
+            FreeBlock* block = head;
+            head = block->next;
+            --count;
+            return block;
+        }
+    };
+
+    struct ThreadCache
+    {
+        ~ThreadCache()
+        {
+            for (std::size_t sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++)
+            {
+                Get()->ReturnToDepot(sizeClass, lists[sizeClass], lists[sizeClass].count);
+            }
+        }
+
+        FreeList lists[kSizeClassCount];
+    };
+
+    explicit DelegatePoolResource(std::pmr::memory_resource* upstream)
+        : m_upstream(upstream)
+    {
+    }
+
+    static bool IsPooled(std::size_t bytes, std::size_t alignment)
+    {
+        return bytes <= kMaxBlockSize && alignment <= kGranularity;
+    }
+
+    static std::size_t GetSizeClass(std::size_t bytes)
+    {
+        return bytes == 0 ? 0 : (bytes - 1) / kGranularity;
+    }
+
+    static FreeList& GetThreadList(std::size_t sizeClass)
+    {
+        thread_local ThreadCache cache;
+        return cache.lists[sizeClass];
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (!IsPooled(bytes, alignment))
+        {
+            return m_upstream->allocate(bytes, alignment);
+        }
+
+        const std::size_t sizeClass = GetSizeClass(bytes);
+        FreeList& list = GetThreadList(sizeClass);
+
+        if (list.head == nullptr)
+        {
+            Refill(sizeClass, list);
+        }
+
+        return list.Pop();
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        if (!IsPooled(bytes, alignment))
+        {
+            m_upstream->deallocate(ptr, bytes, alignment);
+            return;
+        }
+
+        const std::size_t sizeClass = GetSizeClass(bytes);
+        FreeList& list = GetThreadList(sizeClass);
+
+        list.Push(ptr);
+
+        if (list.count > kMaxCachedBlocks)
+        {
+            ReturnToDepot(sizeClass, list, kBatchSize);
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    void Refill(std::size_t sizeClass, FreeList& list)
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        FreeList& depot = m_depot[sizeClass];
+        while (depot.head != nullptr && list.count < kBatchSize)
+        {
+            list.Push(depot.Pop());
+        }
+
+        const std::size_t blockSize = (sizeClass + 1) * kGranularity;
+        while (list.count < kBatchSize)
+        {
+            if (static_cast<std::size_t>(m_chunkEnd - m_chunkCursor) < blockSize)
+            {
+                m_chunkCursor = static_cast<std::byte*>(m_upstream->allocate(kChunkSize, kGranularity));
+                m_chunkEnd = m_chunkCursor + kChunkSize;
+            }
+
+            list.Push(m_chunkCursor);
+            m_chunkCursor += blockSize;
+        }
+    }
+
+    void ReturnToDepot(std::size_t sizeClass, FreeList& list, std::size_t count)
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        FreeList& depot = m_depot[sizeClass];
+        for (std::size_t i = 0; i < count && list.head != nullptr; i++)
+        {
+            depot.Push(list.Pop());
+        }
+    }
+
+    std::pmr::memory_resource* m_upstream;
+
+    std::mutex m_mutex;
+    FreeList m_depot[kSizeClassCount];
+    std::byte* m_chunkCursor = nullptr;
+    std::byte* m_chunkEnd = nullptr;
+};
+
+// Process wide slab allocator, the default storage of SimpleHeapDelegate.
+//
+// Every block size gets its own slabs, so storages of one target type are packed next to each other and
+// creating and destroying delegates at a high rate does not fragment the general heap. Blocks are served
+// from per-thread free lists without locking, threads exchange them with the block size's pool in
+// batches, so a delegate may be destroyed on a different thread than the one that created it. Slabs are
+// aligned to their size and find their header by masking a block address, which lets the pool tell when
+// all blocks of a slab are free again. Such slabs are kept for reuse until Trim() releases them in bulk;
+// blocks cached by other threads keep their slabs alive.
+class DelegateSlabResource final : public std::pmr::memory_resource
+{
+public:
+    static constexpr std::size_t kGranularity = alignof(void*);
+    static constexpr std::size_t kMaxBlockSize = 1024;
+    static constexpr std::size_t kMaxAlignment = 16;
+    static constexpr std::size_t kSlabSize = 16 * 1024;
+
+    // Counters of one block size. Allocations and deallocations are added when a thread exchanges a
+    // batch with the pool, calls Trim() or exits.
+    struct Stats
+    {
+        std::size_t blockSize;
+        std::size_t blocksPerSlab;
+        std::size_t slabs;
+        std::size_t freeBlocks;
+        std::uint64_t slabsAllocated;
+        std::uint64_t slabsReleased;
+        std::uint64_t allocations;
+        std::uint64_t deallocations;
+    };
+
+    static DelegateSlabResource* Get()
+    {
+        // Intentionally never destroyed: thread caches flush into it while threads and statics are torn down.
+        static DelegateSlabResource* instance = new DelegateSlabResource(std::pmr::new_delete_resource());
+        return instance;
+    }
+
+    DelegateSlabResource(const DelegateSlabResource&) = delete;
+    DelegateSlabResource& operator=(const DelegateSlabResource&) = delete;
+
+    // Block sizes that have been used so far.
+    std::vector<Stats> GetStats()
+    {
+        std::vector<Stats> stats;
+        for (std::size_t sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++)
+        {
+            Pool& pool = m_pools[sizeClass];
+            const std::lock_guard<std::mutex> lock(pool.mutex);
+
+            if (pool.slabsAllocated != 0)
+            {
+                const std::size_t blockSize = GetBlockSize(sizeClass);
+                stats.push_back({blockSize, GetBlocksPerSlab(blockSize), pool.slabs, pool.freeBlocks, pool.slabsAllocated,
+                                 pool.slabsReleased, pool.allocations, pool.deallocations});
+            }
+        }
+
+        return stats;
+    }
+
+    // Returns the blocks cached by the calling thread to their pools and releases every slab whose blocks
+    // are all free to the upstream resource. Returns the number of released slabs.
+    std::size_t Trim()
+    {
+        ThreadCache& cache = GetThreadCache();
+        for (std::size_t sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++)
+        {
+            ReturnToPool(sizeClass, cache.lists[sizeClass], cache.lists[sizeClass].count);
+        }
+
+        std::size_t released = 0;
+        for (std::size_t sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++)
+        {
+            Pool& pool = m_pools[sizeClass];
+            const std::size_t blocksPerSlab = GetBlocksPerSlab(GetBlockSize(sizeClass));
+
+            const std::lock_guard<std::mutex> lock(pool.mutex);
+            Slab* slab = pool.partial;
+            while (slab != nullptr)
+            {
+                Slab* next = slab->next;
+                if (slab->freeCount == blocksPerSlab)
+                {
+                    Unlink(pool, slab);
+                    pool.freeBlocks -= blocksPerSlab;
+                    --pool.slabs;
+                    ++pool.slabsReleased;
+                    m_upstream->deallocate(slab, kSlabSize, kSlabSize);
+                    ++released;
+                }
+                slab = next;
+            }
+        }
+
+        return released;
+    }
+
+private:
+    static constexpr std::size_t kSizeClassCount = kMaxBlockSize / kGranularity;
+    static constexpr std::size_t kBatchSize = 32;
+    static constexpr std::size_t kMaxCachedBlocks = 2 * kBatchSize;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    // Header at the start of every slab, followed by its blocks.
+    struct Slab
+    {
+        FreeBlock* free;
+        std::size_t freeCount;
+        // Neighbours in the pool's list of slabs with free blocks.
+        Slab* prev;
+        Slab* next;
+    };
+
+    static constexpr std::size_t kSlabHeaderSize = (sizeof(Slab) + kMaxAlignment - 1) / kMaxAlignment * kMaxAlignment;
+
+    struct Pool
+    {
+        std::mutex mutex;
+        Slab* partial = nullptr;
+        std::size_t slabs = 0;
+        std::size_t freeBlocks = 0;
+        std::uint64_t slabsAllocated = 0;
+        std::uint64_t slabsReleased = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t deallocations = 0;
+    };
+
+    struct FreeList
+    {
+        FreeBlock* head = nullptr;
+        std::size_t count = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t deallocations = 0;
+
+        void Push(void* ptr)
+        {
+            head = new (ptr) FreeBlock{head};
+            ++count;
+        }
+
+        void* Pop()
+        {
+            FreeBlock* block = head;
+            head = block->next;
+            --count;
+            return block;
+        }
+    };
+
+    struct ThreadCache
+    {
+        ~ThreadCache()
+        {
+            for (std::size_t sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++)
+            {
+                Get()->ReturnToPool(sizeClass, lists[sizeClass], lists[sizeClass].count);
+            }
+        }
+
+        FreeList lists[kSizeClassCount];
+    };
+
+    explicit DelegateSlabResource(std::pmr::memory_resource* upstream)
+        : m_upstream(upstream)
+    {
+    }
+
+    // Blocks are a multiple of their alignment, which keeps every block of a slab aligned.
+    static std::size_t GetAlignedSize(std::size_t bytes, std::size_t alignment)
+    {
+        return (std::max<std::size_t>(bytes, 1) + alignment - 1) / alignment * alignment;
+    }
+
+    static bool IsSlabbed(std::size_t bytes, std::size_t alignment)
+    {
+        return alignment <= kMaxAlignment && GetAlignedSize(bytes, alignment) <= kMaxBlockSize;
+    }
+
+    static std::size_t GetSizeClass(std::size_t bytes, std::size_t alignment)
+    {
+        return (GetAlignedSize(bytes, alignment) + kGranularity - 1) / kGranularity - 1;
+    }
+
+    static constexpr std::size_t GetBlockSize(std::size_t sizeClass)
+    {
+        return (sizeClass + 1) * kGranularity;
+    }
+
+    static constexpr std::size_t GetBlocksPerSlab(std::size_t blockSize)
+    {
+        return (kSlabSize - kSlabHeaderSize) / blockSize;
+    }
+
+    static Slab* GetSlab(void* block)
+    {
+        return reinterpret_cast<Slab*>(reinterpret_cast<std::uintptr_t>(block) & ~(kSlabSize - 1));
+    }
+
+    static ThreadCache& GetThreadCache()
+    {
+        thread_local ThreadCache cache;
+        return cache;
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (!IsSlabbed(bytes, alignment))
+        {
+            return m_upstream->allocate(bytes, alignment);
+        }
+
+        const std::size_t sizeClass = GetSizeClass(bytes, alignment);
+        FreeList& list = GetThreadCache().lists[sizeClass];
+
+        if (list.head == nullptr)
+        {
+            Refill(sizeClass, list);
+        }
+
+        ++list.allocations;
+        return list.Pop();
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        if (!IsSlabbed(bytes, alignment))
+        {
+            m_upstream->deallocate(ptr, bytes, alignment);
+            return;
+        }
+
+        const std::size_t sizeClass = GetSizeClass(bytes, alignment);
+        FreeList& list = GetThreadCache().lists[sizeClass];
+
+        list.Push(ptr);
+        ++list.deallocations;
+
+        if (list.count > kMaxCachedBlocks)
+        {
+            ReturnToPool(sizeClass, list, kBatchSize);
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    static void Link(Pool& pool, Slab* slab)
+    {
+        slab->prev = nullptr;
+        slab->next = pool.partial;
+        if (pool.partial != nullptr)
+        {
+            pool.partial->prev = slab;
+        }
+        pool.partial = slab;
+    }
+
+    static void Unlink(Pool& pool, Slab* slab)
+    {
+        (slab->prev != nullptr ? slab->prev->next : pool.partial) = slab->next;
+        if (slab->next != nullptr)
+        {
+            slab->next->prev = slab->prev;
+        }
+    }
+
+    static void FlushCounters(Pool& pool, FreeList& list)
+    {
+        pool.allocations += std::exchange(list.allocations, 0);
+        pool.deallocations += std::exchange(list.deallocations, 0);
+    }
+
+    void Refill(std::size_t sizeClass, FreeList& list)
+    {
+        Pool& pool = m_pools[sizeClass];
+        const std::size_t blockSize = GetBlockSize(sizeClass);
+
+        const std::lock_guard<std::mutex> lock(pool.mutex);
+        FlushCounters(pool, list);
+
+        while (list.count < kBatchSize)
+        {
+            if (pool.partial == nullptr)
+            {
+                Link(pool, AllocateSlab(pool, blockSize));
+            }
+
+            Slab* slab = pool.partial;
+            FreeBlock* block = slab->free;
+            slab->free = block->next;
+            --slab->freeCount;
+            --pool.freeBlocks;
+            list.Push(block);
+
+            if (slab->freeCount == 0)
+            {
+                Unlink(pool, slab);
+            }
+        }
+    }
+
+    void ReturnToPool(std::size_t sizeClass, FreeList& list, std::size_t count)
+    {
+        Pool& pool = m_pools[sizeClass];
+
+        const std::lock_guard<std::mutex> lock(pool.mutex);
+        FlushCounters(pool, list);
+
+        for (std::size_t i = 0; i < count && list.head != nullptr; i++)
+        {
+            void* ptr = list.Pop();
+            Slab* slab = GetSlab(ptr);
+
+            slab->free = new (ptr) FreeBlock{slab->free};
+            if (slab->freeCount++ == 0)
+            {
+                Link(pool, slab);
+            }
+            ++pool.freeBlocks;
+        }
+    }
+
+    // Called with the pool locked. The new slab's blocks are threaded into its free list.
+    Slab* AllocateSlab(Pool& pool, std::size_t blockSize)
+    {
+        auto* memory = static_cast<std::byte*>(m_upstream->allocate(kSlabSize, kSlabSize));
+        Slab* slab = new (memory) Slab{nullptr, 0, nullptr, nullptr};
+
+        const std::size_t blocksPerSlab = GetBlocksPerSlab(blockSize);
+        for (std::size_t i = blocksPerSlab; i-- > 0;)
+        {
+            slab->free = new (memory + kSlabHeaderSize + i * blockSize) FreeBlock{slab->free};
+        }
+        slab->freeCount = blocksPerSlab;
+
+        ++pool.slabs;
+        ++pool.slabsAllocated;
+        pool.freeBlocks += blocksPerSlab;
+        return slab;
+    }
+
+    std::pmr::memory_resource* m_upstream;
+    Pool m_pools[kSizeClassCount];
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -1,7 +1,47 @@
 #pragma once
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 
+// Define to 1 to record per target call counts and latencies, see DelegateInstrumentation. When 0 the
+// invokers are left exactly as they are.
+#ifndef SDAINEKA_DELEGATE_INSTRUMENTATION
+#define SDAINEKA_DELEGATE_INSTRUMENTATION 0
+#endif
+
+#if SDAINEKA_DELEGATE_INSTRUMENTATION
+#include "delegate_instrumentation.hpp"
+
+// Times the rest of the enclosing scope as a call of the target identified by the given type.
+#define SDAINEKA_DELEGATE_TIME_CALL(...) \
+    const ::sdaineka::detail::DelegateCallTimer delegateCallTimer(::sdaineka::detail::DelegateCallSite<__VA_ARGS__>::Get())
+
+// As above for the bound target, which is identified by its value when it is a function or member function pointer.
+#define SDAINEKA_DELEGATE_TIME_TARGET_CALL(TTarget, target) \
+    const ::sdaineka::detail::DelegateCallTimer delegateCallTimer(::sdaineka::detail::DelegateTargetSite<TTarget>::Get(target))
+#else
+#define SDAINEKA_DELEGATE_TIME_CALL(...)
+#define SDAINEKA_DELEGATE_TIME_TARGET_CALL(TTarget, target)
+#endif
+
+// Define to 1 to record a histogram of bound payload sizes per delegate type, see DelegateStorageTelemetry.
+#ifndef SDAINEKA_DELEGATE_TELEMETRY
+#define SDAINEKA_DELEGATE_TELEMETRY 0
+#endif
+
+#if SDAINEKA_DELEGATE_TELEMETRY
+#include "delegate_telemetry.hpp"
+
+#define SDAINEKA_DELEGATE_RECORD_STORAGE(TDelegate, inlineCapacity, size, onHeap, heapBytes) \
+    ::sdaineka::detail::DelegateStorageSite<TDelegate>::Record(inlineCapacity, size, onHeap, heapBytes)
+#else
+#define SDAINEKA_DELEGATE_RECORD_STORAGE(TDelegate, inlineCapacity, size, onHeap, heapBytes)
+#endif
+
 namespace sdaineka
 {
 namespace detail
@@ -17,14 +57,118 @@ constexpr auto make_index_sequence()
 {
     return add_offset<Offset>(std::make_index_sequence<N>());
 }
+
+// Element pointer for one parameter of a batched call. By-value parameters are copied from a read-only
+// array, reference parameters are bound to the elements.
+template<typename TArg>
+using delegate_batch_arg_t = std::add_pointer_t<std::conditional_t<std::is_reference_v<TArg>, std::remove_reference_t<TArg>, const TArg>>;
+
+// Destination of the results of a batched call, only object return types can be collected.
+template<typename TReturn>
+using delegate_batch_result_t = std::conditional_t<std::is_object_v<TReturn>, TReturn*, std::nullptr_t>;
+
+template<typename TReturn, typename... TArgs>
+struct DelegateBatch
+{
+    // Calls call(args[i]...) for every i in [0, count). Instantiated per target type, so a call that the
+    // compiler can see through is inlined into the loop.
+    template<typename TCall>
+    static void Run(const TCall& call, delegate_batch_result_t<TReturn> results, std::size_t count,
+                    delegate_batch_arg_t<TArgs>... args)
+    {
+        if constexpr (std::is_object_v<TReturn>)
+        {
+            if (results != nullptr)
+            {
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    results[i] = call(static_cast<TArgs>(args[i])...);
+                }
+                return;
+            }
+        }
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            call(static_cast<TArgs>(args[i])...);
+        }
+    }
+};
+
+// Call of a bound target saved as a tuple: FuncIs selects the elements that make up the target, a function
+// pointer or lambda, or a member function pointer followed by the object pointer, and BindIs the bound
+// arguments. Shared by the delegates that bind arguments.
+template<typename TReturn, typename... TArgs>
+struct DelegateBoundCall
+{
+    // Regular calls pass the saved target and bound arguments as lvalues, one-shot calls move them. A target
+    // that can not take its bound arguments as lvalues, e.g. a move-only one through an rvalue reference
+    // parameter, is always called with them moved, and only InvokeOnce() may call it: its regular invoker,
+    // also reached through DelegateRef, MulticastDelegate or InvokeBatch(), terminates in every build
+    // instead of moving out of a payload that later calls would see.
+    template<typename TSavedArgsTuple, std::size_t... FuncIs, std::size_t... BindIs>
+    static constexpr bool RequiresInvokeOnce(std::index_sequence<FuncIs...>, std::index_sequence<BindIs...>)
+    {
+        return !std::is_invocable_r_v<TReturn, std::tuple_element_t<FuncIs, TSavedArgsTuple>&..., TArgs...,
+                                      std::tuple_element_t<BindIs, TSavedArgsTuple>&...>;
+    }
+
+    template<bool Once, typename TSavedArgsTuple, std::size_t... FuncIs, std::size_t... BindIs>
+    static TReturn Invoke(TSavedArgsTuple& savedArgsTuple, std::index_sequence<FuncIs...>, std::index_sequence<BindIs...>, TArgs... args)
+    {
+        if constexpr (!Once && RequiresInvokeOnce<TSavedArgsTuple>(std::index_sequence<FuncIs...>(), std::index_sequence<BindIs...>()))
+        {
+            assert(!"bound arguments that can only be moved require InvokeOnce");
+            std::terminate();
+        }
+        else if constexpr (Once)
+        {
+            return std::invoke(std::move(std::get<FuncIs>(savedArgsTuple))..., std::forward<TArgs>(args)...,
+                               std::move(std::get<BindIs>(savedArgsTuple))...);
+        }
+        else
+        {
+            return std::invoke(std::get<FuncIs>(savedArgsTuple)..., std::forward<TArgs>(args)..., std::get<BindIs>(savedArgsTuple)...);
+        }
+    }
+};
 } // namespace detail
 
+// Parameter type through which a bound argument of type T reaches a global or member function target: by
+// value up to the size of a pointer, by const reference above it, and by rvalue reference when T can only
+// be moved, in which case the delegate must be called with InvokeOnce(). Specialize it to change the
+// convention for a type, e.g. derive from DelegateBindByValue<Buffer> so that the target copies the buffer
+// on a regular call and takes it over without a copy on InvokeOnce().
 template<typename T>
 struct DelegateBindArg
 {
-    using type = std::conditional_t<(sizeof(T) <= sizeof(void*)), T, const T&>;
+    using type = std::conditional_t<!std::is_copy_constructible_v<T>, T&&, std::conditional_t<(sizeof(T) <= sizeof(void*)), T, const T&>>;
+};
+
+template<typename T>
+struct DelegateBindByValue
+{
+    using type = T;
+};
+
+template<typename T>
+struct DelegateBindByConstRef
+{
+    using type = const T&;
+};
+
+template<typename T>
+struct DelegateBindByRvalueRef
+{
+    using type = T&&;
 };
 
 template<typename T>
 using delegate_bind_arg_t = typename DelegateBindArg<T>::type;
+
+// Parameter type of a target that takes its bound arguments over, e.g. void(std::vector<int>&&): by rvalue
+// reference for types that are not trivially copyable, as DelegateBindArg otherwise. Such targets can only
+// be called with InvokeOnce(), which hands the bound arguments over without a copy.
+template<typename T>
+using delegate_bind_once_arg_t = std::conditional_t<std::is_trivially_copyable_v<T>, delegate_bind_arg_t<T>, T&&>;
 } // namespace sdaineka
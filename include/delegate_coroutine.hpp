@@ -0,0 +1,632 @@
+#pragma once
+#include "delegate.hpp"
+#include "delegate_allocator.hpp"
+#include "multicast_delegate.hpp"
+
+// Coroutine integration, available when compiling as C++20 with coroutine support, e.g. the `coroutines`
+// meson option. SDAINEKA_DELEGATE_COROUTINES tells whether it is; the header is empty otherwise.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define SDAINEKA_DELEGATE_COROUTINES 1
+#endif
+#endif
+
+#ifndef SDAINEKA_DELEGATE_COROUTINES
+#define SDAINEKA_DELEGATE_COROUTINES 0
+#endif
+
+#if SDAINEKA_DELEGATE_COROUTINES
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace sdaineka
+{
+// Base of coroutine promises whose frames come from the DelegateSlabResource: a coroutine type always has
+// the same frame size, so its frames share slabs and creating one per call does not go to the general heap.
+struct DelegateCoroutineFrame
+{
+    static void* operator new(std::size_t size)
+    {
+        return DelegateSlabResource::Get()->allocate(size, alignof(std::max_align_t));
+    }
+
+    static void operator delete(void* ptr, std::size_t size)
+    {
+        DelegateSlabResource::Get()->deallocate(ptr, size, alignof(std::max_align_t));
+    }
+};
+
+namespace detail
+{
+inline void resume_coroutine(std::coroutine_handle<> handle)
+{
+    handle.resume();
+}
+} // namespace detail
+
+// Delegate that resumes the coroutine, for executors taking Delegate<void()> such as DelegateQueue or
+// TaskScheduler. The handle is stored inline, so this never allocates.
+inline Delegate<void()> MakeResumeDelegate(std::coroutine_handle<> handle)
+{
+    return Delegate<void()>::Create<&detail::resume_coroutine>(handle);
+}
+
+// co_await ResumeOn(executor) continues the coroutine from whatever the executor runs the resume delegate on.
+using DelegateExecutor = Delegate<void(Delegate<void()>&& /*resume*/)>;
+
+inline auto ResumeOn(const DelegateExecutor& executor)
+{
+    struct Awaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) const
+        {
+            executor(MakeResumeDelegate(handle));
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+
+        const DelegateExecutor& executor;
+    };
+
+    return Awaiter{executor};
+}
+
+template<typename T = void>
+class Task;
+
+namespace detail
+{
+class TaskPromiseBase : public DelegateCoroutineFrame
+{
+public:
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        // Symmetric transfer to the awaiting coroutine, so chains of tasks do not grow the stack.
+        template<typename TPromise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> handle) const noexcept
+        {
+            const std::coroutine_handle<> continuation = handle.promise().m_continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        m_exception = std::current_exception();
+    }
+
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_exception;
+};
+
+template<typename T>
+class TaskPromise final : public TaskPromiseBase
+{
+public:
+    Task<T> get_return_object() noexcept;
+
+    template<typename TValue>
+    void return_value(TValue&& value)
+    {
+        m_value.emplace(std::forward<TValue>(value));
+    }
+
+    T TakeResult()
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template<>
+class TaskPromise<void> final : public TaskPromiseBase
+{
+public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept
+    {
+    }
+
+    void TakeResult() const
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+    }
+};
+} // namespace detail
+
+// Lazily started coroutine producing a T. Awaiting the task runs it and resumes the awaiting coroutine
+// once it completes, without going through the stack of the caller. A task that is not awaited is started
+// with Start(), which runs it up to its first suspension; completion is checked with IsDone(). The task
+// owns its frame and destroys it, suspended or not, when it is destroyed.
+template<typename T>
+class Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using ValueType = T;
+
+public:
+    Task() = default;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+        : m_handle(handle)
+    {
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    ~Task()
+    {
+        Destroy();
+    }
+
+    void Start()
+    {
+        assert(m_handle && !m_handle.done() && "only a pending task can be started");
+        m_handle.resume();
+    }
+
+    bool IsDone() const
+    {
+        return m_handle && m_handle.done();
+    }
+
+    // The result of a completed task, or the exception it ended with.
+    T GetResult()
+    {
+        assert(IsDone() && "the task has not completed");
+        return m_handle.promise().TakeResult();
+    }
+
+    explicit operator bool() const
+    {
+        return static_cast<bool>(m_handle);
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            bool await_ready() const noexcept
+            {
+                return !handle || handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) const noexcept
+            {
+                handle.promise().m_continuation = continuation;
+                return handle;
+            }
+
+            T await_resume() const
+            {
+                return handle.promise().TakeResult();
+            }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        return Awaiter{m_handle};
+    }
+
+private:
+    void Destroy()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace detail
+{
+template<typename T>
+inline Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// What co_await on an event produces: nothing, the single argument or a tuple of the arguments.
+template<typename... TArgs>
+struct event_result
+{
+    using type = std::tuple<std::decay_t<TArgs>...>;
+};
+
+template<>
+struct event_result<>
+{
+    using type = void;
+};
+
+template<typename TArg>
+struct event_result<TArg>
+{
+    using type = std::decay_t<TArg>;
+};
+
+// How a callback task keeps an argument until the operation is started: a copy, except for non-const lvalue
+// references, which the operation is meant to see.
+template<typename TArg>
+using async_arg_t = std::conditional_t<std::is_lvalue_reference_v<TArg> && !std::is_const_v<std::remove_reference_t<TArg>>, TArg,
+                                       std::decay_t<TArg>>;
+
+template<typename TReturn>
+struct async_completion
+{
+    using type = Delegate<void(TReturn)>;
+};
+
+template<>
+struct async_completion<void>
+{
+    using type = Delegate<void()>;
+};
+} // namespace detail
+
+template<typename>
+class AsyncEvent;
+
+// MulticastDelegate that coroutines can also await: co_await event suspends until the next Broadcast() and
+// produces its arguments. Broadcast() calls the subscribed delegates first, then resumes the waiting
+// coroutines in the order they started waiting; a coroutine that awaits the event again waits for the
+// following broadcast. Waiters are nodes of an intrusive list that live in the awaiting coroutine frame,
+// so awaiting does not allocate, and a coroutine destroyed while waiting leaves the list, also while a
+// broadcast is resuming the waiters, e.g. when a resumed coroutine destroys another one. Not thread safe.
+template<typename... TArgs>
+class AsyncEvent<void(TArgs...)>
+{
+public:
+    using DelegateType = Delegate<void(TArgs...)>;
+    using Handle = MulticastDelegateHandle;
+    using ResultType = typename detail::event_result<TArgs...>::type;
+
+private:
+    using Storage = std::conditional_t<std::is_void_v<ResultType>, bool, ResultType>;
+
+    class WaiterList;
+
+public:
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(AsyncEvent* event)
+            : m_event(event)
+        {
+        }
+
+        Awaiter(const Awaiter&) = delete;
+        Awaiter& operator=(const Awaiter&) = delete;
+
+        ~Awaiter()
+        {
+            if (m_list != nullptr)
+            {
+                m_list->Unlink(this);
+            }
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            m_handle = handle;
+            m_event->m_waiting.Link(this);
+        }
+
+        ResultType await_resume()
+        {
+            if constexpr (!std::is_void_v<ResultType>)
+            {
+                return std::move(*m_result);
+            }
+        }
+
+    private:
+        friend class AsyncEvent;
+
+        AsyncEvent* m_event;
+        std::coroutine_handle<> m_handle;
+        WaiterList* m_list = nullptr;
+        Awaiter* m_prev = nullptr;
+        Awaiter* m_next = nullptr;
+        std::optional<Storage> m_result;
+    };
+
+public:
+    AsyncEvent() = default;
+
+    AsyncEvent(const AsyncEvent&) = delete;
+    AsyncEvent& operator=(const AsyncEvent&) = delete;
+
+    // Waiting coroutines must have completed or been destroyed.
+    ~AsyncEvent()
+    {
+        assert(m_waiting.head == nullptr && "coroutines are still waiting for the event");
+    }
+
+    Handle Subscribe(DelegateType delegate)
+    {
+        return m_subscribers.Subscribe(std::move(delegate));
+    }
+
+    bool Unsubscribe(Handle handle)
+    {
+        return m_subscribers.Unsubscribe(handle);
+    }
+
+    Awaiter operator co_await()
+    {
+        return Awaiter(this);
+    }
+
+    void Broadcast(TArgs... args)
+    {
+        m_subscribers.Broadcast(args...);
+
+        // The current waiters move to a list of their own, coroutines that wait again go to the next broadcast.
+        // Waiters are taken off it one at a time, so one destroyed by a resumed coroutine is never resumed.
+        WaiterList firing;
+        firing.head = std::exchange(m_waiting.head, nullptr);
+        firing.tail = std::exchange(m_waiting.tail, nullptr);
+        for (Awaiter* waiter = firing.head; waiter != nullptr; waiter = waiter->m_next)
+        {
+            waiter->m_list = &firing;
+            if constexpr (std::is_void_v<ResultType>)
+            {
+                waiter->m_result.emplace(true);
+            }
+            else
+            {
+                waiter->m_result.emplace(args...);
+            }
+        }
+
+        while (firing.head != nullptr)
+        {
+            Awaiter* waiter = firing.head;
+            firing.Unlink(waiter);
+            waiter->m_handle.resume();
+        }
+    }
+
+    std::size_t GetSubscriberCount() const
+    {
+        return m_subscribers.Size();
+    }
+
+    bool HasWaiters() const
+    {
+        return m_waiting.head != nullptr;
+    }
+
+private:
+    class WaiterList
+    {
+    public:
+        void Link(Awaiter* waiter)
+        {
+            waiter->m_prev = tail;
+            waiter->m_next = nullptr;
+            (tail != nullptr ? tail->m_next : head) = waiter;
+            tail = waiter;
+            waiter->m_list = this;
+        }
+
+        void Unlink(Awaiter* waiter)
+        {
+            (waiter->m_prev != nullptr ? waiter->m_prev->m_next : head) = waiter->m_next;
+            (waiter->m_next != nullptr ? waiter->m_next->m_prev : tail) = waiter->m_prev;
+            waiter->m_list = nullptr;
+        }
+
+        Awaiter* head = nullptr;
+        Awaiter* tail = nullptr;
+    };
+
+    MulticastDelegate<void(TArgs...)> m_subscribers;
+    WaiterList m_waiting;
+};
+
+template<typename>
+class AsyncDelegate;
+
+// Type erased asynchronous function: calling it returns a Task<TReturn> to await. The target is either a
+// coroutine, any callable returning Task<TReturn>, or a callback style operation that receives the
+// arguments followed by a completion delegate to take over, so existing callback chains can be awaited
+// as they are.
+//
+// The completion delegate of a callback target holds a single pointer and is stored inline; it may be
+// called before the operation returns or later from another thread, and resumes the awaiting coroutine on
+// the thread that calls it. The task copies the arguments, also those passed by const or rvalue reference,
+// so it can be started after they are gone; objects passed by non-const reference must outlive the task.
+// The AsyncDelegate must outlive the tasks it returns.
+template<typename TReturn, typename... TArgs>
+class AsyncDelegate<Task<TReturn>(TArgs...)>
+{
+public:
+    using CoroutineType = Delegate<Task<TReturn>(TArgs...)>;
+    using CompletionType = typename detail::async_completion<TReturn>::type;
+    using CallbackType = Delegate<void(TArgs..., CompletionType&&)>;
+
+public:
+    AsyncDelegate() = default;
+
+    explicit AsyncDelegate(CoroutineType target)
+        : m_coroutine(std::move(target))
+    {
+    }
+
+    explicit AsyncDelegate(CallbackType target)
+        : m_callback(std::move(target))
+    {
+    }
+
+    Task<TReturn> operator()(TArgs... args) const
+    {
+        assert(*this && "calling an empty AsyncDelegate");
+
+        if (m_coroutine)
+        {
+            return m_coroutine(std::forward<TArgs>(args)...);
+        }
+
+        return CallCallback(std::forward<TArgs>(args)...);
+    }
+
+    explicit operator bool() const
+    {
+        return m_coroutine || m_callback;
+    }
+
+private:
+    using Storage = std::conditional_t<std::is_void_v<TReturn>, bool, TReturn>;
+
+    class CallbackAwaiter
+    {
+    public:
+        // The arguments live in the frame of the calling task.
+        CallbackAwaiter(const CallbackType& target, detail::async_arg_t<TArgs>&... args)
+            : m_target(target)
+            , m_args(args...)
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        // Returns false when the completion already ran, the coroutine then continues without suspending.
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            m_handle = handle;
+            std::apply([this](auto&... args) { m_target(std::forward<TArgs>(args)..., MakeCompletion()); }, m_args);
+            return m_state.exchange(kSuspended, std::memory_order_acq_rel) != kCompleted;
+        }
+
+        TReturn await_resume()
+        {
+            if constexpr (!std::is_void_v<TReturn>)
+            {
+                return std::move(*m_result);
+            }
+        }
+
+    private:
+        static constexpr int kPending = 0;
+        static constexpr int kSuspended = 1;
+        static constexpr int kCompleted = 2;
+
+        CompletionType MakeCompletion()
+        {
+            if constexpr (std::is_void_v<TReturn>)
+            {
+                return CompletionType::CreateLambda([this] { Complete(true); });
+            }
+            else
+            {
+                return CompletionType::CreateLambda([this](TReturn value) { Complete(std::move(value)); });
+            }
+        }
+
+        template<typename TValue>
+        void Complete(TValue&& value)
+        {
+            m_result.emplace(std::forward<TValue>(value));
+            if (m_state.exchange(kCompleted, std::memory_order_acq_rel) == kSuspended)
+            {
+                m_handle.resume();
+            }
+        }
+
+        const CallbackType& m_target;
+        std::tuple<detail::async_arg_t<TArgs>&...> m_args;
+        std::coroutine_handle<> m_handle;
+        std::optional<Storage> m_result;
+        std::atomic<int> m_state{kPending};
+    };
+
+    Task<TReturn> CallCallback(detail::async_arg_t<TArgs>... args) const
+    {
+        co_return co_await CallbackAwaiter(m_callback, args...);
+    }
+
+    CoroutineType m_coroutine;
+    CallbackType m_callback;
+};
+} // namespace sdaineka
+#endif
\ No newline at end of file
@@ -0,0 +1,387 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Define to 0 to keep a full fence on the read side of the EpochDomain instead of using membarrier(2).
+#ifndef SDAINEKA_DELEGATE_MEMBARRIER
+#if defined(__linux__)
+#define SDAINEKA_DELEGATE_MEMBARRIER 1
+#else
+#define SDAINEKA_DELEGATE_MEMBARRIER 0
+#endif
+#endif
+
+#if SDAINEKA_DELEGATE_MEMBARRIER
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace sdaineka
+{
+namespace detail
+{
+// Process wide memory barrier: a full fence on every running thread of the process. Registration fails on
+// kernels before 4.14 and where the system call is filtered, in which case the caller must fence itself.
+inline bool RegisterProcessBarrier()
+{
+#if SDAINEKA_DELEGATE_MEMBARRIER
+    return syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+#else
+    return false;
+#endif
+}
+
+inline void ProcessBarrier()
+{
+#if SDAINEKA_DELEGATE_MEMBARRIER
+    [[maybe_unused]] const long result = syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+    assert(result == 0 && "membarrier failed after registration");
+#endif
+}
+} // namespace detail
+
+// Process wide epoch-based reclamation for structures that are read without locks.
+//
+// Readers enter a critical section with an EpochGuard before loading a shared pointer and must not keep
+// the pointee past the guard. Writers unlink an object first and then Retire() it; it is destroyed once
+// every thread that could still observe it has left its critical section. Entering and leaving a
+// critical section are a couple of thread local stores and never block. Guards may be nested.
+//
+// The store that announces a reader has to be ordered before its loads of shared pointers. Where
+// membarrier(2) is available the writer side pays for that with a process wide barrier before it
+// inspects the readers, so readers only need a compiler barrier; otherwise every reader runs a full fence.
+//
+// Retire() pushes onto a lock free list. Every kRetireBatch retirements, the thread that retires takes the
+// pending objects over in one batch unless another thread is already reclaiming, so retiring never blocks
+// and the barrier is paid once per batch.
+class EpochDomain
+{
+public:
+    using Deleter = void (*)(void*);
+
+    static EpochDomain* Get()
+    {
+        // Intentionally never destroyed: thread records are released while threads and statics are torn down.
+        static EpochDomain* instance = new EpochDomain();
+        return instance;
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    void Enter()
+    {
+        ThreadRecord* record = t_record != nullptr ? t_record : RegisterThread();
+        if (record->nesting++ == 0)
+        {
+            record->epoch.store(m_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            // The announcement must be visible before the protected pointer is loaded, see HeavyFence().
+            if (m_processBarrier)
+            {
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+            else
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+    }
+
+    void Leave()
+    {
+        ThreadRecord* record = t_record;
+        assert(record != nullptr && record->nesting > 0 && "Leave without a matching Enter");
+        if (--record->nesting == 0)
+        {
+            record->epoch.store(kQuiescent, std::memory_order_release);
+        }
+    }
+
+    bool IsInCriticalSection()
+    {
+        return t_record != nullptr && t_record->nesting > 0;
+    }
+
+    // The object must already be unreachable for readers that enter after this call. Lock free apart from
+    // the allocation of the list node: the reclamation of a batch is skipped while another thread runs one.
+    void Retire(void* ptr, Deleter deleter)
+    {
+        PendingNode* node = new PendingNode{ptr, deleter, m_pending.load(std::memory_order_relaxed)};
+        while (!m_pending.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+
+        if (m_pendingCount.fetch_add(1, std::memory_order_relaxed) + 1 < kRetireBatch)
+        {
+            return;
+        }
+
+        std::vector<Retired> reclaimable;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+            if (!lock.owns_lock())
+            {
+                return;
+            }
+
+            TakePending();
+            TryAdvance();
+            CollectReclaimable(reclaimable);
+        }
+
+        Destroy(reclaimable);
+    }
+
+    template<typename T>
+    void Retire(T* ptr)
+    {
+        Retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    // Destroys retired objects that are no longer observable, without waiting for readers. Returns the
+    // epoch that was used to select them.
+    std::uint64_t Reclaim()
+    {
+        std::vector<Retired> reclaimable;
+        std::uint64_t epoch;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            TakePending();
+            TryAdvance();
+            epoch = CollectReclaimable(reclaimable);
+        }
+
+        Destroy(reclaimable);
+        return epoch;
+    }
+
+    // Waits until every object retired before the call has been destroyed. Must not be called from
+    // within a critical section, which would wait for itself.
+    void Synchronize()
+    {
+        assert(!IsInCriticalSection() && "Synchronize from within a critical section never completes");
+
+        // Objects retired before the call are stamped by the first Reclaim() or a batch that ran before it,
+        // with an epoch of at most target - 2.
+        const std::uint64_t target = Reclaim() + 2;
+        while (Reclaim() < target)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    std::size_t GetRetiredCount()
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        TakePending();
+        return m_retired.size();
+    }
+
+private:
+    static constexpr std::uint64_t kQuiescent = 0;
+    static constexpr std::size_t kRetireBatch = 32;
+
+    struct Retired
+    {
+        void* ptr;
+        Deleter deleter;
+        std::uint64_t epoch;
+    };
+
+    struct PendingNode
+    {
+        void* ptr;
+        Deleter deleter;
+        PendingNode* next;
+    };
+
+    // One record per live thread, padded so that announcements do not false share. The nesting depth is
+    // only touched by the owning thread.
+    struct alignas(64) ThreadRecord
+    {
+        std::atomic<std::uint64_t> epoch{kQuiescent};
+        std::atomic<bool> inUse{true};
+        std::uint32_t nesting = 0;
+        ThreadRecord* next = nullptr;
+    };
+
+    // Releases the record of the thread when it exits.
+    struct ThreadState
+    {
+        ~ThreadState()
+        {
+            if (record != nullptr)
+            {
+                t_record = nullptr;
+                record->nesting = 0;
+                record->epoch.store(kQuiescent, std::memory_order_release);
+                record->inUse.store(false, std::memory_order_release);
+            }
+        }
+
+        ThreadRecord* record = nullptr;
+    };
+
+    EpochDomain()
+        : m_processBarrier(detail::RegisterProcessBarrier())
+    {
+    }
+
+    // Pairs with the fence of Enter(): a reader whose announcement is not visible yet is made to see
+    // everything written before this point.
+    void HeavyFence() const
+    {
+        if (m_processBarrier)
+        {
+            detail::ProcessBarrier();
+        }
+        else
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    // Slow path of the first critical section of a thread. The thread_local with a destructor is only
+    // touched here, t_record is trivial and reached without the TLS initialization check.
+    static ThreadRecord* RegisterThread()
+    {
+        thread_local ThreadState state;
+        state.record = Get()->AcquireRecord();
+        t_record = state.record;
+        return state.record;
+    }
+
+    // Records of exited threads are reused, the list only grows with the peak number of threads.
+    ThreadRecord* AcquireRecord()
+    {
+        for (ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            bool expected = false;
+            if (!record->inUse.load(std::memory_order_relaxed)
+                && record->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return record;
+            }
+        }
+
+        ThreadRecord* record = new ThreadRecord();
+        record->next = m_records.load(std::memory_order_relaxed);
+        while (!m_records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+
+        return record;
+    }
+
+    // Moves the objects retired since the last batch to m_retired. They are stamped here, under the lock,
+    // so that the barrier of the next TryAdvance() is ordered after their unlink like for objects retired
+    // by the thread that reclaims.
+    void TakePending()
+    {
+        m_pendingCount.store(0, std::memory_order_relaxed);
+        PendingNode* node = m_pending.exchange(nullptr, std::memory_order_acquire);
+
+        const std::uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+        while (node != nullptr)
+        {
+            PendingNode* next = node->next;
+            m_retired.push_back({node->ptr, node->deleter, epoch});
+            delete node;
+            node = next;
+        }
+    }
+
+    // The epoch moves forward once every thread inside a critical section has observed the current one.
+    void TryAdvance()
+    {
+        const std::uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+
+        HeavyFence();
+        for (ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            const std::uint64_t observed = record->epoch.load(std::memory_order_acquire);
+            if (observed != kQuiescent && observed != epoch)
+            {
+                return;
+            }
+        }
+
+        m_epoch.store(epoch + 1, std::memory_order_release);
+    }
+
+    // An object retired in epoch e may still be seen by readers that entered in e - 1 or e, both of which
+    // have left once the epoch reaches e + 2.
+    std::uint64_t CollectReclaimable(std::vector<Retired>& reclaimable)
+    {
+        const std::uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+
+        auto it = m_retired.begin();
+        while (it != m_retired.end())
+        {
+            if (it->epoch + 2 <= epoch)
+            {
+                reclaimable.push_back(*it);
+                *it = m_retired.back();
+                m_retired.pop_back();
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        return epoch;
+    }
+
+    // Deleters run outside the lock, they may destroy delegates that retire objects themselves.
+    static void Destroy(const std::vector<Retired>& reclaimable)
+    {
+        for (const Retired& retired : reclaimable)
+        {
+            retired.deleter(retired.ptr);
+        }
+    }
+
+    static inline thread_local ThreadRecord* t_record = nullptr;
+
+    const bool m_processBarrier;
+
+    std::atomic<std::uint64_t> m_epoch{1};
+    std::atomic<ThreadRecord*> m_records{nullptr};
+
+    std::atomic<PendingNode*> m_pending{nullptr};
+    std::atomic<std::size_t> m_pendingCount{0};
+
+    std::mutex m_mutex;
+    std::vector<Retired> m_retired;
+};
+
+// Scoped critical section of the EpochDomain.
+class EpochGuard
+{
+public:
+    EpochGuard()
+        : m_domain(EpochDomain::Get())
+    {
+        m_domain->Enter();
+    }
+
+    ~EpochGuard()
+    {
+        m_domain->Leave();
+    }
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    EpochDomain* m_domain;
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,468 @@
+#pragma once
+#include "delegate_type_name.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Define to 1 to time calls with the x86 time stamp counter, which is cheaper to read than steady_clock. Ticks
+// are converted to nanoseconds against steady_clock when the counters are collected.
+#ifndef SDAINEKA_DELEGATE_INSTRUMENTATION_TSC
+#define SDAINEKA_DELEGATE_INSTRUMENTATION_TSC 0
+#endif
+
+#if SDAINEKA_DELEGATE_INSTRUMENTATION_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Define to 0 to name function pointer targets by their pointer type instead of resolving their symbol with
+// dladdr(), which needs -ldl on older glibc. Symbols are only found for functions the dynamic symbol table
+// exports, e.g. those of shared libraries or of executables linked with -rdynamic.
+#ifndef SDAINEKA_DELEGATE_INSTRUMENTATION_DLADDR
+#if __has_include(<dlfcn.h>)
+#define SDAINEKA_DELEGATE_INSTRUMENTATION_DLADDR 1
+#else
+#define SDAINEKA_DELEGATE_INSTRUMENTATION_DLADDR 0
+#endif
+#endif
+
+#if SDAINEKA_DELEGATE_INSTRUMENTATION_DLADDR
+#include <dlfcn.h>
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#define SDAINEKA_DELEGATE_INSTRUMENTATION_DEMANGLE 1
+#endif
+#endif
+
+namespace sdaineka
+{
+namespace detail
+{
+struct DelegateClock
+{
+    static constexpr bool kUsesTsc = SDAINEKA_DELEGATE_INSTRUMENTATION_TSC != 0;
+
+    // Nanoseconds, or TSC ticks when kUsesTsc.
+    static std::uint64_t Now()
+    {
+#if SDAINEKA_DELEGATE_INSTRUMENTATION_TSC
+        return __rdtsc();
+#else
+        return SteadyNs();
+#endif
+    }
+
+    static std::uint64_t SteadyNs()
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+};
+} // namespace detail
+
+// Call statistics of one target type, summed over all threads.
+struct DelegateCallStats
+{
+    std::string_view target;
+    std::uint64_t calls;
+    std::uint64_t totalNs;
+    std::uint64_t maxNs;
+};
+
+// Per target call counters, recorded by the delegate invokers when SDAINEKA_DELEGATE_INSTRUMENTATION is
+// defined to 1 and compiled out otherwise.
+//
+// Lambdas and Create<Func>() targets are identified by the type of the bound payload. The function and member
+// function pointers bound by CreateGlobal() and CreateMember() are identified by their value and named by
+// their symbol, see SDAINEKA_DELEGATE_INSTRUMENTATION_DLADDR, or by their pointer type, followed by their
+// address. Every thread records into its own table with plain stores, so recording takes no lock and does
+// not contend. Latencies come from steady_clock or the TSC, see SDAINEKA_DELEGATE_INSTRUMENTATION_TSC, and
+// include nested calls. Collect() reads the tables of running threads without stopping them, so calls in
+// flight may be missed.
+class DelegateInstrumentation
+{
+public:
+    static DelegateInstrumentation* Get()
+    {
+        // Intentionally never destroyed: delegates may be called while statics are torn down.
+        static DelegateInstrumentation* instance = new DelegateInstrumentation();
+        return instance;
+    }
+
+    DelegateInstrumentation(const DelegateInstrumentation&) = delete;
+    DelegateInstrumentation& operator=(const DelegateInstrumentation&) = delete;
+
+    // Targets that were called at least once, hottest total time first.
+    std::vector<DelegateCallStats> Collect() const
+    {
+        std::vector<DelegateCallStats> stats;
+        {
+            const std::lock_guard<std::mutex> lock(m_mutex);
+            for (const std::string_view name : m_sites)
+            {
+                stats.push_back({name, 0, 0, 0});
+            }
+        }
+
+        const double nsPerTick = GetNsPerTick();
+        const std::size_t recorded = std::min(stats.size(), kChunkSize * kMaxChunks);
+        for (const ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            for (std::size_t site = 0; site < recorded; site++)
+            {
+                const Counters* chunk = record->chunks[site / kChunkSize].load(std::memory_order_acquire);
+                if (chunk == nullptr)
+                {
+                    continue;
+                }
+
+                const Counters& counters = chunk[site % kChunkSize];
+                stats[site].calls += counters.calls.load(std::memory_order_relaxed);
+                stats[site].totalNs += counters.totalTicks.load(std::memory_order_relaxed);
+                stats[site].maxNs = std::max(stats[site].maxNs, counters.maxTicks.load(std::memory_order_relaxed));
+            }
+        }
+
+        for (DelegateCallStats& s : stats)
+        {
+            s.totalNs = static_cast<std::uint64_t>(static_cast<double>(s.totalNs) * nsPerTick);
+            s.maxNs = static_cast<std::uint64_t>(static_cast<double>(s.maxNs) * nsPerTick);
+        }
+
+        stats.erase(std::remove_if(stats.begin(), stats.end(), [](const DelegateCallStats& s) { return s.calls == 0; }), stats.end());
+        std::sort(stats.begin(), stats.end(), [](const DelegateCallStats& a, const DelegateCallStats& b) { return a.totalNs > b.totalNs; });
+        return stats;
+    }
+
+    void WriteCsv(std::ostream& out) const
+    {
+        out << "target,calls,total_ns,max_ns\n";
+        for (const DelegateCallStats& s : Collect())
+        {
+            out << '"';
+            WriteEscaped(out, s.target, '"', '"');
+            out << "\"," << s.calls << ',' << s.totalNs << ',' << s.maxNs << '\n';
+        }
+    }
+
+    void WriteJson(std::ostream& out) const
+    {
+        out << '[';
+        const char* separator = "\n";
+        for (const DelegateCallStats& s : Collect())
+        {
+            out << separator << "  {\"target\": \"";
+            WriteEscaped(out, s.target, '"', '\\');
+            out << "\", \"calls\": " << s.calls << ", \"total_ns\": " << s.totalNs << ", \"max_ns\": " << s.maxNs << '}';
+            separator = ",\n";
+        }
+        out << "\n]\n";
+    }
+
+    // Called once per target type. The name must have static storage duration.
+    std::uint32_t RegisterSite(std::string_view name)
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_sites.push_back(name);
+        return static_cast<std::uint32_t>(m_sites.size() - 1);
+    }
+
+    // Called on the first call of a function or member function pointer target on a thread, value holds the
+    // bytes of the pointer.
+    std::uint32_t RegisterPointerSite(std::string_view typeName, const void* value, std::size_t size)
+    {
+        std::pair<std::string_view, std::string> key(typeName, std::string(static_cast<const char*>(value), size));
+
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        const auto [it, inserted] = m_pointerSites.try_emplace(std::move(key), 0);
+        if (inserted)
+        {
+            m_pointerNames.push_back(DescribePointer(typeName, value, size));
+            m_sites.push_back(m_pointerNames.back());
+            it->second = static_cast<std::uint32_t>(m_sites.size() - 1);
+        }
+
+        return it->second;
+    }
+
+    // The duration is in DelegateClock units.
+    void Record(std::uint32_t site, std::uint64_t duration)
+    {
+        Counters* counters = GetCounters(site);
+        if (counters == nullptr)
+        {
+            return;
+        }
+
+        // Only the owning thread writes its counters, readers tolerate torn updates across fields.
+        counters->calls.store(counters->calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        counters->totalTicks.store(counters->totalTicks.load(std::memory_order_relaxed) + duration, std::memory_order_relaxed);
+        if (duration > counters->maxTicks.load(std::memory_order_relaxed))
+        {
+            counters->maxTicks.store(duration, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    // Counters are allocated in chunks on first use and never move. Targets past the last chunk are not recorded.
+    static constexpr std::size_t kChunkSize = 256;
+    static constexpr std::size_t kMaxChunks = 256;
+
+    struct Counters
+    {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> totalTicks{0};
+        std::atomic<std::uint64_t> maxTicks{0};
+    };
+
+    struct ThreadRecord
+    {
+        std::atomic<Counters*> chunks[kMaxChunks] = {};
+        std::atomic<bool> inUse{true};
+        ThreadRecord* next = nullptr;
+    };
+
+    struct ThreadState
+    {
+        ~ThreadState()
+        {
+            if (record != nullptr)
+            {
+                record->inUse.store(false, std::memory_order_release);
+            }
+        }
+
+        ThreadRecord* record = nullptr;
+    };
+
+    DelegateInstrumentation()
+        : m_startTicks(detail::DelegateClock::Now())
+        , m_startNs(detail::DelegateClock::SteadyNs())
+    {
+    }
+
+    // The TSC rate is measured over the lifetime of the registry.
+    double GetNsPerTick() const
+    {
+        if constexpr (detail::DelegateClock::kUsesTsc)
+        {
+            const std::uint64_t ticks = detail::DelegateClock::Now() - m_startTicks;
+            const std::uint64_t ns = detail::DelegateClock::SteadyNs() - m_startNs;
+            return ticks != 0 ? static_cast<double>(ns) / static_cast<double>(ticks) : 1.0;
+        }
+        else
+        {
+            return 1.0;
+        }
+    }
+
+    // "<symbol or pointer type> at 0x<address>", the address is the first word of a member function pointer.
+    static std::string DescribePointer(std::string_view typeName, const void* value, std::size_t size)
+    {
+        std::uintptr_t address = 0;
+        std::memcpy(&address, value, std::min(size, sizeof(address)));
+
+        std::string name(typeName);
+#if SDAINEKA_DELEGATE_INSTRUMENTATION_DLADDR
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void*>(address), &info) != 0 && info.dli_sname != nullptr
+            && reinterpret_cast<std::uintptr_t>(info.dli_saddr) == address)
+        {
+            name = info.dli_sname;
+#if SDAINEKA_DELEGATE_INSTRUMENTATION_DEMANGLE
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            if (demangled != nullptr)
+            {
+                name = demangled;
+                std::free(demangled);
+            }
+#endif
+        }
+#endif
+
+        name += " at 0x";
+        for (int shift = static_cast<int>(sizeof(address) * 8) - 4; shift >= 0; shift -= 4)
+        {
+            name += "0123456789abcdef"[(address >> shift) & 0xf];
+        }
+
+        return name;
+    }
+
+    static void WriteEscaped(std::ostream& out, std::string_view text, char quote, char escape)
+    {
+        for (const char c : text)
+        {
+            if (c == quote || c == escape)
+            {
+                out << escape;
+            }
+            out << c;
+        }
+    }
+
+    Counters* GetCounters(std::uint32_t site)
+    {
+        if (site >= kChunkSize * kMaxChunks)
+        {
+            return nullptr;
+        }
+
+        thread_local ThreadState state;
+        if (state.record == nullptr)
+        {
+            state.record = AcquireRecord();
+        }
+
+        std::atomic<Counters*>& slot = state.record->chunks[site / kChunkSize];
+        Counters* chunk = slot.load(std::memory_order_relaxed);
+        if (chunk == nullptr)
+        {
+            chunk = new Counters[kChunkSize];
+            slot.store(chunk, std::memory_order_release);
+        }
+
+        return &chunk[site % kChunkSize];
+    }
+
+    // Records of exited threads are reused and keep their counts, the list only grows with the peak number
+    // of threads.
+    ThreadRecord* AcquireRecord()
+    {
+        for (ThreadRecord* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            bool expected = false;
+            if (!record->inUse.load(std::memory_order_relaxed)
+                && record->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return record;
+            }
+        }
+
+        ThreadRecord* record = new ThreadRecord();
+        record->next = m_records.load(std::memory_order_relaxed);
+        while (!m_records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+
+        return record;
+    }
+
+    const std::uint64_t m_startTicks;
+    const std::uint64_t m_startNs;
+
+    std::atomic<ThreadRecord*> m_records{nullptr};
+
+    mutable std::mutex m_mutex;
+    std::vector<std::string_view> m_sites;
+    std::map<std::pair<std::string_view, std::string>, std::uint32_t> m_pointerSites;
+    // Names of the pointer sites, a deque so that the views in m_sites stay valid.
+    std::deque<std::string> m_pointerNames;
+};
+
+namespace detail
+{
+template<typename TTarget>
+struct DelegateCallSite
+{
+    static std::uint32_t Get()
+    {
+        static const std::uint32_t site = DelegateInstrumentation::Get()->RegisterSite(delegate_type_name<TTarget>());
+        return site;
+    }
+};
+
+template<typename TFuncPtr>
+struct DelegatePointerSite
+{
+    static std::uint32_t Get(TFuncPtr func)
+    {
+        // Direct mapped per thread cache of the sites of the pointers of this type, so that only the first call of a
+        // target, or one that was evicted, takes the registry lock.
+        struct Entry
+        {
+            TFuncPtr func;
+            std::uint32_t site;
+            bool used;
+        };
+        thread_local Entry cache[kCacheSize] = {};
+
+        std::uintptr_t address = 0;
+        std::memcpy(&address, &func, std::min(sizeof(func), sizeof(address)));
+
+        Entry& entry = cache[(address >> 4) % kCacheSize];
+        if (!entry.used || entry.func != func)
+        {
+            entry.site = DelegateInstrumentation::Get()->RegisterPointerSite(delegate_type_name<TFuncPtr>(), &func, sizeof(func));
+            entry.func = func;
+            entry.used = true;
+        }
+
+        return entry.site;
+    }
+
+private:
+    static constexpr std::size_t kCacheSize = 16;
+};
+
+// Site of a bound target: one per pointer value for function and member function pointers, one per TTarget
+// for other targets.
+template<typename TTarget>
+struct DelegateTargetSite
+{
+    template<typename TFunc>
+    static std::uint32_t Get(const TFunc& target)
+    {
+        if constexpr (std::is_member_function_pointer_v<TFunc> || std::is_function_v<std::remove_pointer_t<TFunc>>)
+        {
+            return DelegatePointerSite<TFunc>::Get(target);
+        }
+        else
+        {
+            return DelegateCallSite<TTarget>::Get();
+        }
+    }
+};
+
+// Records the duration of its scope for one target.
+class DelegateCallTimer
+{
+public:
+    explicit DelegateCallTimer(std::uint32_t site)
+        : m_site(site)
+        , m_start(DelegateClock::Now())
+    {
+    }
+
+    ~DelegateCallTimer()
+    {
+        DelegateInstrumentation::Get()->Record(m_site, DelegateClock::Now() - m_start);
+    }
+
+    DelegateCallTimer(const DelegateCallTimer&) = delete;
+    DelegateCallTimer& operator=(const DelegateCallTimer&) = delete;
+
+private:
+    std::uint32_t m_site;
+    std::uint64_t m_start;
+};
+} // namespace detail
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace sdaineka
+{
+// Stage calling a function known at compile time, e.g. Compose<int(int)>(StaticStage<&parse>(), ...), so the
+// call is direct and can be inlined instead of going through a function pointer.
+template<auto Func>
+struct StaticStage
+{
+    template<typename... TArgs>
+    decltype(auto) operator()(TArgs&&... args) const
+    {
+        return std::invoke(Func, std::forward<TArgs>(args)...);
+    }
+};
+
+namespace detail
+{
+template<typename T>
+struct is_optional : std::false_type
+{
+};
+
+template<typename T>
+struct is_optional<std::optional<T>> : std::true_type
+{
+};
+
+template<typename>
+struct signature_return;
+
+template<typename TReturn, typename... TArgs>
+struct signature_return<TReturn(TArgs...)>
+{
+    using type = TReturn;
+};
+
+// Callable that runs the stages in order, each taking the result of the previous one by move.
+template<typename TReturn, typename... TStages>
+class ComposedStages
+{
+public:
+    explicit ComposedStages(TStages... stages)
+        : m_stages(std::move(stages)...)
+    {
+    }
+
+    template<typename... TArgs>
+    TReturn operator()(TArgs&&... args)
+    {
+        return Run<0>(std::forward<TArgs>(args)...);
+    }
+
+private:
+    template<std::size_t I, typename... TArgs>
+    TReturn Run(TArgs&&... args)
+    {
+        using Stage = std::tuple_element_t<I, std::tuple<TStages...>>;
+
+        if constexpr (I + 1 == sizeof...(TStages))
+        {
+            if constexpr (std::is_void_v<TReturn>)
+            {
+                std::invoke(std::get<I>(m_stages), std::forward<TArgs>(args)...);
+            }
+            else
+            {
+                return std::invoke(std::get<I>(m_stages), std::forward<TArgs>(args)...);
+            }
+        }
+        else
+        {
+            using Result = std::invoke_result_t<Stage&, TArgs&&...>;
+            static_assert(!std::is_void_v<Result>, "only the last stage of a pipeline can return void");
+
+            if constexpr (is_optional<std::decay_t<Result>>::value)
+            {
+                // A stage returning an empty std::optional filters the call out.
+                static_assert(std::is_void_v<TReturn> || is_optional<TReturn>::value,
+                              "a pipeline with a filtering stage must return void or std::optional");
+
+                auto result = std::invoke(std::get<I>(m_stages), std::forward<TArgs>(args)...);
+                if (!result)
+                {
+                    return TReturn();
+                }
+                return Run<I + 1>(std::move(*result));
+            }
+            else
+            {
+                return Run<I + 1>(std::invoke(std::get<I>(m_stages), std::forward<TArgs>(args)...));
+            }
+        }
+    }
+
+    std::tuple<TStages...> m_stages;
+};
+} // namespace detail
+
+// Fuses a chain of callables into one Delegate<TSignature>: the first stage takes the delegate arguments,
+// every following stage the result of the one before it, passed by move, and the last stage produces the
+// delegate result. A stage returning std::optional acts as a filter, an empty result ends the call and
+// returns void or an empty std::optional; an engaged one passes its value on.
+//
+// The delegate stores a single callable holding all stages, inline when it fits the stack storage. Stages
+// of lambdas, function objects and StaticStage are called directly, so the chain costs one indirect call
+// in total and the compiler can inline it end to end. Existing delegates, or any other type erased
+// callables, are accepted as stages as well and keep their own indirect call each.
+template<typename TSignature, typename... TStages>
+Delegate<TSignature> Compose(TStages&&... stages)
+{
+    static_assert(sizeof...(TStages) > 0, "a pipeline needs at least one stage");
+
+    using Return = typename detail::signature_return<TSignature>::type;
+    return Delegate<TSignature>::CreateLambda(
+        detail::ComposedStages<Return, std::decay_t<TStages>...>(std::forward<TStages>(stages)...));
+}
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,257 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace sdaineka
+{
+enum class DelegateQueueMode
+{
+    SingleProducer,
+    MultiProducer,
+};
+
+template<typename, DelegateQueueMode = DelegateQueueMode::SingleProducer>
+class DelegateQueue;
+
+// Bounded queue of deferred calls for a single consumer thread.
+//
+// Each message is a Delegate and a copy of its call arguments, stored inline in a ring buffer that is
+// allocated once, so posting does not allocate unless the bound target itself overflows the delegate's
+// stack storage. Cells carry a sequence number (Vyukov's bounded queue): producers claim a cell, construct
+// the message in place and publish it, the consumer runs it on Drain(). In MultiProducer mode producers
+// claim cells with a compare-and-swap, in SingleProducer mode with a plain store. Arguments are stored by
+// value; reference parameters are bound to the queued copy when the call runs.
+template<typename... TArgs, DelegateQueueMode Mode>
+class DelegateQueue<void(TArgs...), Mode>
+{
+public:
+    using DelegateType = Delegate<void(TArgs...)>;
+
+public:
+    // The capacity is rounded up to a power of two.
+    explicit DelegateQueue(std::size_t capacity)
+        : m_mask(RoundUpToPowerOfTwo(capacity) - 1)
+        , m_cells(std::make_unique<Cell[]>(m_mask + 1))
+    {
+        for (std::size_t i = 0; i <= m_mask; i++)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    DelegateQueue(const DelegateQueue&) = delete;
+    DelegateQueue& operator=(const DelegateQueue&) = delete;
+
+    // Messages that were not drained are destroyed without being run.
+    ~DelegateQueue()
+    {
+        while (Cell* cell = TryConsume())
+        {
+            if (!cell->empty)
+            {
+                cell->GetMessage()->~Message();
+            }
+        }
+    }
+
+    // Returns false if the queue is full, the delegate and arguments are left untouched in that case. If
+    // copying the arguments throws, the claimed cell is published as empty, which Drain() skips, and the
+    // exception propagates with the delegate left untouched.
+    template<typename... TCallArgs>
+    bool TryPost(DelegateType&& delegate, TCallArgs&&... args)
+    {
+        static_assert(sizeof...(TCallArgs) == sizeof...(TArgs), "TryPost expects one argument per parameter");
+        assert(delegate && "empty delegates can not be posted");
+
+        std::size_t pos;
+        Cell* cell = TryClaim(pos);
+        if (cell == nullptr)
+        {
+            return false;
+        }
+
+        try
+        {
+            new (cell->storage) Message{ArgsTuple(std::forward<TCallArgs>(args)...), std::move(delegate)};
+            cell->empty = false;
+        }
+        catch (...)
+        {
+            cell->empty = true;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            throw;
+        }
+
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Yields while the queue is full.
+    template<typename... TCallArgs>
+    void Post(DelegateType&& delegate, TCallArgs&&... args)
+    {
+        // TryPost leaves its arguments untouched on failure, so they can be forwarded again.
+        while (!TryPost(std::move(delegate), std::forward<TCallArgs>(args)...))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // Consumer only. Runs up to maxCount ready messages in posting order and returns how many ran. Each
+    // message is moved out of its cell before it runs, so producers can reuse the cell right away and a
+    // message may post to its own queue.
+    std::size_t Drain(std::size_t maxCount = std::numeric_limits<std::size_t>::max())
+    {
+        std::size_t count = 0;
+        while (count < maxCount)
+        {
+            Cell* cell = TryConsume();
+            if (cell == nullptr)
+            {
+                break;
+            }
+
+            if (cell->empty)
+            {
+                cell->sequence.store(m_dequeuePos + m_mask, std::memory_order_release);
+                continue;
+            }
+
+            Message* stored = cell->GetMessage();
+            Message message{std::move(stored->args), std::move(stored->delegate)};
+            stored->~Message();
+            cell->sequence.store(m_dequeuePos + m_mask, std::memory_order_release);
+
+            std::apply([&message](auto&... args) { std::move(message.delegate)(Forward<TArgs>(args)...); }, message.args);
+            ++count;
+        }
+
+        return count;
+    }
+
+    // Only exact when called from the consumer while producers are idle.
+    bool Empty() const
+    {
+        const Cell& cell = m_cells[m_dequeuePos & m_mask];
+        return cell.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1;
+    }
+
+    std::size_t Capacity() const
+    {
+        return m_mask + 1;
+    }
+
+private:
+    using ArgsTuple = std::tuple<std::decay_t<TArgs>...>;
+
+    // The arguments come first, so that a throwing copy leaves the posted delegate untouched.
+    struct Message
+    {
+        ArgsTuple args;
+        DelegateType delegate;
+    };
+
+    struct Cell
+    {
+        Message* GetMessage()
+        {
+            return std::launder(reinterpret_cast<Message*>(storage));
+        }
+
+        std::atomic<std::size_t> sequence;
+        // Published without a message because constructing it threw.
+        bool empty = false;
+        alignas(Message) std::byte storage[sizeof(Message)];
+    };
+
+    static std::size_t RoundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+
+        return result;
+    }
+
+    // Queued copies are moved into by-value parameters and bound to reference parameters.
+    template<typename TArg, typename TStored>
+    static decltype(auto) Forward(TStored& stored)
+    {
+        if constexpr (std::is_reference_v<TArg>)
+        {
+            return static_cast<TStored&>(stored);
+        }
+        else
+        {
+            return static_cast<TStored&&>(stored);
+        }
+    }
+
+    // A cell is free for position pos when its sequence is pos, and ready for the consumer at pos + 1.
+    Cell* TryClaim(std::size_t& pos)
+    {
+        pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = m_cells[pos & m_mask];
+            const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+
+            if (diff < 0)
+            {
+                return nullptr;
+            }
+
+            if constexpr (Mode == DelegateQueueMode::SingleProducer)
+            {
+                assert(diff == 0);
+                m_enqueuePos.store(pos + 1, std::memory_order_relaxed);
+                return &cell;
+            }
+            else if (diff == 0)
+            {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    return &cell;
+                }
+            }
+            else
+            {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Advances the dequeue position past a ready cell, which the caller then releases.
+    Cell* TryConsume()
+    {
+        Cell& cell = m_cells[m_dequeuePos & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1)
+        {
+            return nullptr;
+        }
+
+        ++m_dequeuePos;
+        return &cell;
+    }
+
+    const std::size_t m_mask;
+    const std::unique_ptr<Cell[]> m_cells;
+
+    // Producer and consumer positions live on separate cache lines.
+    alignas(64) std::atomic<std::size_t> m_enqueuePos{0};
+    alignas(64) std::size_t m_dequeuePos = 0;
+};
+} // namespace sdaineka
\ No newline at end of file
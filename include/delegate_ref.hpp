@@ -0,0 +1,112 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sdaineka
+{
+// Non-owning, trivially copyable view of a callable: an object pointer and an invoker.
+//
+// Intended for callback parameters of synchronous APIs. It never allocates, and the referenced callable
+// (lambda, functor, Delegate, object of a member target) must outlive every call made through the view.
+// A temporary lambda passed directly as an argument lives until the end of the full expression, which
+// covers the call it is passed to.
+template<typename TReturn, typename... TArgs>
+class DelegateRef<TReturn(TArgs...)>
+{
+private:
+    // Delegates and function pointers have dedicated constructors that avoid the extra indirection.
+    template<typename TFunc>
+    static constexpr bool IsCallable()
+    {
+        using Func = std::decay_t<TFunc>;
+        return !std::is_same_v<Func, DelegateRef> && !std::is_same_v<Func, Delegate<TReturn(TArgs...)>> && !std::is_pointer_v<Func>
+            && std::is_invocable_r_v<TReturn, TFunc&, TArgs...>;
+    }
+
+public:
+    DelegateRef() = default;
+
+    DelegateRef(const Delegate<TReturn(TArgs...)>& delegate)
+        : m_object(const_cast<std::byte*>(delegate.m_storage.data))
+        , m_invoker(delegate.m_invoker)
+    {
+    }
+
+    DelegateRef(TReturn (*func)(TArgs...))
+        : m_object(reinterpret_cast<std::byte*>(func))
+        , m_invoker(func != nullptr ? InvokeFuncPtr : nullptr)
+    {
+    }
+
+    template<typename TFunc, std::enable_if_t<IsCallable<TFunc>(), int> = 0>
+    DelegateRef(TFunc&& func)
+        : m_object(reinterpret_cast<std::byte*>(const_cast<std::remove_const_t<std::remove_reference_t<TFunc>>*>(std::addressof(func))))
+        , m_invoker(InvokeCallable<std::remove_reference_t<TFunc>>)
+    {
+    }
+
+    // Binds a target known at compile time. For a member function the object pointer is referenced, e.g.
+    // DelegateRef<int(int)>::Create<&Bar::add>(&bar).
+    template<auto Func>
+    static DelegateRef Create()
+    {
+        DelegateRef ref;
+        ref.m_invoker = InvokeStatic<Func>;
+        return ref;
+    }
+
+    template<auto Func, typename TClass>
+    static DelegateRef Create(TClass* cls)
+    {
+        DelegateRef ref;
+        ref.m_object = reinterpret_cast<std::byte*>(const_cast<std::remove_const_t<TClass>*>(cls));
+        ref.m_invoker = InvokeMember<Func, TClass>;
+        return ref;
+    }
+
+    TReturn operator()(TArgs... args) const
+    {
+        return m_invoker(m_object, std::forward<TArgs>(args)...);
+    }
+
+    operator bool() const
+    {
+        return m_invoker != nullptr;
+    }
+
+private:
+    // Same shape as the Delegate invoker, so a view of a Delegate calls its invoker directly.
+    using InvokeFunc = TReturn (*)(std::byte* /*object*/, TArgs... /*args*/);
+
+    static TReturn InvokeFuncPtr(std::byte* object, TArgs... args)
+    {
+        return reinterpret_cast<TReturn (*)(TArgs...)>(object)(std::forward<TArgs>(args)...);
+    }
+
+    template<typename TFunc>
+    static TReturn InvokeCallable(std::byte* object, TArgs... args)
+    {
+        return std::invoke(*reinterpret_cast<TFunc*>(object), std::forward<TArgs>(args)...);
+    }
+
+    template<auto Func>
+    static TReturn InvokeStatic(std::byte*, TArgs... args)
+    {
+        return std::invoke(Func, std::forward<TArgs>(args)...);
+    }
+
+    template<auto Func, typename TClass>
+    static TReturn InvokeMember(std::byte* object, TArgs... args)
+    {
+        return std::invoke(Func, reinterpret_cast<TClass*>(object), std::forward<TArgs>(args)...);
+    }
+
+    std::byte* m_object = nullptr;
+    InvokeFunc m_invoker = nullptr;
+};
+} // namespace sdaineka
\ No newline at end of file
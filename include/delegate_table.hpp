@@ -0,0 +1,490 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace sdaineka
+{
+// Binds a key, an enumerator or integer, to a target known at compile time: a function whose parameters
+// the table arguments convert to, or a member function called on the first table argument.
+template<auto Key, auto Func>
+struct DelegateTableEntry
+{
+    static constexpr auto key = Key;
+    static constexpr auto func = Func;
+};
+
+namespace detail
+{
+template<typename TKey>
+constexpr std::uint64_t delegate_table_key(TKey key)
+{
+    if constexpr (std::is_enum_v<TKey>)
+    {
+        return static_cast<std::uint64_t>(static_cast<std::underlying_type_t<TKey>>(key));
+    }
+    else
+    {
+        return static_cast<std::uint64_t>(key);
+    }
+}
+
+// Keys are distinct, checked before a layout is searched so that duplicates get their own diagnostic.
+// Heap sorts a copy, so that large tables stay within the constant evaluation limits.
+template<std::size_t N>
+constexpr bool delegate_table_keys_unique(std::array<std::uint64_t, N> keys)
+{
+    const auto siftDown = [&keys](std::size_t root, std::size_t end) {
+        while (2 * root + 1 < end)
+        {
+            std::size_t child = 2 * root + 1;
+            child += child + 1 < end && keys[child] < keys[child + 1] ? 1 : 0;
+            if (!(keys[root] < keys[child]))
+            {
+                return;
+            }
+
+            const std::uint64_t key = keys[root];
+            keys[root] = keys[child];
+            keys[child] = key;
+            root = child;
+        }
+    };
+
+    for (std::size_t i = N / 2; i > 0; i--)
+    {
+        siftDown(i - 1, N);
+    }
+    for (std::size_t end = N; end > 1; end--)
+    {
+        const std::uint64_t key = keys[0];
+        keys[0] = keys[end - 1];
+        keys[end - 1] = key;
+        siftDown(0, end - 1);
+    }
+
+    for (std::size_t i = 1; i < N; i++)
+    {
+        if (keys[i - 1] == keys[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+constexpr std::uint64_t delegate_table_mix(std::uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+// Smallest power of two that is at least value.
+constexpr std::size_t delegate_table_pow2(std::size_t value)
+{
+    std::size_t result = 1;
+    while (result < value)
+    {
+        result *= 2;
+    }
+
+    return result;
+}
+
+// Buckets of the displacement table for N keys, two keys per bucket on average.
+constexpr std::size_t delegate_table_buckets(std::size_t n)
+{
+    return delegate_table_pow2(n < 4 ? 2 : n / 2);
+}
+
+// Where the targets go: keys spanning a small range index the table directly by key - base. A few sparse
+// keys index it by the top bits of key * multiplier, with a multiplier searched for that maps them to at
+// most four slots per key without collisions. Other sparse keys go through a two-level displacement hash
+// (CHD / PTHash style): a mixed hash of the key picks a bucket by its top bits and a slot by its low bits,
+// xor the displacement of the bucket. The displacements are searched at compile time, largest buckets
+// first, so that no two keys share a slot; the table has at most 2.5 slots per key.
+template<std::size_t N>
+struct DelegateTableLayout
+{
+    static constexpr std::size_t kBuckets = delegate_table_buckets(N);
+
+    bool dense;
+    std::uint64_t base;
+    std::uint64_t multiplier;
+    std::uint64_t seed;
+    unsigned shift;
+    std::size_t size;
+    std::array<std::uint32_t, kBuckets> displacements;
+
+    constexpr std::size_t IndexOf(std::uint64_t key) const
+    {
+        if (dense)
+        {
+            return static_cast<std::size_t>(key - base);
+        }
+
+        if (multiplier != 0)
+        {
+            return static_cast<std::size_t>((key * multiplier) >> shift);
+        }
+
+        const std::uint64_t hash = delegate_table_mix(key ^ seed);
+        return static_cast<std::size_t>(hash & (size - 1)) ^ displacements[static_cast<std::size_t>(hash >> shift)];
+    }
+};
+
+template<std::size_t N>
+constexpr bool place_delegate_table_keys(DelegateTableLayout<N>& layout, const std::array<std::uint64_t, N>& keys)
+{
+    constexpr std::size_t kBuckets = DelegateTableLayout<N>::kBuckets;
+    const std::size_t mask = layout.size - 1;
+
+    // Low bits of the hashes grouped by bucket: bucket b holds slots[starts[b]] up to slots[starts[b + 1]].
+    std::array<std::size_t, N> slots = {};
+    std::array<std::size_t, kBuckets + 1> starts = {};
+    std::array<std::size_t, N> bucketOf = {};
+    for (std::size_t i = 0; i < N; i++)
+    {
+        const std::uint64_t hash = delegate_table_mix(keys[i] ^ layout.seed);
+        bucketOf[i] = static_cast<std::size_t>(hash >> layout.shift);
+        slots[i] = static_cast<std::size_t>(hash & mask);
+        ++starts[bucketOf[i] + 1];
+    }
+
+    std::size_t largest = 0;
+    for (std::size_t bucket = 0; bucket < kBuckets; bucket++)
+    {
+        largest = starts[bucket + 1] > largest ? starts[bucket + 1] : largest;
+        starts[bucket + 1] += starts[bucket];
+    }
+
+    std::array<std::size_t, N> grouped = {};
+    std::array<std::size_t, kBuckets> fill = {};
+    for (std::size_t i = 0; i < N; i++)
+    {
+        grouped[starts[bucketOf[i]] + fill[bucketOf[i]]++] = slots[i];
+    }
+
+    // A displacement moves all keys of a bucket alike, keys sharing a bucket and low bits never separate.
+    for (std::size_t bucket = 0; bucket < kBuckets; bucket++)
+    {
+        for (std::size_t i = starts[bucket]; i < starts[bucket + 1]; i++)
+        {
+            for (std::size_t j = starts[bucket]; j < i; j++)
+            {
+                if (grouped[i] == grouped[j])
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    std::array<bool, N * 5 / 2 + 4> taken = {};
+    for (std::size_t bucketSize = largest; bucketSize > 0; bucketSize--)
+    {
+        for (std::size_t bucket = 0; bucket < kBuckets; bucket++)
+        {
+            const std::size_t begin = starts[bucket];
+            const std::size_t end = starts[bucket + 1];
+            if (end - begin != bucketSize)
+            {
+                continue;
+            }
+
+            std::size_t displacement = 0;
+            for (; displacement < layout.size; displacement++)
+            {
+                bool fits = true;
+                for (std::size_t i = begin; i < end && fits; i++)
+                {
+                    fits = !taken[grouped[i] ^ displacement];
+                }
+
+                if (fits)
+                {
+                    break;
+                }
+            }
+
+            if (displacement == layout.size)
+            {
+                return false;
+            }
+
+            layout.displacements[bucket] = static_cast<std::uint32_t>(displacement);
+            for (std::size_t i = begin; i < end; i++)
+            {
+                taken[grouped[i] ^ displacement] = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+// A layout of size 0 means that none was found.
+template<std::size_t N>
+constexpr DelegateTableLayout<N> make_delegate_table_layout(const std::array<std::uint64_t, N>& keys)
+{
+    DelegateTableLayout<N> layout = {};
+    if (!delegate_table_keys_unique(keys))
+    {
+        return layout;
+    }
+
+    std::uint64_t lowest = keys[0];
+    std::uint64_t highest = keys[0];
+    for (std::size_t i = 1; i < N; i++)
+    {
+        lowest = keys[i] < lowest ? keys[i] : lowest;
+        highest = keys[i] > highest ? keys[i] : highest;
+    }
+
+    // Up to four slots per entry are cheaper than hashing.
+    if (highest - lowest < 4 * N + 16)
+    {
+        layout.dense = true;
+        layout.base = lowest;
+        layout.size = static_cast<std::size_t>(highest - lowest + 1);
+        return layout;
+    }
+
+    // A single multiply is the cheapest index, but it only maps a handful of keys without collisions.
+    for (unsigned bits = 1; bits < 32 && (std::size_t(1) << bits) <= 4 * N; bits++)
+    {
+        const std::size_t size = std::size_t(1) << bits;
+        if (size < 2 * N)
+        {
+            continue;
+        }
+
+        std::uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+        for (int attempt = 0; attempt < 64; attempt++, multiplier += 2 * 0x9e3779b97f4a7c15ull)
+        {
+            std::array<bool, 4 * N> taken = {};
+            bool collides = false;
+            for (std::size_t i = 0; i < N && !collides; i++)
+            {
+                const std::size_t index = static_cast<std::size_t>((keys[i] * (multiplier | 1)) >> (64 - bits));
+                collides = taken[index];
+                taken[index] = true;
+            }
+
+            if (!collides)
+            {
+                layout.multiplier = multiplier | 1;
+                layout.shift = 64 - bits;
+                layout.size = size;
+                return layout;
+            }
+        }
+    }
+
+    unsigned bucketBits = 0;
+    while ((std::size_t(1) << bucketBits) < DelegateTableLayout<N>::kBuckets)
+    {
+        bucketBits++;
+    }
+
+    layout.shift = 64 - bucketBits;
+    layout.size = delegate_table_pow2(N + N / 4);
+    for (int attempt = 0; attempt < 64; attempt++)
+    {
+        layout.seed = delegate_table_mix(0x9e3779b97f4a7c15ull * static_cast<std::uint64_t>(attempt + 1));
+        layout.displacements = {};
+        if (place_delegate_table_keys(layout, keys))
+        {
+            return layout;
+        }
+    }
+
+    layout.size = 0;
+    return layout;
+}
+
+template<typename>
+struct DelegateTableTarget;
+
+template<typename TReturn, typename... TArgs>
+struct DelegateTableTarget<TReturn(TArgs...)>
+{
+    using FuncPtr = TReturn (*)(TArgs...);
+
+    template<auto Func>
+    static TReturn Call(TArgs... args)
+    {
+        return std::invoke(Func, std::forward<TArgs>(args)...);
+    }
+
+    // Functions of exactly the table signature are stored as they are, anything else through Call.
+    template<auto Func>
+    static constexpr FuncPtr Get()
+    {
+        if constexpr (std::is_convertible_v<decltype(Func), FuncPtr>)
+        {
+            return Func;
+        }
+        else
+        {
+            return &Call<Func>;
+        }
+    }
+};
+
+template<std::size_t Size, std::size_t N>
+constexpr std::array<std::uint64_t, Size> make_delegate_table_keys(const DelegateTableLayout<N>& layout,
+                                                                   const std::array<std::uint64_t, N>& keys)
+{
+    // Empty slots hold the first key, which sits in a slot of its own, so no key that maps to them matches.
+    std::array<std::uint64_t, Size> slots = {};
+    if (layout.size == 0)
+    {
+        return slots;
+    }
+
+    for (std::uint64_t& slot : slots)
+    {
+        slot = keys[0];
+    }
+    for (const std::uint64_t key : keys)
+    {
+        slots[layout.IndexOf(key)] = key;
+    }
+
+    return slots;
+}
+
+template<typename TSignature, std::size_t Size, typename... TEntries>
+constexpr auto make_delegate_table_targets(const DelegateTableLayout<sizeof...(TEntries)>& layout)
+{
+    std::array<typename DelegateTableTarget<TSignature>::FuncPtr, Size> targets = {};
+    if (layout.size != 0)
+    {
+        ((targets[layout.IndexOf(delegate_table_key(TEntries::key))] = DelegateTableTarget<TSignature>::template Get<TEntries::func>()),
+         ...);
+    }
+    return targets;
+}
+} // namespace detail
+
+template<typename TKey, typename TSignature, typename... TEntries>
+class DelegateTable;
+
+// Dispatch table from keys, e.g. opcodes or message ids, to targets known at compile time, computed
+// entirely in constant expressions: the targets are function pointers in a static constexpr array, so
+// the table needs no construction at startup and lives in read only data. A call is a range check, one
+// indexed load of the target and the call; sparse tables hash the key, load the displacement of its
+// bucket and compare the stored key instead of the range.
+//
+// Keys that span a small range index the array directly; sparse keys are remapped to an array of at most
+// four slots per key by a multiplicative or displacement hash chosen at compile time so that no two keys
+// collide, which stays within the default constant evaluation limits for thousands of keys. Duplicate
+// keys do not compile.
+//
+//     using OpTable = DelegateTable<Op, void(Vm&, const Instr&),
+//                                   DelegateTableEntry<Op::Add, &Vm::Add>, DelegateTableEntry<Op::Halt, &halt>>;
+//     OpTable::Invoke(instr.op, vm, instr);
+template<typename TKey, typename TReturn, typename... TArgs, typename... TEntries>
+class DelegateTable<TKey, TReturn(TArgs...), TEntries...>
+{
+    static_assert(std::is_enum_v<TKey> || std::is_integral_v<TKey>, "DelegateTable keys must be enumerators or integers");
+    static_assert(sizeof...(TEntries) > 0, "a DelegateTable needs at least one entry");
+    static_assert((std::is_same_v<std::decay_t<decltype(TEntries::key)>, TKey> && ...), "all entry keys must have the key type");
+
+public:
+    using FuncPtr = TReturn (*)(TArgs...);
+
+public:
+    static constexpr std::size_t Size()
+    {
+        return sizeof...(TEntries);
+    }
+
+    // Slots of the target array, the footprint is that many keys and function pointers.
+    static constexpr std::size_t GetSlotCount()
+    {
+        return kLayout.size;
+    }
+
+    // The target for the key, nullptr if there is none.
+    static constexpr FuncPtr Find(TKey key)
+    {
+        const std::uint64_t k = detail::delegate_table_key(key);
+        const std::size_t index = kLayout.IndexOf(k);
+        if constexpr (kLayout.dense)
+        {
+            // A slot only ever holds the target of its own key.
+            return index < kLayout.size ? kTargets[index] : nullptr;
+        }
+        else
+        {
+            return kKeys[index] == k ? kTargets[index] : nullptr;
+        }
+    }
+
+    static constexpr bool Contains(TKey key)
+    {
+        const std::uint64_t k = detail::delegate_table_key(key);
+        const std::size_t index = kLayout.IndexOf(k);
+        return (!kLayout.dense || index < kLayout.size) && kKeys[index] == k;
+    }
+
+    // The key must be in the table.
+    static TReturn Invoke(TKey key, TArgs... args)
+    {
+        const FuncPtr target = Find(key);
+        assert(target != nullptr && "no DelegateTable entry for the key");
+        return target(std::forward<TArgs>(args)...);
+    }
+
+    // Returns false if the key is not in the table.
+    template<typename TResult = TReturn, std::enable_if_t<std::is_void_v<TResult>, int> = 0>
+    static bool TryInvoke(TKey key, TArgs... args)
+    {
+        const FuncPtr target = Find(key);
+        if (target == nullptr)
+        {
+            return false;
+        }
+
+        target(std::forward<TArgs>(args)...);
+        return true;
+    }
+
+    TReturn operator()(TKey key, TArgs... args) const
+    {
+        return Invoke(key, std::forward<TArgs>(args)...);
+    }
+
+    // A Delegate to the target for the key, empty if there is none.
+    static Delegate<TReturn(TArgs...)> GetDelegate(TKey key)
+    {
+        const FuncPtr target = Find(key);
+        return target != nullptr ? Delegate<TReturn(TArgs...)>::CreateGlobal(target) : Delegate<TReturn(TArgs...)>();
+    }
+
+private:
+    static constexpr std::array<std::uint64_t, sizeof...(TEntries)> kEntryKeys = {detail::delegate_table_key(TEntries::key)...};
+    static constexpr bool kUniqueKeys = detail::delegate_table_keys_unique(kEntryKeys);
+    static_assert(kUniqueKeys, "DelegateTable keys must be unique");
+
+    static constexpr detail::DelegateTableLayout<sizeof...(TEntries)> kLayout = detail::make_delegate_table_layout(kEntryKeys);
+    static_assert(!kUniqueKeys || kLayout.size > 0, "no collision free DelegateTable layout was found for the keys");
+
+    static constexpr std::array<std::uint64_t, kLayout.size> kKeys = detail::make_delegate_table_keys<kLayout.size>(kLayout, kEntryKeys);
+    static constexpr std::array<FuncPtr, kLayout.size> kTargets =
+        detail::make_delegate_table_targets<TReturn(TArgs...), kLayout.size, TEntries...>(kLayout);
+};
+} // namespace sdaineka
\ No newline at end of file
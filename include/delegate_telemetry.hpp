@@ -0,0 +1,196 @@
+#pragma once
+#include "delegate_type_name.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace sdaineka
+{
+// Payload sizes of the delegates of one type constructed so far.
+struct DelegateStorageStats
+{
+    // Sizes are counted in steps of a pointer up to kMaxHistogramSize bytes, larger ones share the last bucket.
+    static constexpr std::size_t kGranularity = sizeof(void*);
+    static constexpr std::size_t kMaxHistogramSize = 256;
+    static constexpr std::size_t kBuckets = kMaxHistogramSize / kGranularity + 1;
+
+    // Smallest multiple of kGranularity that holds the given fraction of the payloads. Falls back to the
+    // largest payload when the fraction reaches past the histogram.
+    std::size_t GetPercentileSize(double fraction) const
+    {
+        const auto threshold = static_cast<std::uint64_t>(fraction * static_cast<double>(constructed) + 0.5);
+
+        std::uint64_t covered = 0;
+        for (std::size_t i = 0; i + 1 < kBuckets; i++)
+        {
+            covered += histogram[i];
+            if (covered >= threshold)
+            {
+                return (i + 1) * kGranularity;
+            }
+        }
+
+        return (maxSize + kGranularity - 1) / kGranularity * kGranularity;
+    }
+
+    // Stack storage size for Delegate that keeps the given fraction of the payloads inline. It is never
+    // below the two pointers that a heap payload occupies.
+    std::size_t GetRecommendedSize(double fraction = 0.99) const
+    {
+        const std::size_t size = GetPercentileSize(fraction);
+        return size > 2 * sizeof(void*) ? size : 2 * sizeof(void*);
+    }
+
+    std::string_view delegate;
+    // Bytes stored in place, 0 for delegates that always allocate.
+    std::size_t inlineCapacity;
+    std::uint64_t constructed;
+    std::uint64_t heapFallbacks;
+    std::uint64_t heapBytes;
+    std::size_t maxSize;
+    // histogram[i] counts payloads of (i * kGranularity, (i + 1) * kGranularity] bytes.
+    std::array<std::uint64_t, kBuckets> histogram;
+};
+
+// Histogram of bound payload sizes per delegate type, recorded on construction when SDAINEKA_DELEGATE_TELEMETRY
+// is defined to 1 and compiled out otherwise.
+//
+// Delegate records the size of its saved target and bind arguments and whether it went to the heap,
+// SimpleHeapDelegate the size of its storage without the vtable pointer, which is what Delegate would
+// need to keep it inline. Use the recommended sizes to specialize DelegateStorageStackSize for the
+// signatures that matter. Clones are not counted.
+class DelegateStorageTelemetry
+{
+public:
+    struct Site
+    {
+        std::string_view delegate;
+        std::size_t inlineCapacity = 0;
+        std::atomic<std::uint64_t> constructed{0};
+        std::atomic<std::uint64_t> heapFallbacks{0};
+        std::atomic<std::uint64_t> heapBytes{0};
+        std::atomic<std::size_t> maxSize{0};
+        std::atomic<std::uint64_t> histogram[DelegateStorageStats::kBuckets] = {};
+    };
+
+public:
+    static DelegateStorageTelemetry* Get()
+    {
+        // Intentionally never destroyed: delegates may be constructed while statics are torn down.
+        static DelegateStorageTelemetry* instance = new DelegateStorageTelemetry();
+        return instance;
+    }
+
+    DelegateStorageTelemetry(const DelegateStorageTelemetry&) = delete;
+    DelegateStorageTelemetry& operator=(const DelegateStorageTelemetry&) = delete;
+
+    // Delegate types with at least one construction, in order of first construction.
+    std::vector<DelegateStorageStats> Collect() const
+    {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::vector<DelegateStorageStats> stats;
+        for (const std::unique_ptr<Site>& site : m_sites)
+        {
+            DelegateStorageStats s = {};
+            s.delegate = site->delegate;
+            s.inlineCapacity = site->inlineCapacity;
+            s.constructed = site->constructed.load(std::memory_order_relaxed);
+            s.heapFallbacks = site->heapFallbacks.load(std::memory_order_relaxed);
+            s.heapBytes = site->heapBytes.load(std::memory_order_relaxed);
+            s.maxSize = site->maxSize.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < DelegateStorageStats::kBuckets; i++)
+            {
+                s.histogram[i] = site->histogram[i].load(std::memory_order_relaxed);
+            }
+
+            if (s.constructed != 0)
+            {
+                stats.push_back(s);
+            }
+        }
+
+        return stats;
+    }
+
+    // One line per delegate type with the sizes that keep the given fraction of payloads inline.
+    void WriteCsv(std::ostream& out, double fraction = 0.99) const
+    {
+        out << "delegate,inline,constructed,heap_fallbacks,heap_bytes,max_size,p50_size,percentile_size,recommended\n";
+        for (const DelegateStorageStats& s : Collect())
+        {
+            out << '"';
+            for (const char c : s.delegate)
+            {
+                if (c == '"')
+                {
+                    out << '"';
+                }
+                out << c;
+            }
+            out << "\"," << s.inlineCapacity << ',' << s.constructed << ',' << s.heapFallbacks << ',' << s.heapBytes << ','
+                << s.maxSize << ',' << s.GetPercentileSize(0.5) << ',' << s.GetPercentileSize(fraction) << ','
+                << s.GetRecommendedSize(fraction) << '\n';
+        }
+    }
+
+    // Called once per delegate type. The name must have static storage duration.
+    Site* RegisterSite(std::string_view delegate, std::size_t inlineCapacity)
+    {
+        auto site = std::make_unique<Site>();
+        site->delegate = delegate;
+        site->inlineCapacity = inlineCapacity;
+
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_sites.push_back(std::move(site));
+        return m_sites.back().get();
+    }
+
+    static void Record(Site* site, std::size_t size, bool onHeap, std::size_t heapBytes)
+    {
+        site->constructed.fetch_add(1, std::memory_order_relaxed);
+        if (onHeap)
+        {
+            site->heapFallbacks.fetch_add(1, std::memory_order_relaxed);
+            site->heapBytes.fetch_add(heapBytes, std::memory_order_relaxed);
+        }
+
+        std::size_t maxSize = site->maxSize.load(std::memory_order_relaxed);
+        while (size > maxSize && !site->maxSize.compare_exchange_weak(maxSize, size, std::memory_order_relaxed))
+        {
+        }
+
+        const std::size_t bucket = size <= DelegateStorageStats::kMaxHistogramSize
+                                     ? (size + DelegateStorageStats::kGranularity - 1) / DelegateStorageStats::kGranularity
+                                     : DelegateStorageStats::kBuckets;
+        site->histogram[bucket > 0 ? bucket - 1 : 0].fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    DelegateStorageTelemetry() = default;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Site>> m_sites;
+};
+
+namespace detail
+{
+template<typename TDelegate>
+struct DelegateStorageSite
+{
+    static void Record(std::size_t inlineCapacity, std::size_t size, bool onHeap, std::size_t heapBytes)
+    {
+        static DelegateStorageTelemetry::Site* site =
+            DelegateStorageTelemetry::Get()->RegisterSite(delegate_type_name<TDelegate>(), inlineCapacity);
+        DelegateStorageTelemetry::Record(site, size, onHeap, heapBytes);
+    }
+};
+} // namespace detail
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+namespace sdaineka
+{
+namespace detail
+{
+// Name of T taken from the compiler's pretty function signature, a view into a string literal.
+template<typename T>
+const char* delegate_type_signature()
+{
+#if defined(_MSC_VER)
+    return __FUNCSIG__;
+#else
+    return __PRETTY_FUNCTION__;
+#endif
+}
+
+template<typename T>
+std::string_view delegate_type_name()
+{
+    std::string_view name = delegate_type_signature<T>();
+#if defined(_MSC_VER)
+    const std::string_view prefix = "delegate_type_signature<";
+    const std::string_view suffix = ">(void)";
+#else
+    const std::string_view prefix = "T = ";
+    const std::string_view suffix = "]";
+#endif
+    const std::size_t begin = name.find(prefix);
+    if (begin != std::string_view::npos && name.size() >= begin + prefix.size() + suffix.size())
+    {
+        name = name.substr(begin + prefix.size(), name.size() - begin - prefix.size() - suffix.size());
+    }
+
+    return name;
+}
+} // namespace detail
+} // namespace sdaineka
\ No newline at end of file
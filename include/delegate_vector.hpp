@@ -0,0 +1,307 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sdaineka
+{
+// Identifies an element of a DelegateVector. Handles of removed elements are never reused.
+struct DelegateVectorHandle
+{
+    std::uint32_t slot = ~0u;
+    std::uint32_t generation = 0;
+};
+
+// Structure of arrays container of delegates, grouped by bound target type.
+//
+// Added delegates are taken apart: the payload moves into the bucket of its target type, where payloads
+// are packed at the size of that type rather than the full stack storage, and the invoker and storage
+// operations are kept once per bucket. InvokeAll() runs one loop per bucket that calls the target
+// directly, so a list of many delegates bound to a handful of member functions costs a handful of
+// indirect calls, and the calls of one bucket run back to back. The target type is that of the stored
+// payload: Create<&Bar::Update>() gives one bucket per function, while CreateMember() delegates of the same
+// class share a bucket and still call through the stored member pointer. Delegates run grouped by target
+// type, in order of the first delegate of each type; within a bucket removal swaps the last element into
+// the freed position. Elements must not be added or removed from within InvokeAll().
+template<typename TReturn, typename... TArgs>
+class DelegateVector<TReturn(TArgs...)>
+{
+public:
+    using DelegateType = Delegate<TReturn(TArgs...)>;
+    using Handle = DelegateVectorHandle;
+
+    static_assert((std::is_constructible_v<TArgs, TArgs&> && ...),
+                  "InvokeAll passes the same arguments to every delegate, parameters must be copyable or lvalue references");
+
+public:
+    DelegateVector() = default;
+
+    DelegateVector(const DelegateVector&) = delete;
+    DelegateVector& operator=(const DelegateVector&) = delete;
+    DelegateVector(DelegateVector&&) noexcept = default;
+    DelegateVector& operator=(DelegateVector&&) noexcept = default;
+
+    Handle Add(DelegateType delegate)
+    {
+        assert(delegate && "empty delegates can not be added");
+        assert(!m_invoking && "elements must not change during InvokeAll");
+
+        const std::uint32_t bucketIndex = FindOrAddBucket(delegate.m_ops);
+        Bucket& bucket = m_buckets[bucketIndex];
+        bucket.Reserve(bucket.slots.size() + 1);
+
+        std::uint32_t slot;
+        if (!m_freeSlots.empty())
+        {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<std::uint32_t>(m_slots.size());
+            m_slots.push_back({});
+        }
+
+        const auto denseIndex = static_cast<std::uint32_t>(bucket.slots.size());
+        bucket.slots.push_back(slot);
+        Relocate(*bucket.ops, bucket.Get(denseIndex), delegate.m_storage.data);
+        delegate.m_invoker = nullptr;
+        delegate.m_ops = nullptr;
+
+        m_slots[slot].bucket = bucketIndex;
+        m_slots[slot].denseIndex = denseIndex;
+        ++m_size;
+
+        return {slot, m_slots[slot].generation};
+    }
+
+    // Returns false if the handle does not refer to a live element.
+    bool Remove(Handle handle)
+    {
+        assert(!m_invoking && "elements must not change during InvokeAll");
+
+        if (!Contains(handle))
+        {
+            return false;
+        }
+
+        Slot& slot = m_slots[handle.slot];
+        Bucket& bucket = m_buckets[slot.bucket];
+        const std::uint32_t index = slot.denseIndex;
+        const auto last = static_cast<std::uint32_t>(bucket.slots.size() - 1);
+
+        Destroy(*bucket.ops, bucket.Get(index));
+        if (index != last)
+        {
+            Relocate(*bucket.ops, bucket.Get(index), bucket.Get(last));
+            bucket.slots[index] = bucket.slots[last];
+            m_slots[bucket.slots[index]].denseIndex = index;
+        }
+
+        bucket.slots.pop_back();
+        --m_size;
+
+        ++slot.generation;
+        m_freeSlots.push_back(handle.slot);
+
+        return true;
+    }
+
+    bool Contains(Handle handle) const
+    {
+        return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation;
+    }
+
+    // Calls every delegate with the same arguments, results are discarded. A target that throws ends the call,
+    // the exception reaches the caller.
+    void InvokeAll(TArgs... args) const
+    {
+        struct InvokeScope
+        {
+            ~InvokeScope()
+            {
+                self->SetInvoking(false);
+            }
+
+            const DelegateVector* self;
+        };
+
+        SetInvoking(true);
+        const InvokeScope scope{this};
+
+        for (const Bucket& bucket : m_buckets)
+        {
+            if (!bucket.slots.empty())
+            {
+                bucket.ops->invokeEach(bucket.Get(0), bucket.slots.size(), args...);
+            }
+        }
+    }
+
+    // Buckets are kept, so refilling the container with the same target types does not allocate.
+    void Clear()
+    {
+        assert(!m_invoking && "elements must not change during InvokeAll");
+
+        for (Bucket& bucket : m_buckets)
+        {
+            for (const std::uint32_t slot : bucket.slots)
+            {
+                ++m_slots[slot].generation;
+                m_freeSlots.push_back(slot);
+            }
+
+            bucket.Clear();
+        }
+
+        m_size = 0;
+    }
+
+    std::size_t Size() const
+    {
+        return m_size;
+    }
+
+    bool Empty() const
+    {
+        return m_size == 0;
+    }
+
+    // Number of distinct target types added so far.
+    std::size_t GetBucketCount() const
+    {
+        return m_buckets.size();
+    }
+
+private:
+    using Ops = typename DelegateType::Ops;
+
+    struct alignas(void*) Word
+    {
+        std::byte data[sizeof(void*)];
+    };
+
+    // Packed payloads of one target type, slots maps each payload back to its handle.
+    struct Bucket
+    {
+        explicit Bucket(const Ops* ops)
+            : ops(ops)
+        {
+        }
+
+        Bucket(Bucket&&) noexcept = default;
+        Bucket& operator=(Bucket&&) = delete;
+
+        ~Bucket()
+        {
+            Clear();
+        }
+
+        std::byte* Get(std::size_t index) const
+        {
+            return reinterpret_cast<std::byte*>(payloads.get()) + index * ops->payloadStride;
+        }
+
+        void Reserve(std::size_t count)
+        {
+            if (count <= capacity)
+            {
+                return;
+            }
+
+            const std::size_t newCapacity = std::max<std::size_t>(count, capacity * 2);
+            auto grown = std::make_unique<Word[]>(newCapacity * ops->payloadStride / sizeof(Word));
+            for (std::size_t i = 0; i < slots.size(); i++)
+            {
+                Relocate(*ops, reinterpret_cast<std::byte*>(grown.get()) + i * ops->payloadStride, Get(i));
+            }
+
+            payloads = std::move(grown);
+            capacity = newCapacity;
+        }
+
+        void Clear()
+        {
+            for (std::size_t i = 0; i < slots.size(); i++)
+            {
+                Destroy(*ops, Get(i));
+            }
+
+            slots.clear();
+        }
+
+        const Ops* ops;
+        std::unique_ptr<Word[]> payloads;
+        std::size_t capacity = 0;
+        std::vector<std::uint32_t> slots;
+    };
+
+    // A slot's generation is bumped whenever its element is removed, which invalidates old handles.
+    struct Slot
+    {
+        std::uint32_t bucket = 0;
+        std::uint32_t denseIndex = 0;
+        std::uint32_t generation = 0;
+    };
+
+    // Moves a payload and ends its lifetime in src. Payloads without a relocate entry are copied bytewise.
+    static void Relocate(const Ops& ops, std::byte* dst, std::byte* src)
+    {
+        if (ops.relocate != nullptr)
+        {
+            ops.relocate(dst, src);
+        }
+        else
+        {
+            std::memcpy(dst, src, ops.payloadStride);
+        }
+    }
+
+    static void Destroy(const Ops& ops, std::byte* payload)
+    {
+        if (ops.destroy != nullptr)
+        {
+            ops.destroy(payload);
+        }
+    }
+
+    // The ops table is unique per target type. Few distinct types are expected, so buckets are searched linearly.
+    std::uint32_t FindOrAddBucket(const Ops* ops)
+    {
+        for (std::size_t i = 0; i < m_buckets.size(); i++)
+        {
+            if (m_buckets[i].ops == ops)
+            {
+                return static_cast<std::uint32_t>(i);
+            }
+        }
+
+        m_buckets.emplace_back(ops);
+        return static_cast<std::uint32_t>(m_buckets.size() - 1);
+    }
+
+    void SetInvoking([[maybe_unused]] bool invoking) const
+    {
+#ifndef NDEBUG
+        m_invoking = invoking;
+#endif
+    }
+
+    std::vector<Bucket> m_buckets;
+    std::vector<Slot> m_slots;
+    std::vector<std::uint32_t> m_freeSlots;
+    std::size_t m_size = 0;
+
+#ifndef NDEBUG
+    mutable bool m_invoking = false;
+#endif
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,256 @@
+#pragma once
+#include "delegate.hpp"
+
+#if defined(__linux__)
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace sdaineka
+{
+// Linux event loop that calls a Delegate<void(int fd, std::uint32_t events)> handler per ready file
+// descriptor. Linux only, the header is empty elsewhere.
+//
+// Handlers live in a table indexed by file descriptor, in chunks that never move, so a registration
+// stores the handler inline and Poll() dispatches an epoll_wait batch through it without allocating.
+// Every registration carries a generation in the epoll event data: events of a descriptor that was
+// removed, or removed and registered again, earlier in the same batch are dropped. Handlers may add,
+// modify and remove descriptors, including their own; removing its own registration destroys the
+// handler once it returns. The reactor does not own the descriptors and does not close them.
+//
+// Not thread safe. Registration functions return false and leave errno set on failure.
+class EventReactor
+{
+public:
+    using Handler = Delegate<void(int /*fd*/, std::uint32_t /*events*/)>;
+
+public:
+    // Throws std::system_error if the epoll instance can not be created.
+    explicit EventReactor(std::size_t maxEvents = 256)
+        : m_epollFd(epoll_create1(EPOLL_CLOEXEC))
+        , m_events(maxEvents > 0 ? maxEvents : 1)
+    {
+        if (m_epollFd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "epoll_create1");
+        }
+    }
+
+    EventReactor(const EventReactor&) = delete;
+    EventReactor& operator=(const EventReactor&) = delete;
+
+    ~EventReactor()
+    {
+        close(m_epollFd);
+    }
+
+    // Registers fd for the given EPOLL* events, e.g. EPOLLIN | EPOLLET.
+    bool Add(int fd, std::uint32_t events, Handler handler)
+    {
+        assert(handler && "empty handlers can not be registered");
+
+        if (fd < 0)
+        {
+            errno = EBADF;
+            return false;
+        }
+
+        Entry& entry = GetOrCreateEntry(fd);
+        if (entry.registered)
+        {
+            errno = EEXIST;
+            return false;
+        }
+
+        if (!Control(EPOLL_CTL_ADD, fd, events, entry.generation + 1))
+        {
+            return false;
+        }
+
+        ++entry.generation;
+        entry.registered = true;
+        SetHandler(fd, entry, std::move(handler));
+        ++m_size;
+        return true;
+    }
+
+    bool Modify(int fd, std::uint32_t events)
+    {
+        Entry* entry = FindRegistered(fd);
+        if (entry == nullptr)
+        {
+            errno = ENOENT;
+            return false;
+        }
+
+        return Control(EPOLL_CTL_MOD, fd, events, entry->generation);
+    }
+
+    // Removes the registration and destroys its handler. Call it before closing the descriptor.
+    bool Remove(int fd)
+    {
+        Entry* entry = FindRegistered(fd);
+        if (entry == nullptr)
+        {
+            errno = ENOENT;
+            return false;
+        }
+
+        // A descriptor that was already closed has left the epoll set, it is still unregistered here.
+        const bool removed = Control(EPOLL_CTL_DEL, fd, 0, entry->generation) || errno == EBADF;
+
+        ++entry->generation;
+        entry->registered = false;
+        SetHandler(fd, *entry, Handler());
+        --m_size;
+        return removed;
+    }
+
+    bool IsRegistered(int fd) const
+    {
+        return FindRegistered(fd) != nullptr;
+    }
+
+    // Waits up to timeoutMs milliseconds, -1 for no limit, and calls the handlers of the ready descriptors.
+    // Returns the number of handlers called, 0 when interrupted by a signal and -1 with errno set on
+    // failure. Must not be called from a handler.
+    int Poll(int timeoutMs)
+    {
+        // Ends the dispatch of a handler and installs the handler set while it ran, also when it throws. The
+        // exception reaches the caller, the remaining ready descriptors are reported again by the next Poll().
+        struct DispatchScope
+        {
+            ~DispatchScope()
+            {
+                self->m_dispatchingFd = -1;
+                if (self->m_hasDeferred)
+                {
+                    entry->handler = std::move(self->m_deferred);
+                    self->m_hasDeferred = false;
+                }
+            }
+
+            EventReactor* self;
+            Entry* entry;
+        };
+
+        assert(m_dispatchingFd < 0 && "Poll must not be called from a handler");
+
+        const int count = epoll_wait(m_epollFd, m_events.data(), static_cast<int>(m_events.size()), timeoutMs);
+        if (count < 0)
+        {
+            return errno == EINTR ? 0 : -1;
+        }
+
+        int dispatched = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const std::uint64_t data = m_events[i].data.u64;
+            const auto fd = static_cast<int>(data & 0xffffffffu);
+            const auto generation = static_cast<std::uint32_t>(data >> 32);
+
+            Entry* entry = FindRegistered(fd);
+            if (entry == nullptr || entry->generation != generation)
+            {
+                continue;
+            }
+
+            m_dispatchingFd = fd;
+            {
+                const DispatchScope scope{this, entry};
+                entry->handler(fd, m_events[i].events);
+            }
+
+            ++dispatched;
+        }
+
+        return dispatched;
+    }
+
+    std::size_t Size() const
+    {
+        return m_size;
+    }
+
+    // The epoll descriptor, e.g. to nest the reactor into another event loop.
+    int GetFd() const
+    {
+        return m_epollFd;
+    }
+
+private:
+    static constexpr std::size_t kChunkBits = 10;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << kChunkBits;
+
+    struct Entry
+    {
+        Handler handler;
+        std::uint32_t generation = 0;
+        bool registered = false;
+    };
+
+    bool Control(int op, int fd, std::uint32_t events, std::uint32_t generation)
+    {
+        epoll_event event = {};
+        event.events = events;
+        event.data.u64 = (static_cast<std::uint64_t>(generation) << 32) | static_cast<std::uint32_t>(fd);
+        return epoll_ctl(m_epollFd, op, fd, &event) == 0;
+    }
+
+    // Entries never move, a handler may register descriptors while it runs.
+    Entry& GetOrCreateEntry(int fd)
+    {
+        const auto chunk = static_cast<std::size_t>(fd) >> kChunkBits;
+        while (m_chunks.size() <= chunk)
+        {
+            m_chunks.push_back(std::make_unique<Entry[]>(kChunkSize));
+        }
+
+        return m_chunks[chunk][static_cast<std::size_t>(fd) & (kChunkSize - 1)];
+    }
+
+    Entry* FindRegistered(int fd) const
+    {
+        const auto chunk = static_cast<std::size_t>(fd) >> kChunkBits;
+        if (fd < 0 || chunk >= m_chunks.size())
+        {
+            return nullptr;
+        }
+
+        Entry* entry = &m_chunks[chunk][static_cast<std::size_t>(fd) & (kChunkSize - 1)];
+        return entry->registered ? entry : nullptr;
+    }
+
+    // The handler that is running can not be replaced in place, it is swapped once it returns.
+    void SetHandler(int fd, Entry& entry, Handler handler)
+    {
+        if (fd == m_dispatchingFd)
+        {
+            m_deferred = std::move(handler);
+            m_hasDeferred = true;
+        }
+        else
+        {
+            entry.handler = std::move(handler);
+        }
+    }
+
+    int m_epollFd;
+    std::vector<epoll_event> m_events;
+    std::vector<std::unique_ptr<Entry[]>> m_chunks;
+    std::size_t m_size = 0;
+
+    int m_dispatchingFd = -1;
+    Handler m_deferred;
+    bool m_hasDeferred = false;
+};
+} // namespace sdaineka
+#endif
\ No newline at end of file
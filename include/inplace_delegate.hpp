@@ -0,0 +1,308 @@
+#pragma once
+#include "delegate.hpp"
+#include "delegate_common.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace sdaineka
+{
+// Type stored by a delegate for a binding, given the arguments passed to its factory: the target followed by
+// the bind arguments, e.g. delegate_target_t<decltype(lambda), int> for CreateLambda(lambda, 5) or
+// delegate_target_t<decltype(&Bar::add_2), Bar*, int> for CreateMember(&bar, &Bar::add_2, 5). For
+// Create<Func>() only the arguments are listed, e.g. delegate_target_t<Bar*, int>.
+template<typename... TFactoryArgs>
+using delegate_target_t = std::tuple<std::decay_t<TFactoryArgs>...>;
+
+// Minimal InplaceDelegate capacity and alignment that fit every listed target type.
+template<typename... TTargets>
+constexpr std::size_t inplace_delegate_capacity_v = std::max({std::size_t{1}, sizeof(TTargets)...});
+
+template<typename... TTargets>
+constexpr std::size_t inplace_delegate_alignment_v = std::max({alignof(void*), alignof(TTargets)...});
+
+template<typename, std::size_t Capacity, std::size_t Alignment = alignof(void*)>
+class InplaceDelegate;
+
+// Delegate that never allocates.
+//
+// Bindings are always stored in the Capacity bytes inside the object; a binding that does not fit, is over
+// aligned or could throw while being moved fails to compile. The factories and calls mirror Delegate's and
+// share its invokers.
+template<typename TReturn, typename... TArgs, std::size_t Capacity, std::size_t Alignment>
+class InplaceDelegate<TReturn(TArgs...), Capacity, Alignment>
+{
+public:
+    template<typename... TBindArgs>
+    using GlobalFuncPtr = TReturn (*)(TArgs..., delegate_bind_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using MemberFuncPtr = TReturn (TClass::*)(TArgs..., delegate_bind_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using MemberFuncPtrConst = TReturn (TClass::*)(TArgs..., delegate_bind_arg_t<TBindArgs>...) const;
+
+    // Targets taking bound arguments over, see delegate_bind_once_arg_t.
+    template<typename... TBindArgs>
+    using OnceGlobalFuncPtr = TReturn (*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using OnceMemberFuncPtr = TReturn (TClass::*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using OnceMemberFuncPtrConst = TReturn (TClass::*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...) const;
+
+private:
+    template<typename... TBindArgs>
+    static constexpr bool HasOnceTarget()
+    {
+        return !std::is_same_v<GlobalFuncPtr<TBindArgs...>, OnceGlobalFuncPtr<TBindArgs...>>;
+    }
+
+public:
+    InplaceDelegate() = default;
+
+    InplaceDelegate(const InplaceDelegate&) = delete;
+    InplaceDelegate& operator=(const InplaceDelegate&) = delete;
+
+    InplaceDelegate(InplaceDelegate&& other) noexcept
+    {
+        MoveFrom(other);
+    }
+
+    InplaceDelegate& operator=(InplaceDelegate&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Release();
+            MoveFrom(other);
+        }
+
+        return *this;
+    }
+
+    ~InplaceDelegate()
+    {
+        Release();
+    }
+
+    template<typename... TBindArgs>
+    static InplaceDelegate CreateGlobal(GlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return MakeBound<1, std::tuple<GlobalFuncPtr<TBindArgs...>, TBindArgs...>>(func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs>
+    static InplaceDelegate CreateMember(TClass* cls, MemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return MakeBound<2, std::tuple<MemberFuncPtr<TClass, TBindArgs...>, TClass*, TBindArgs...>>(func, cls, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs>
+    static InplaceDelegate CreateMember(const TClass* cls, MemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return MakeBound<2, std::tuple<MemberFuncPtrConst<TClass, TBindArgs...>, const TClass*, TBindArgs...>>(func, cls,
+                                                                                                              std::move(bindArgs)...);
+    }
+
+    // Targets that take bound arguments over, only callable with InvokeOnce().
+    template<typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static InplaceDelegate CreateGlobal(OnceGlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return MakeBound<1, std::tuple<OnceGlobalFuncPtr<TBindArgs...>, TBindArgs...>>(func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static InplaceDelegate CreateMember(TClass* cls, OnceMemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return MakeBound<2, std::tuple<OnceMemberFuncPtr<TClass, TBindArgs...>, TClass*, TBindArgs...>>(func, cls, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static InplaceDelegate CreateMember(const TClass* cls, OnceMemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return MakeBound<2, std::tuple<OnceMemberFuncPtrConst<TClass, TBindArgs...>, const TClass*, TBindArgs...>>(func, cls,
+                                                                                                                  std::move(bindArgs)...);
+    }
+
+    template<typename TFunc, typename... TBindArgs>
+    static InplaceDelegate CreateLambda(TFunc&& func, TBindArgs... bindArgs)
+    {
+        return MakeBound<1, std::tuple<std::decay_t<TFunc>, TBindArgs...>>(std::forward<TFunc>(func), std::move(bindArgs)...);
+    }
+
+    // Binds a target known at compile time, see Delegate::Create().
+    template<auto Func, typename... TBindArgs>
+    static InplaceDelegate Create(TBindArgs... bindArgs)
+    {
+        constexpr std::size_t ObjectArgsSize = std::is_member_pointer_v<decltype(Func)> ? 1 : 0;
+        static_assert(sizeof...(TBindArgs) >= ObjectArgsSize, "member function targets need an object pointer");
+
+        using SavedArgsTuple = std::tuple<TBindArgs...>;
+        constexpr std::size_t BindArgsSize = sizeof...(TBindArgs) - ObjectArgsSize;
+        return Make<SavedArgsTuple, Invokers::template InvokeStatic<Func, ObjectArgsSize, BindArgsSize, SavedArgsTuple, false>,
+                    Invokers::template InvokeStatic<Func, ObjectArgsSize, BindArgsSize, SavedArgsTuple, true>>(std::move(bindArgs)...);
+    }
+
+    // True when a binding stored as TSavedArgsTuple, see delegate_target_t, fits into this delegate.
+    template<typename TSavedArgsTuple>
+    static constexpr bool Fits()
+    {
+        return sizeof(TSavedArgsTuple) <= Capacity && alignof(TSavedArgsTuple) <= Alignment
+            && std::is_nothrow_move_constructible_v<TSavedArgsTuple>;
+    }
+
+    TReturn operator()(TArgs... args) const&
+    {
+        return m_invoker(const_cast<std::byte*>(m_storage), std::forward<TArgs>(args)...);
+    }
+
+    // Calling an rvalue delegate is a one-shot call, see InvokeOnce().
+    TReturn operator()(TArgs... args) &&
+    {
+        return InvokeOnce(std::forward<TArgs>(args)...);
+    }
+
+    // Calls the target with the target object and the bound arguments moved out of the delegate, which is
+    // empty afterwards, see Delegate::InvokeOnce().
+    TReturn InvokeOnce(TArgs... args)
+    {
+        const ReleaseOnExit release{this};
+        return m_ops->invokeOnce(m_storage, std::forward<TArgs>(args)...);
+    }
+
+    // Calls the delegate count times, see Delegate::InvokeBatch().
+    void InvokeBatch(std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const
+    {
+        m_ops->invokeBatch(const_cast<std::byte*>(m_storage), nullptr, count, args...);
+    }
+
+    template<typename TResult = TReturn, std::enable_if_t<std::is_object_v<TResult>, int> = 0>
+    void InvokeBatch(TResult* results, std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const
+    {
+        m_ops->invokeBatch(const_cast<std::byte*>(m_storage), results, count, args...);
+    }
+
+    template<typename TRange>
+    void ForEach(TRange&& range) const
+    {
+        static_assert(sizeof...(TArgs) == 1, "ForEach requires a delegate taking a single argument");
+        InvokeBatch(std::size(range), std::data(range));
+    }
+
+    operator bool() const
+    {
+        return m_invoker != nullptr;
+    }
+
+    bool IsCopyable() const
+    {
+        return m_ops != nullptr && m_ops->copy != nullptr;
+    }
+
+    // Returns a copy of this delegate, or an empty delegate if it is empty or not copyable.
+    InplaceDelegate Clone() const
+    {
+        InplaceDelegate result;
+
+        if (IsCopyable())
+        {
+            m_ops->copy(result.m_storage, m_storage);
+            result.m_invoker = m_invoker;
+            result.m_ops = m_ops;
+        }
+
+        return result;
+    }
+
+    static constexpr std::size_t GetCapacity()
+    {
+        return Capacity;
+    }
+
+private:
+    static_assert(Capacity > 0, "InplaceDelegate capacity must not be zero");
+    static_assert(Alignment >= alignof(void*) && (Alignment & (Alignment - 1)) == 0,
+                  "InplaceDelegate alignment must be a power of two of at least alignof(void*)");
+
+    using Storage = detail::DelegateInplaceStorage<Alignment>;
+    using Invokers = detail::DelegateInvokers<TReturn(TArgs...), Storage>;
+    using InvokeFunc = typename Invokers::InvokeFunc;
+    using Ops = typename Invokers::Ops;
+
+    struct ReleaseOnExit
+    {
+        ~ReleaseOnExit()
+        {
+            delegate->Release();
+        }
+
+        InplaceDelegate* delegate;
+    };
+
+    template<typename TSavedArgsTuple, InvokeFunc Invoker, InvokeFunc OnceInvoker, typename... TCtorArgs>
+    static InplaceDelegate Make(TCtorArgs&&... ctorArgs)
+    {
+        static_assert(sizeof(TSavedArgsTuple) <= Capacity,
+                      "InplaceDelegate: the binding does not fit into Capacity, see inplace_delegate_capacity_v");
+        static_assert(alignof(TSavedArgsTuple) <= Alignment,
+                      "InplaceDelegate: the binding is over aligned for Alignment, see inplace_delegate_alignment_v");
+        static_assert(std::is_nothrow_move_constructible_v<TSavedArgsTuple>,
+                      "InplaceDelegate: the bound target and arguments must be nothrow move constructible");
+
+        InplaceDelegate result;
+        Storage::template ConstructSavedArgs<TSavedArgsTuple>(result.m_storage, nullptr, std::forward<TCtorArgs>(ctorArgs)...);
+        result.m_invoker = Invoker;
+        result.m_ops = Invokers::template GetOps<TSavedArgsTuple, Invoker, OnceInvoker>();
+
+        return result;
+    }
+
+    void MoveFrom(InplaceDelegate& other)
+    {
+        if (other.m_ops != nullptr && other.m_ops->relocate != nullptr)
+        {
+            other.m_ops->relocate(m_storage, other.m_storage);
+        }
+        else
+        {
+            std::memcpy(m_storage, other.m_storage, Capacity);
+        }
+
+        m_invoker = other.m_invoker;
+        m_ops = other.m_ops;
+
+        other.m_invoker = nullptr;
+        other.m_ops = nullptr;
+    }
+
+    void Release()
+    {
+        if (m_ops != nullptr && m_ops->destroy != nullptr)
+        {
+            m_ops->destroy(m_storage);
+        }
+
+        m_invoker = nullptr;
+        m_ops = nullptr;
+    }
+
+    // Global, member and lambda targets are saved in front of the bind arguments.
+    template<std::size_t FuncArgsSize, typename TSavedArgsTuple, typename... TCtorArgs>
+    static InplaceDelegate MakeBound(TCtorArgs&&... ctorArgs)
+    {
+        constexpr std::size_t BindArgsSize = std::tuple_size_v<TSavedArgsTuple> - FuncArgsSize;
+        return Make<TSavedArgsTuple, Invokers::template Invoke<FuncArgsSize, BindArgsSize, TSavedArgsTuple, false>,
+                    Invokers::template Invoke<FuncArgsSize, BindArgsSize, TSavedArgsTuple, true>>(std::forward<TCtorArgs>(ctorArgs)...);
+    }
+
+    InvokeFunc m_invoker = nullptr;
+    const Ops* m_ops = nullptr;
+    alignas(Alignment) std::byte m_storage[Capacity];
+};
+
+// InplaceDelegate sized for the listed target types, see delegate_target_t.
+template<typename TSignature, typename... TTargets>
+using InplaceDelegateFor = InplaceDelegate<TSignature, inplace_delegate_capacity_v<TTargets...>, inplace_delegate_alignment_v<TTargets...>>;
+} // namespace sdaineka
\ No newline at end of file
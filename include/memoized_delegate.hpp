@@ -0,0 +1,329 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sdaineka
+{
+// Default key hasher of MemoizedDelegate: combines std::hash of every argument.
+struct MemoizedDelegateHash
+{
+    template<typename... T>
+    std::size_t operator()(const std::tuple<T...>& key) const
+    {
+        std::size_t seed = 0;
+        std::apply([&seed](const T&... args) { ((seed ^= std::hash<T>()(args) + 0x9e3779b9u + (seed << 6) + (seed >> 2)), ...); },
+                   key);
+        return seed;
+    }
+};
+
+struct MemoizedDelegateStats
+{
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t evictions;
+    std::size_t size;
+};
+
+template<typename, typename THash = MemoizedDelegateHash>
+class MemoizedDelegate;
+
+// Wraps a Delegate to a pure function and caches its results by argument values, so repeated calls with
+// the same arguments skip the target.
+//
+// Results live in a fixed array of `capacity` entries indexed by an open addressing hash table with
+// linear probing; once full, CLOCK picks the entry to replace: every hit marks its entry and the hand
+// skips marked entries once, clearing the mark, so a hot entry survives a full sweep. Keys are a tuple
+// of the decayed argument types hashed by THash, a callable taking that tuple.
+//
+// The default constructor mode is not thread safe. The sharded mode splits the capacity over shards
+// that are each guarded by a mutex and picked by the key hash; the target runs without holding a lock,
+// concurrent misses on the same key may call it more than once.
+template<typename TReturn, typename... TArgs, typename THash>
+class MemoizedDelegate<TReturn(TArgs...), THash>
+{
+    static_assert(!std::is_void_v<TReturn> && !std::is_reference_v<TReturn>, "MemoizedDelegate caches results by value");
+
+public:
+    using DelegateType = Delegate<TReturn(TArgs...)>;
+    using Key = std::tuple<std::decay_t<TArgs>...>;
+
+public:
+    // Single threaded cache of up to `capacity` results.
+    MemoizedDelegate(DelegateType target, std::size_t capacity, THash hash = THash())
+        : MemoizedDelegate(std::move(target), capacity, 1, false, std::move(hash))
+    {
+    }
+
+    // Thread safe cache of up to `capacity` results split over `shards` shards, rounded up to a power of two.
+    MemoizedDelegate(DelegateType target, std::size_t capacity, std::size_t shards, THash hash = THash())
+        : MemoizedDelegate(std::move(target), capacity, shards, true, std::move(hash))
+    {
+    }
+
+    MemoizedDelegate(const MemoizedDelegate&) = delete;
+    MemoizedDelegate& operator=(const MemoizedDelegate&) = delete;
+
+    TReturn operator()(TArgs... args)
+    {
+        Key key(args...);
+        const std::uint64_t hash = Mix(m_hash(key));
+        Shard& shard = GetShard(hash);
+
+        {
+            const std::unique_lock<std::mutex> lock = Lock(shard);
+            if (const std::uint32_t entry = shard.Find(key, hash); entry != kEmpty)
+            {
+                ++shard.hits;
+                shard.entries[entry].referenced = true;
+                return shard.entries[entry].item->second;
+            }
+            ++shard.misses;
+        }
+
+        TReturn result = m_target(std::forward<TArgs>(args)...);
+
+        const std::unique_lock<std::mutex> lock = Lock(shard);
+        shard.Insert(std::move(key), hash, result);
+        return result;
+    }
+
+    // Drops the cached results, e.g. after the data behind the target changed. Counters are kept.
+    void Clear()
+    {
+        for (std::size_t i = 0; i < m_shardCount; i++)
+        {
+            const std::unique_lock<std::mutex> lock = Lock(m_shards[i]);
+            m_shards[i].Clear();
+        }
+    }
+
+    MemoizedDelegateStats GetStats() const
+    {
+        MemoizedDelegateStats stats = {};
+        for (std::size_t i = 0; i < m_shardCount; i++)
+        {
+            const std::unique_lock<std::mutex> lock = Lock(m_shards[i]);
+            stats.hits += m_shards[i].hits;
+            stats.misses += m_shards[i].misses;
+            stats.evictions += m_shards[i].evictions;
+            stats.size += m_shards[i].size;
+        }
+
+        return stats;
+    }
+
+    std::size_t GetCapacity() const
+    {
+        return m_shards[0].entries.size() * m_shardCount;
+    }
+
+    const DelegateType& GetTarget() const
+    {
+        return m_target;
+    }
+
+private:
+    static constexpr std::uint32_t kEmpty = ~std::uint32_t(0);
+
+    struct Entry
+    {
+        std::optional<std::pair<Key, TReturn>> item;
+        std::uint64_t hash = 0;
+        bool referenced = false;
+    };
+
+    struct Slot
+    {
+        std::uint64_t hash = 0;
+        std::uint32_t entry = kEmpty;
+    };
+
+    struct Shard
+    {
+        // Slots are kept at most half full.
+        void Init(std::size_t capacity)
+        {
+            std::size_t slots = 2;
+            while (slots < capacity * 2)
+            {
+                slots *= 2;
+            }
+
+            entries.resize(capacity);
+            this->slots.resize(slots);
+            mask = slots - 1;
+        }
+
+        std::uint32_t Find(const Key& key, std::uint64_t hash) const
+        {
+            for (std::size_t i = hash & mask; slots[i].entry != kEmpty; i = (i + 1) & mask)
+            {
+                if (slots[i].hash == hash && entries[slots[i].entry].item->first == key)
+                {
+                    return slots[i].entry;
+                }
+            }
+
+            return kEmpty;
+        }
+
+        void Insert(Key&& key, std::uint64_t hash, const TReturn& value)
+        {
+            // Another thread may have stored the same key while the target ran.
+            if (Find(key, hash) != kEmpty)
+            {
+                return;
+            }
+
+            std::uint32_t entry;
+            if (size < entries.size())
+            {
+                entry = static_cast<std::uint32_t>(size++);
+            }
+            else
+            {
+                entry = Evict();
+                ++evictions;
+            }
+
+            entries[entry].item.emplace(std::move(key), value);
+            entries[entry].hash = hash;
+            entries[entry].referenced = false;
+
+            std::size_t i = hash & mask;
+            while (slots[i].entry != kEmpty)
+            {
+                i = (i + 1) & mask;
+            }
+            slots[i] = {hash, entry};
+        }
+
+        std::uint32_t Evict()
+        {
+            while (entries[hand].referenced)
+            {
+                entries[hand].referenced = false;
+                hand = hand + 1 < entries.size() ? hand + 1 : 0;
+            }
+
+            const auto victim = static_cast<std::uint32_t>(hand);
+            hand = hand + 1 < entries.size() ? hand + 1 : 0;
+
+            std::size_t i = entries[victim].hash & mask;
+            while (slots[i].entry != victim)
+            {
+                i = (i + 1) & mask;
+            }
+
+            // Backward shift deletion: later slots of the cluster move up unless that would put them
+            // before their home slot, which leaves no tombstones behind.
+            for (std::size_t j = (i + 1) & mask; slots[j].entry != kEmpty; j = (j + 1) & mask)
+            {
+                const std::size_t home = slots[j].hash & mask;
+                const bool between = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+                if (!between)
+                {
+                    slots[i] = slots[j];
+                    i = j;
+                }
+            }
+            slots[i] = Slot();
+
+            return victim;
+        }
+
+        void Clear()
+        {
+            for (std::size_t i = 0; i < size; i++)
+            {
+                entries[i].item.reset();
+                entries[i].referenced = false;
+            }
+            for (Slot& slot : slots)
+            {
+                slot = Slot();
+            }
+            size = 0;
+            hand = 0;
+        }
+
+        std::vector<Entry> entries;
+        std::vector<Slot> slots;
+        std::size_t mask = 0;
+        std::size_t size = 0;
+        std::size_t hand = 0;
+
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+
+        mutable std::mutex mutex;
+    };
+
+    MemoizedDelegate(DelegateType target, std::size_t capacity, std::size_t shards, bool threadSafe, THash hash)
+        : m_target(std::move(target))
+        , m_hash(std::move(hash))
+        , m_threadSafe(threadSafe)
+    {
+        assert(m_target && "the target of a MemoizedDelegate can not be empty");
+
+        m_shardCount = 1;
+        while (m_shardCount < shards)
+        {
+            m_shardCount *= 2;
+        }
+        while (m_shardBits < 64 && (std::uint64_t(1) << m_shardBits) < m_shardCount)
+        {
+            ++m_shardBits;
+        }
+
+        const std::size_t perShard = capacity > m_shardCount ? (capacity + m_shardCount - 1) / m_shardCount : 1;
+        m_shards = std::make_unique<Shard[]>(m_shardCount);
+        for (std::size_t i = 0; i < m_shardCount; i++)
+        {
+            m_shards[i].Init(perShard);
+        }
+    }
+
+    // Spreads weak hashes such as the identity std::hash of integers over all bits.
+    static std::uint64_t Mix(std::uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // The top bits pick the shard, the table index uses the low bits.
+    Shard& GetShard(std::uint64_t hash) const
+    {
+        return m_shards[m_shardBits > 0 ? hash >> (64 - m_shardBits) : 0];
+    }
+
+    std::unique_lock<std::mutex> Lock(Shard& shard) const
+    {
+        return m_threadSafe ? std::unique_lock<std::mutex>(shard.mutex) : std::unique_lock<std::mutex>();
+    }
+
+    DelegateType m_target;
+    THash m_hash;
+    bool m_threadSafe;
+    std::size_t m_shardCount = 1;
+    unsigned m_shardBits = 0;
+    std::unique_ptr<Shard[]> m_shards;
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -0,0 +1,178 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sdaineka
+{
+// Identifies a subscription of a MulticastDelegate. Handles of removed subscriptions are never reused.
+struct MulticastDelegateHandle
+{
+    std::uint32_t slot = ~0u;
+    std::uint32_t generation = 0;
+};
+
+template<typename>
+class MulticastDelegate;
+
+// Event with contiguous subscriber storage.
+//
+// Subscribers are kept as a dense array of Delegate, so the invokers and their inline payloads are packed
+// next to each other and Broadcast() is a linear scan. Subscribe and Unsubscribe are O(1): handles go
+// through a slot table and removal swaps the last subscriber into the freed position, so the broadcast
+// order is not preserved. Subscriptions must not be changed from within Broadcast().
+template<typename... TArgs>
+class MulticastDelegate<void(TArgs...)>
+{
+public:
+    using DelegateType = Delegate<void(TArgs...)>;
+    using Handle = MulticastDelegateHandle;
+
+public:
+    MulticastDelegate() = default;
+
+    MulticastDelegate(const MulticastDelegate&) = delete;
+    MulticastDelegate& operator=(const MulticastDelegate&) = delete;
+    MulticastDelegate(MulticastDelegate&&) noexcept = default;
+    MulticastDelegate& operator=(MulticastDelegate&&) noexcept = default;
+
+    Handle Subscribe(DelegateType delegate)
+    {
+        assert(!m_broadcasting && "subscriptions must not change during Broadcast");
+
+        std::uint32_t slot;
+        if (!m_freeSlots.empty())
+        {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<std::uint32_t>(m_slots.size());
+            m_slots.push_back({});
+        }
+
+        m_slots[slot].denseIndex = static_cast<std::uint32_t>(m_delegates.size());
+        m_delegates.push_back(std::move(delegate));
+        m_denseSlots.push_back(slot);
+
+        return {slot, m_slots[slot].generation};
+    }
+
+    // Returns false if the handle does not refer to a live subscription.
+    bool Unsubscribe(Handle handle)
+    {
+        assert(!m_broadcasting && "subscriptions must not change during Broadcast");
+
+        if (!IsSubscribed(handle))
+        {
+            return false;
+        }
+
+        Slot& slot = m_slots[handle.slot];
+        const std::uint32_t index = slot.denseIndex;
+        const std::uint32_t last = static_cast<std::uint32_t>(m_delegates.size() - 1);
+
+        if (index != last)
+        {
+            m_delegates[index] = std::move(m_delegates[last]);
+            m_denseSlots[index] = m_denseSlots[last];
+            m_slots[m_denseSlots[index]].denseIndex = index;
+        }
+
+        m_delegates.pop_back();
+        m_denseSlots.pop_back();
+
+        ++slot.generation;
+        m_freeSlots.push_back(handle.slot);
+
+        return true;
+    }
+
+    bool IsSubscribed(Handle handle) const
+    {
+        return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation;
+    }
+
+    // A subscriber that throws ends the broadcast, the exception reaches the caller.
+    void Broadcast(TArgs... args) const
+    {
+        struct BroadcastScope
+        {
+            ~BroadcastScope()
+            {
+                self->SetBroadcasting(false);
+            }
+
+            const MulticastDelegate* self;
+        };
+
+        SetBroadcasting(true);
+        const BroadcastScope scope{this};
+
+        for (const DelegateType& delegate : m_delegates)
+        {
+            delegate(args...);
+        }
+    }
+
+    void Clear()
+    {
+        assert(!m_broadcasting && "subscriptions must not change during Broadcast");
+
+        for (const std::uint32_t slot : m_denseSlots)
+        {
+            ++m_slots[slot].generation;
+            m_freeSlots.push_back(slot);
+        }
+
+        m_delegates.clear();
+        m_denseSlots.clear();
+    }
+
+    void Reserve(std::size_t count)
+    {
+        m_delegates.reserve(count);
+        m_denseSlots.reserve(count);
+        m_slots.reserve(count);
+    }
+
+    std::size_t Size() const
+    {
+        return m_delegates.size();
+    }
+
+    bool Empty() const
+    {
+        return m_delegates.empty();
+    }
+
+private:
+    // A slot's generation is bumped whenever its subscription is removed, which invalidates old handles.
+    struct Slot
+    {
+        std::uint32_t denseIndex = 0;
+        std::uint32_t generation = 0;
+    };
+
+    void SetBroadcasting([[maybe_unused]] bool broadcasting) const
+    {
+#ifndef NDEBUG
+        m_broadcasting = broadcasting;
+#endif
+    }
+
+    std::vector<DelegateType> m_delegates;
+    std::vector<std::uint32_t> m_denseSlots;
+    std::vector<Slot> m_slots;
+    std::vector<std::uint32_t> m_freeSlots;
+
+#ifndef NDEBUG
+    mutable bool m_broadcasting = false;
+#endif
+};
+} // namespace sdaineka
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
+#include "delegate_allocator.hpp"
 #include "delegate_common.hpp"
 
+#include <cstddef>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 
@@ -21,122 +28,77 @@ public:
     template<typename TClass, typename... TBindArgs>
     using MemberFuncPtrConst = TReturn (TClass::*)(TArgs..., delegate_bind_arg_t<TBindArgs>...) const;
 
+    // Targets taking bound arguments over, see delegate_bind_once_arg_t.
+    template<typename... TBindArgs>
+    using OnceGlobalFuncPtr = TReturn (*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using OnceMemberFuncPtr = TReturn (TClass::*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...);
+    template<typename TClass, typename... TBindArgs>
+    using OnceMemberFuncPtrConst = TReturn (TClass::*)(TArgs..., delegate_bind_once_arg_t<TBindArgs>...) const;
+
 private:
-    class StorageBase
-    {
-    public:
-        virtual ~StorageBase()
-        {
-        }
-        virtual TReturn operator()(TArgs... args) const = 0;
-    };
+    using BatchResultPtr = detail::delegate_batch_result_t<TReturn>;
 
     template<typename... TBindArgs>
-    class GlobalFuncStorage : public StorageBase
+    static constexpr bool HasOnceTarget()
     {
-    public:
-        GlobalFuncStorage(const GlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
-            : m_func(func)
-            , m_bindArgs(std::move(bindArgs)...)
-        {
-        }
-
-        TReturn operator()(TArgs... args) const override
-        {
-            return Invoke(std::forward<TArgs>(args)..., std::make_index_sequence<sizeof...(TBindArgs)>{});
-        }
-
-    private:
-        template<std::size_t... I>
-        TReturn Invoke(TArgs... args, std::index_sequence<I...>) const
-        {
-            return std::invoke(m_func, std::forward<TArgs>(args)..., std::get<I>(m_bindArgs)...);
-        }
-
-        GlobalFuncPtr<TBindArgs...> m_func;
-        std::tuple<TBindArgs...> m_bindArgs;
-    };
+        return !std::is_same_v<GlobalFuncPtr<TBindArgs...>, OnceGlobalFuncPtr<TBindArgs...>>;
+    }
 
-    template<typename TClass, typename... TBindArgs>
-    class MemberDelegateStorage : public StorageBase
+    class StorageBase
     {
     public:
-        MemberDelegateStorage(TClass* cls, const MemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
-            : m_cls(cls)
-            , m_func(func)
-            , m_bindArgs(std::move(bindArgs)...)
-        {
-        }
-
-        TReturn operator()(TArgs... args) const override
-        {
-            return Invoke(std::forward<TArgs>(args)..., std::make_index_sequence<sizeof...(TBindArgs)>{});
-        }
-
-    private:
-        template<std::size_t... I>
-        TReturn Invoke(TArgs... args, std::index_sequence<I...>) const
+        virtual ~StorageBase()
         {
-            return std::invoke(m_func, m_cls, std::forward<TArgs>(args)..., std::get<I>(m_bindArgs)...);
         }
-
-        TClass* m_cls;
-        MemberFuncPtr<TClass, TBindArgs...> m_func;
-        std::tuple<TBindArgs...> m_bindArgs;
+        virtual TReturn operator()(TArgs... args) const = 0;
+        // Moves the target and the bound arguments into the call, the storage must be destroyed afterwards.
+        virtual TReturn InvokeOnce(TArgs... args) = 0;
+        virtual void InvokeBatch(BatchResultPtr results, std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const = 0;
     };
 
-    template<typename TClass, typename... TBindArgs>
-    class MemberDelegateStorageConst : public StorageBase
+    // Storage of every binding: the first FuncArgsSize elements of TSavedArgsTuple are the target, a function
+    // pointer or lambda, or a member function pointer followed by the object pointer, the rest are the bound
+    // arguments. They are mutable like the payload of a Delegate, so that mutable lambdas can be bound.
+    template<std::size_t FuncArgsSize, typename TSavedArgsTuple>
+    class BoundStorage final : public StorageBase
     {
     public:
-        MemberDelegateStorageConst(const TClass* cls, const MemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
-            : m_cls(cls)
-            , m_func(func)
-            , m_bindArgs(std::move(bindArgs)...)
+        template<typename... TCtorArgs>
+        explicit BoundStorage(TCtorArgs&&... ctorArgs)
+            : m_savedArgsTuple(std::forward<TCtorArgs>(ctorArgs)...)
         {
         }
 
         TReturn operator()(TArgs... args) const override
         {
-            return Invoke(std::forward<TArgs>(args)..., std::make_index_sequence<sizeof...(TBindArgs)>{});
+            return Invoke<false>(std::forward<TArgs>(args)...);
         }
 
-    private:
-        template<std::size_t... I>
-        TReturn Invoke(TArgs... args, std::index_sequence<I...>) const
+        TReturn InvokeOnce(TArgs... args) override
         {
-            return std::invoke(m_func, m_cls, std::forward<TArgs>(args)..., std::get<I>(m_bindArgs)...);
+            return Invoke<true>(std::forward<TArgs>(args)...);
         }
 
-        const TClass* m_cls;
-        MemberFuncPtrConst<TClass, TBindArgs...> m_func;
-        std::tuple<TBindArgs...> m_bindArgs;
-    };
-
-    template<typename TFunc, typename... TBindArgs>
-    class LambdaDelegateStorage : public StorageBase
-    {
-    public:
-        LambdaDelegateStorage(TFunc&& func, TBindArgs... bindArgs)
-            : m_func(std::forward<TFunc>(func))
-            , m_bindArgs(std::move(bindArgs)...)
+        // The loop calls the target directly, so it is inlined into it instead of making a virtual call per element.
+        void InvokeBatch(BatchResultPtr results, std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const override
         {
-        }
-
-        TReturn operator()(TArgs... args) const override
-        {
-            return Invoke(std::forward<TArgs>(args)..., std::make_index_sequence<sizeof...(TBindArgs)>{});
+            const auto call = [this](TArgs... callArgs) { return Invoke<false>(std::forward<TArgs>(callArgs)...); };
+            detail::DelegateBatch<TReturn, TArgs...>::Run(call, results, count, args...);
         }
 
     private:
-        template<std::size_t... I>
-        TReturn Invoke(TArgs... args, std::index_sequence<I...>) const
+        template<bool Once>
+        TReturn Invoke(TArgs... args) const
         {
-            return std::invoke(m_func, std::forward<TArgs>(args)..., std::get<I>(m_bindArgs)...);
+            SDAINEKA_DELEGATE_TIME_TARGET_CALL(BoundStorage, std::get<0>(m_savedArgsTuple));
+            constexpr std::size_t BindArgsSize = std::tuple_size_v<TSavedArgsTuple> - FuncArgsSize;
+            return detail::DelegateBoundCall<TReturn, TArgs...>::template Invoke<Once>(
+                m_savedArgsTuple, std::make_index_sequence<FuncArgsSize>(), detail::make_index_sequence<FuncArgsSize, BindArgsSize>(),
+                std::forward<TArgs>(args)...);
         }
 
-        TFunc m_func;
-        std::tuple<TBindArgs...> m_bindArgs;
+        mutable TSavedArgsTuple m_savedArgsTuple;
     };
 
 public:
@@ -147,57 +109,188 @@ public:
     SimpleHeapDelegate(SimpleHeapDelegate&&) noexcept = default;
     SimpleHeapDelegate& operator=(SimpleHeapDelegate&&) noexcept = default;
 
+    // Storage comes from the DelegateSlabResource unless a memory resource is given.
     template<typename... TBindArgs>
     static SimpleHeapDelegate CreateGlobal(GlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
     {
-        using StorageType = GlobalFuncStorage<TBindArgs...>;
-        return SimpleHeapDelegate(new StorageType(func, std::move(bindArgs)...), sizeof(StorageType));
+        return CreateGlobal(std::allocator_arg, DelegateSlabResource::Get(), func, std::move(bindArgs)...);
     }
 
     template<typename TClass, typename... TBindArgs>
     static SimpleHeapDelegate CreateMember(TClass* cls, MemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
     {
-        using StorageType = MemberDelegateStorage<TClass, TBindArgs...>;
-        return SimpleHeapDelegate(new StorageType(cls, func, std::move(bindArgs)...), sizeof(StorageType));
+        return CreateMember(std::allocator_arg, DelegateSlabResource::Get(), cls, func, std::move(bindArgs)...);
     }
 
     template<typename TClass, typename... TBindArgs>
     static SimpleHeapDelegate CreateMember(const TClass* cls, MemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
     {
-        using StorageType = MemberDelegateStorageConst<TClass, TBindArgs...>;
-        return SimpleHeapDelegate(new StorageType(cls, func, std::move(bindArgs)...), sizeof(StorageType));
+        return CreateMember(std::allocator_arg, DelegateSlabResource::Get(), cls, func, std::move(bindArgs)...);
     }
 
-    template<typename TFunc, typename... TBindArgs>
+    template<typename TFunc, typename... TBindArgs, std::enable_if_t<!detail::is_allocator_arg_v<TFunc>, int> = 0>
     static SimpleHeapDelegate CreateLambda(TFunc&& func, TBindArgs... bindArgs)
     {
-        using StorageType = LambdaDelegateStorage<TFunc, TBindArgs...>;
-        return SimpleHeapDelegate(new StorageType(std::forward<TFunc>(func), std::move(bindArgs)...), sizeof(StorageType));
+        return CreateLambda(std::allocator_arg, DelegateSlabResource::Get(), std::forward<TFunc>(func), std::move(bindArgs)...);
+    }
+
+    // Targets that take bound arguments over, only callable with InvokeOnce().
+    template<typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static SimpleHeapDelegate CreateGlobal(OnceGlobalFuncPtr<TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return CreateGlobal(std::allocator_arg, DelegateSlabResource::Get(), func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static SimpleHeapDelegate CreateMember(TClass* cls, OnceMemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return CreateMember(std::allocator_arg, DelegateSlabResource::Get(), cls, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static SimpleHeapDelegate CreateMember(const TClass* cls, OnceMemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return CreateMember(std::allocator_arg, DelegateSlabResource::Get(), cls, func, std::move(bindArgs)...);
+    }
+
+    // Overloads allocating the storage from a memory resource, which must outlive the delegate.
+    // A null resource selects the global operator new.
+    template<typename... TBindArgs>
+    static SimpleHeapDelegate CreateGlobal(std::allocator_arg_t, std::pmr::memory_resource* resource, GlobalFuncPtr<TBindArgs...> func,
+                                           TBindArgs... bindArgs)
+    {
+        return Create<1, std::tuple<GlobalFuncPtr<TBindArgs...>, TBindArgs...>>(resource, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs>
+    static SimpleHeapDelegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, TClass* cls,
+                                           MemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Create<2, std::tuple<MemberFuncPtr<TClass, TBindArgs...>, TClass*, TBindArgs...>>(resource, func, cls,
+                                                                                                 std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs>
+    static SimpleHeapDelegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, const TClass* cls,
+                                           MemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Create<2, std::tuple<MemberFuncPtrConst<TClass, TBindArgs...>, const TClass*, TBindArgs...>>(resource, func, cls,
+                                                                                                           std::move(bindArgs)...);
+    }
+
+    template<typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static SimpleHeapDelegate CreateGlobal(std::allocator_arg_t, std::pmr::memory_resource* resource, OnceGlobalFuncPtr<TBindArgs...> func,
+                                           TBindArgs... bindArgs)
+    {
+        return Create<1, std::tuple<OnceGlobalFuncPtr<TBindArgs...>, TBindArgs...>>(resource, func, std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static SimpleHeapDelegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, TClass* cls,
+                                           OnceMemberFuncPtr<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Create<2, std::tuple<OnceMemberFuncPtr<TClass, TBindArgs...>, TClass*, TBindArgs...>>(resource, func, cls,
+                                                                                                     std::move(bindArgs)...);
+    }
+
+    template<typename TClass, typename... TBindArgs, std::enable_if_t<HasOnceTarget<TBindArgs...>(), int> = 0>
+    static SimpleHeapDelegate CreateMember(std::allocator_arg_t, std::pmr::memory_resource* resource, const TClass* cls,
+                                           OnceMemberFuncPtrConst<TClass, TBindArgs...> func, TBindArgs... bindArgs)
+    {
+        return Create<2, std::tuple<OnceMemberFuncPtrConst<TClass, TBindArgs...>, const TClass*, TBindArgs...>>(resource, func, cls,
+                                                                                                               std::move(bindArgs)...);
+    }
+
+    template<typename TFunc, typename... TBindArgs>
+    static SimpleHeapDelegate CreateLambda(std::allocator_arg_t, std::pmr::memory_resource* resource, TFunc&& func, TBindArgs... bindArgs)
+    {
+        return Create<1, std::tuple<std::decay_t<TFunc>, TBindArgs...>>(resource, std::forward<TFunc>(func), std::move(bindArgs)...);
     }
 
     operator bool() const
     {
-        return m_storage;
+        return static_cast<bool>(m_storage);
     }
 
-    TReturn operator()(TArgs... args) const
+    TReturn operator()(TArgs... args) const&
     {
         return m_storage->operator()(std::forward<TArgs>(args)...);
     }
 
+    // Calling an rvalue delegate is a one-shot call, see InvokeOnce().
+    TReturn operator()(TArgs... args) &&
+    {
+        return InvokeOnce(std::forward<TArgs>(args)...);
+    }
+
+    // Calls the target with the target object and the bound arguments moved out of the delegate, which is
+    // empty afterwards, see Delegate::InvokeOnce().
+    TReturn InvokeOnce(TArgs... args)
+    {
+        const std::unique_ptr<StorageBase, StorageDeleter> storage = std::move(m_storage);
+        return storage->InvokeOnce(std::forward<TArgs>(args)...);
+    }
+
+    // Calls the delegate count times with the i-th element of every argument array, making one virtual
+    // call per batch instead of one per element.
+    void InvokeBatch(std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const
+    {
+        m_storage->InvokeBatch(nullptr, count, args...);
+    }
+
+    // As above, storing the result of the i-th call to results[i].
+    template<typename TResult = TReturn, std::enable_if_t<std::is_object_v<TResult>, int> = 0>
+    void InvokeBatch(TResult* results, std::size_t count, detail::delegate_batch_arg_t<TArgs>... args) const
+    {
+        m_storage->InvokeBatch(results, count, args...);
+    }
+
+    // Calls the delegate for every element of a contiguous range.
+    template<typename TRange>
+    void ForEach(TRange&& range) const
+    {
+        static_assert(sizeof...(TArgs) == 1, "ForEach requires a delegate taking a single argument");
+        InvokeBatch(std::size(range), std::data(range));
+    }
+
     std::size_t GetHeapSize() const
     {
-        return m_storageSize;
+        return m_storage ? m_storage.get_deleter().size : 0;
     }
 
 private:
-    SimpleHeapDelegate(StorageBase* storage, std::size_t storageSize)
-        : m_storage(storage)
-        , m_storageSize(storageSize)
+    // Destroys the storage and returns its block to the resource it was allocated from.
+    struct StorageDeleter
+    {
+        void operator()(StorageBase* storage) const
+        {
+            auto* data = static_cast<std::byte*>(dynamic_cast<void*>(storage));
+            storage->~StorageBase();
+            detail::DelegateDeallocate(resource, data, size, alignment);
+        }
+
+        std::pmr::memory_resource* resource = nullptr;
+        std::size_t size = 0;
+        std::size_t alignment = 0;
+    };
+
+    template<std::size_t FuncArgsSize, typename TSavedArgsTuple, typename... TCtorArgs>
+    static SimpleHeapDelegate Create(std::pmr::memory_resource* resource, TCtorArgs&&... ctorArgs)
+    {
+        using TStorage = BoundStorage<FuncArgsSize, TSavedArgsTuple>;
+        detail::DelegateAllocation allocation(resource, sizeof(TStorage), alignof(TStorage));
+        StorageBase* storage = new (allocation.Get()) TStorage(std::forward<TCtorArgs>(ctorArgs)...);
+        allocation.Release();
+        SDAINEKA_DELEGATE_RECORD_STORAGE(SimpleHeapDelegate, 0, sizeof(TStorage) - sizeof(StorageBase), true, sizeof(TStorage));
+
+        return SimpleHeapDelegate(storage, StorageDeleter{resource, sizeof(TStorage), alignof(TStorage)});
+    }
+
+    SimpleHeapDelegate(StorageBase* storage, StorageDeleter deleter)
+        : m_storage(storage, deleter)
     {
     }
 
-    std::unique_ptr<StorageBase> m_storage;
-    std::size_t m_storageSize;
+    std::unique_ptr<StorageBase, StorageDeleter> m_storage;
 };
 } // namespace sdaineka
\ No newline at end of file
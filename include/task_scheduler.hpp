@@ -0,0 +1,452 @@
+#pragma once
+#include "delegate.hpp"
+#include "delegate_allocator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sdaineka
+{
+namespace detail
+{
+// Chase-Lev deque of pointers (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+// The owner pushes and takes at the bottom, any thread steals from the top. Replaced buffers are kept
+// until the deque is destroyed because a thief may still be reading from them.
+template<typename T>
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(std::size_t capacity = 256)
+    {
+        m_buffers.push_back(std::make_unique<Buffer>(capacity));
+        m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only.
+    void Push(T* item)
+    {
+        const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t top = m_top.load(std::memory_order_acquire);
+        Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+        if (bottom - top > static_cast<std::int64_t>(buffer->mask))
+        {
+            buffer = Grow(buffer, top, bottom);
+        }
+
+        buffer->Put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only. Returns the most recently pushed item, or null.
+    T* Take()
+    {
+        const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = buffer->Get(bottom);
+        if (top == bottom)
+        {
+            // Last item, race the thieves for it.
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return item;
+    }
+
+    // Any thread. Returns the oldest item, or null if the deque is empty or the steal lost a race.
+    T* Steal()
+    {
+        std::int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        T* item = m_buffer.load(std::memory_order_acquire)->Get(top);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+
+        return item;
+    }
+
+    bool Empty() const
+    {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Buffer
+    {
+        explicit Buffer(std::size_t capacity)
+            : mask(capacity - 1)
+            , items(std::make_unique<std::atomic<T*>[]>(capacity))
+        {
+        }
+
+        // Release/acquire on the slot also publishes the pointee to thieves, in addition to the fences.
+        T* Get(std::int64_t index) const
+        {
+            return items[static_cast<std::size_t>(index) & mask].load(std::memory_order_acquire);
+        }
+
+        void Put(std::int64_t index, T* item)
+        {
+            items[static_cast<std::size_t>(index) & mask].store(item, std::memory_order_release);
+        }
+
+        std::size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> items;
+    };
+
+    Buffer* Grow(Buffer* buffer, std::int64_t top, std::int64_t bottom)
+    {
+        m_buffers.push_back(std::make_unique<Buffer>((buffer->mask + 1) * 2));
+        Buffer* grown = m_buffers.back().get();
+
+        for (std::int64_t i = top; i < bottom; i++)
+        {
+            grown->Put(i, buffer->Get(i));
+        }
+
+        m_buffer.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    alignas(64) std::atomic<std::int64_t> m_top{0};
+    alignas(64) std::atomic<std::int64_t> m_bottom{0};
+    std::atomic<Buffer*> m_buffer{nullptr};
+    std::vector<std::unique_ptr<Buffer>> m_buffers;
+};
+} // namespace detail
+
+// Counts the unfinished tasks submitted with it, see TaskScheduler::Wait().
+class TaskGroup
+{
+public:
+    TaskGroup() = default;
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    bool IsDone() const
+    {
+        return m_pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class TaskScheduler;
+
+    std::atomic<std::size_t> m_pending{0};
+};
+
+// Work-stealing thread pool whose task type is Delegate<void()>.
+//
+// Each worker owns a Chase-Lev deque: tasks submitted from a worker are pushed to its own deque and run
+// newest first, idle workers steal the oldest tasks of the others. Tasks submitted from other threads go
+// through a shared queue. A task is a Delegate<void()> moved into a node from the DelegatePoolResource, so
+// a task whose capture fits into DelegateStorageStackSize<void()> (24 bytes unless specialized, e.g. a
+// pointer and a range) is submitted without touching the global heap. Tasks must not throw.
+class TaskScheduler
+{
+public:
+    using Task = Delegate<void()>;
+
+public:
+    // A worker count of zero uses one worker per hardware thread.
+    explicit TaskScheduler(std::size_t workerCount = 0)
+    {
+        if (workerCount == 0)
+        {
+            workerCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        m_workers.reserve(workerCount);
+        for (std::size_t i = 0; i < workerCount; i++)
+        {
+            m_workers.push_back(std::make_unique<Worker>());
+        }
+
+        for (std::size_t i = 0; i < workerCount; i++)
+        {
+            m_workers[i]->thread = std::thread([this, i] { WorkerMain(i); });
+        }
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Runs the submitted tasks to completion, then joins the workers.
+    ~TaskScheduler()
+    {
+        {
+            const std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (const std::unique_ptr<Worker>& worker : m_workers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    void Submit(Task task)
+    {
+        Push(CreateNode(std::move(task), nullptr));
+    }
+
+    void Submit(TaskGroup& group, Task task)
+    {
+        group.m_pending.fetch_add(1, std::memory_order_relaxed);
+        Push(CreateNode(std::move(task), &group));
+    }
+
+    // Runs pending tasks on the calling thread until every task of the group has finished.
+    void Wait(TaskGroup& group)
+    {
+        while (!group.IsDone())
+        {
+            if (!RunOne())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Calls func(i) for every i in [begin, end). The range is split in halves down to grain sized chunks,
+    // and halves are submitted as tasks that other workers can steal. Returns when all calls finished.
+    template<typename TFunc>
+    void ParallelFor(std::size_t begin, std::size_t end, std::size_t grain, const TFunc& func)
+    {
+        TaskGroup group;
+        const ParallelForContext<TFunc> context{this, &func, &group, std::max<std::size_t>(grain, 1)};
+
+        context.Run(begin, end);
+        Wait(group);
+    }
+
+    std::size_t GetWorkerCount() const
+    {
+        return m_workers.size();
+    }
+
+private:
+    struct TaskNode
+    {
+        Task task;
+        TaskGroup* group;
+    };
+
+    struct Worker
+    {
+        detail::WorkStealingDeque<TaskNode> deque;
+        std::thread thread;
+    };
+
+    struct WorkerContext
+    {
+        TaskScheduler* scheduler = nullptr;
+        std::size_t index = 0;
+    };
+
+    template<typename TFunc>
+    struct ParallelForContext
+    {
+        // Keeps splitting off the upper half, so the oldest and largest ranges are the ones stolen.
+        void Run(std::size_t begin, std::size_t end) const
+        {
+            while (end - begin > grain)
+            {
+                const std::size_t middle = begin + (end - begin) / 2;
+                scheduler->Submit(*group, Task::CreateLambda([this, middle, end] { Run(middle, end); }));
+                end = middle;
+            }
+
+            for (std::size_t i = begin; i < end; i++)
+            {
+                (*func)(i);
+            }
+        }
+
+        TaskScheduler* scheduler;
+        const TFunc* func;
+        TaskGroup* group;
+        std::size_t grain;
+    };
+
+    static WorkerContext& GetWorkerContext()
+    {
+        thread_local WorkerContext context;
+        return context;
+    }
+
+    static TaskNode* CreateNode(Task&& task, TaskGroup* group)
+    {
+        std::byte* data = detail::DelegateAllocate(DelegatePoolResource::Get(), sizeof(TaskNode), alignof(TaskNode));
+        return new (data) TaskNode{std::move(task), group};
+    }
+
+    static void DestroyNode(TaskNode* node)
+    {
+        node->~TaskNode();
+        detail::DelegateDeallocate(DelegatePoolResource::Get(), reinterpret_cast<std::byte*>(node), sizeof(TaskNode), alignof(TaskNode));
+    }
+
+    void Push(TaskNode* node)
+    {
+        const WorkerContext& context = GetWorkerContext();
+        if (context.scheduler == this)
+        {
+            m_workers[context.index]->deque.Push(node);
+        }
+        else
+        {
+            const std::lock_guard<std::mutex> lock(m_injectMutex);
+            m_injected.push_back(node);
+        }
+
+        // Pairs with the sleeper re-checking m_workEpoch, see WorkerMain().
+        m_workEpoch.fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_seq_cst) > 0)
+        {
+            const std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_wake.notify_one();
+        }
+    }
+
+    TaskNode* FindTask()
+    {
+        const WorkerContext& context = GetWorkerContext();
+        const bool isWorker = context.scheduler == this;
+
+        if (isWorker)
+        {
+            if (TaskNode* node = m_workers[context.index]->deque.Take())
+            {
+                return node;
+            }
+        }
+
+        {
+            const std::lock_guard<std::mutex> lock(m_injectMutex);
+            if (!m_injected.empty())
+            {
+                TaskNode* node = m_injected.front();
+                m_injected.pop_front();
+                return node;
+            }
+        }
+
+        // Victims are visited round robin, starting next to the calling worker.
+        const std::size_t count = m_workers.size();
+        const std::size_t start = isWorker ? context.index + 1 : 0;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            const std::size_t victim = (start + i) % count;
+            if (isWorker && victim == context.index)
+            {
+                continue;
+            }
+
+            if (TaskNode* node = m_workers[victim]->deque.Steal())
+            {
+                return node;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool RunOne()
+    {
+        TaskNode* node = FindTask();
+        if (node == nullptr)
+        {
+            return false;
+        }
+
+        node->task.InvokeOnce();
+
+        TaskGroup* group = node->group;
+        DestroyNode(node);
+
+        if (group != nullptr)
+        {
+            group->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        return true;
+    }
+
+    void WorkerMain(std::size_t index)
+    {
+        GetWorkerContext() = {this, index};
+
+        while (true)
+        {
+            const std::uint64_t epoch = m_workEpoch.load(std::memory_order_seq_cst);
+            if (RunOne())
+            {
+                continue;
+            }
+
+            // A submission that the search above missed has bumped the epoch, so the wait returns at once.
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            if (m_stop)
+            {
+                break;
+            }
+
+            m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+            m_wake.wait(lock, [this, epoch] { return m_stop || m_workEpoch.load(std::memory_order_seq_cst) != epoch; });
+            m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        GetWorkerContext() = {};
+    }
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_injectMutex;
+    std::deque<TaskNode*> m_injected;
+
+    std::atomic<std::uint64_t> m_workEpoch{0};
+    std::atomic<std::size_t> m_sleepers{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
+} // namespace sdaineka
\ No newline at end of file
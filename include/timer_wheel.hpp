@@ -0,0 +1,431 @@
+#pragma once
+#include "delegate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace sdaineka
+{
+namespace detail
+{
+// Index of the lowest set bit, bits must not be zero.
+inline unsigned timer_lowest_bit(std::uint64_t bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+// Index of the highest set bit, bits must not be zero.
+inline unsigned timer_highest_bit(std::uint64_t bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return 63 - static_cast<unsigned>(__builtin_clzll(bits));
+#endif
+}
+} // namespace detail
+
+// Identifies a timer of a TimerWheel. Handles of fired or cancelled timers are never reused.
+struct TimerHandle
+{
+    std::uint32_t index = ~0u;
+    std::uint32_t generation = 0;
+};
+
+// Hierarchical timing wheel of Delegate<void()> callbacks, driven by the caller in ticks of its choosing,
+// e.g. milliseconds of a server's event loop.
+//
+// Timers live in chunked node arrays with the callback stored inline, so scheduling a callback that fits
+// into the delegate's stack storage does not allocate once the arrays have grown. The wheel has kLevels
+// levels of kSlots slots; a timer is linked into the slot of the level whose span covers its expiry, or
+// into an overflow list past 2^32 ticks, and cascades to finer levels as time approaches it. Schedule()
+// and Cancel() are O(1). Advancing processes whole slots at once and skips idle spans through per level
+// occupancy bitmaps, so its cost depends on the number of timers and cascades, not on the ticks passed.
+// Reschedule() postpones a timer in place, which keeps resetting idle timeouts cheap.
+// Timers due in the same tick fire in no particular order.
+//
+// Not thread safe. Callbacks may schedule and cancel timers, including themselves; they run one-shot, so
+// bound arguments that can only be moved are supported.
+class TimerWheel
+{
+public:
+    using Callback = Delegate<void()>;
+    using Handle = TimerHandle;
+
+    static constexpr unsigned kSlotBits = 8;
+    static constexpr std::size_t kSlots = std::size_t(1) << kSlotBits;
+    static constexpr unsigned kLevels = 4;
+    static constexpr std::uint64_t kNever = std::numeric_limits<std::uint64_t>::max();
+
+public:
+    explicit TimerWheel(std::uint64_t now = 0)
+        : m_now(now)
+    {
+        m_heads.fill(kNil);
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Pending callbacks are destroyed without being called.
+    ~TimerWheel() = default;
+
+    Handle Schedule(std::uint64_t delay, Callback callback)
+    {
+        return ScheduleAt(delay < kNever - m_now ? m_now + delay : kNever - 1, std::move(callback));
+    }
+
+    // A timer due at or before Now() fires on the next tick.
+    Handle ScheduleAt(std::uint64_t expiry, Callback callback)
+    {
+        assert(callback && "empty callbacks can not be scheduled");
+
+        const std::uint32_t index = AllocateNode();
+        Node& node = GetNode(index);
+        node.callback = std::move(callback);
+        node.expiry = std::max(expiry, m_now + 1);
+        Link(index, GetList(node.expiry));
+        ++m_size;
+
+        return {index, node.generation};
+    }
+
+    // Returns false if the timer already fired or was cancelled.
+    bool Cancel(Handle handle)
+    {
+        if (!IsPending(handle))
+        {
+            return false;
+        }
+
+        // The callback is destroyed after the node is released, its destructor may use the wheel.
+        const Callback callback = Release(handle.index);
+        return true;
+    }
+
+    bool Reschedule(Handle handle, std::uint64_t delay)
+    {
+        return RescheduleAt(handle, delay < kNever - m_now ? m_now + delay : kNever - 1);
+    }
+
+    // Moves a pending timer to a new expiry and keeps its callback and handle. Returns false if the timer
+    // already fired or was cancelled. Postponing, the common case of idle timeouts, only stores the new
+    // expiry: the timer stays in its earlier slot and is relinked when that slot is processed.
+    bool RescheduleAt(Handle handle, std::uint64_t expiry)
+    {
+        if (!IsPending(handle))
+        {
+            return false;
+        }
+
+        Node& node = GetNode(handle.index);
+        expiry = std::max(expiry, m_now + 1);
+        if (expiry < node.expiry)
+        {
+            Unlink(handle.index);
+            Link(handle.index, GetList(expiry));
+        }
+
+        node.expiry = expiry;
+        return true;
+    }
+
+    bool IsPending(Handle handle) const
+    {
+        return handle.index < m_nodeCount && GetNode(handle.index).generation == handle.generation
+            && GetNode(handle.index).list != kNil;
+    }
+
+    // Moves time forward and runs the timers that expire on the way, in expiry order. Returns how many ran.
+    std::size_t Advance(std::uint64_t ticks)
+    {
+        return AdvanceTo(ticks < kNever - m_now ? m_now + ticks : kNever - 1);
+    }
+
+    std::size_t AdvanceTo(std::uint64_t now)
+    {
+        // Leftovers of a callback that threw run first.
+        std::size_t fired = RunExpired();
+
+        while (m_now < now)
+        {
+            m_now = std::min(GetNextEventTime(), now);
+            Cascade();
+            fired += RunExpired();
+        }
+
+        return fired;
+    }
+
+    std::uint64_t Now() const
+    {
+        return m_now;
+    }
+
+    // Earliest tick after Now() at which Advance() has work to do, kNever when no timer is pending. No timer
+    // expires before it, which makes it a suitable poll timeout; it may be a cascade that fires nothing.
+    std::uint64_t GetNextEventTime() const
+    {
+        for (unsigned level = 0; level < kLevels; level++)
+        {
+            const unsigned shift = level * kSlotBits;
+            const std::size_t slot = FindOccupied(level, static_cast<std::size_t>((m_now >> shift) & kMask) + 1);
+            if (slot < kSlots)
+            {
+                // Every slot of a level lies past the current slot of the level below it.
+                const std::uint64_t rotation = m_now >> (shift + kSlotBits) << (shift + kSlotBits);
+                return rotation | (static_cast<std::uint64_t>(slot) << shift);
+            }
+        }
+
+        if (m_heads[kOverflowList] != kNil)
+        {
+            constexpr unsigned kSpanBits = kLevels * kSlotBits;
+            return ((m_now >> kSpanBits) + 1) << kSpanBits;
+        }
+
+        return kNever;
+    }
+
+    std::size_t Size() const
+    {
+        return m_size;
+    }
+
+    bool Empty() const
+    {
+        return m_size == 0;
+    }
+
+    // Grows the node arrays so that count timers can be pending without allocating.
+    void Reserve(std::size_t count)
+    {
+        while (m_chunks.size() * kChunkSize < count)
+        {
+            m_chunks.push_back(std::make_unique<Node[]>(kChunkSize));
+        }
+    }
+
+private:
+    static constexpr std::uint32_t kNil = ~0u;
+    static constexpr std::uint64_t kMask = kSlots - 1;
+    static constexpr std::size_t kWords = kSlots / 64;
+    static constexpr std::uint32_t kOverflowList = kLevels * kSlots;
+    static constexpr std::size_t kChunkBits = 12;
+    static constexpr std::size_t kChunkSize = std::size_t(1) << kChunkBits;
+
+    // Linked into a slot list while pending, into the free list otherwise.
+    struct Node
+    {
+        Callback callback;
+        std::uint64_t expiry = 0;
+        std::uint32_t prev = kNil;
+        std::uint32_t next = kNil;
+        // Slot list index, kNil while free.
+        std::uint32_t list = kNil;
+        std::uint32_t generation = 0;
+    };
+
+    // Nodes never move, chunks are only added.
+    Node& GetNode(std::uint32_t index) const
+    {
+        return m_chunks[index >> kChunkBits][index & (kChunkSize - 1)];
+    }
+
+    std::uint32_t AllocateNode()
+    {
+        if (m_freeHead != kNil)
+        {
+            const std::uint32_t index = m_freeHead;
+            m_freeHead = GetNode(index).next;
+            return index;
+        }
+
+        assert(m_nodeCount < kNil && "too many timers");
+        Reserve(static_cast<std::size_t>(m_nodeCount) + 1);
+        return m_nodeCount++;
+    }
+
+    // Unlinks a pending timer, frees its node and hands out its callback.
+    Callback Release(std::uint32_t index)
+    {
+        Unlink(index);
+
+        Node& node = GetNode(index);
+        Callback callback = std::move(node.callback);
+        ++node.generation;
+        node.next = m_freeHead;
+        m_freeHead = index;
+        --m_size;
+
+        return callback;
+    }
+
+    // The slot list of a timer relative to Now(): the level is that of the highest tick digit in which the
+    // expiry differs from Now(). A timer due now is in the current level 0 slot.
+    std::uint32_t GetList(std::uint64_t expiry) const
+    {
+        if (expiry == m_now)
+        {
+            return static_cast<std::uint32_t>(m_now & kMask);
+        }
+
+        const unsigned level = detail::timer_highest_bit(expiry ^ m_now) / kSlotBits;
+        if (level >= kLevels)
+        {
+            return kOverflowList;
+        }
+
+        return static_cast<std::uint32_t>(level * kSlots + ((expiry >> (level * kSlotBits)) & kMask));
+    }
+
+    void Link(std::uint32_t index, std::uint32_t list)
+    {
+        Node& node = GetNode(index);
+        node.list = list;
+        node.prev = kNil;
+        node.next = m_heads[list];
+        if (node.next != kNil)
+        {
+            GetNode(node.next).prev = index;
+        }
+
+        m_heads[list] = index;
+        if (list != kOverflowList)
+        {
+            m_occupied[list / kSlots][(list % kSlots) / 64] |= std::uint64_t(1) << (list % 64);
+        }
+    }
+
+    void Unlink(std::uint32_t index)
+    {
+        Node& node = GetNode(index);
+        if (node.prev != kNil)
+        {
+            GetNode(node.prev).next = node.next;
+        }
+        else
+        {
+            m_heads[node.list] = node.next;
+            if (node.next == kNil && node.list != kOverflowList)
+            {
+                m_occupied[node.list / kSlots][(node.list % kSlots) / 64] &= ~(std::uint64_t(1) << (node.list % 64));
+            }
+        }
+
+        if (node.next != kNil)
+        {
+            GetNode(node.next).prev = node.prev;
+        }
+
+        node.list = kNil;
+    }
+
+    // First occupied slot of the level at or after from, kSlots if there is none.
+    std::size_t FindOccupied(unsigned level, std::size_t from) const
+    {
+        for (std::size_t word = from / 64; word < kWords; word++)
+        {
+            std::uint64_t bits = m_occupied[level][word];
+            if (word == from / 64)
+            {
+                bits &= ~std::uint64_t(0) << (from % 64);
+            }
+
+            if (bits != 0)
+            {
+                return word * 64 + detail::timer_lowest_bit(bits);
+            }
+        }
+
+        return kSlots;
+    }
+
+    // Relinks the timers of a list relative to Now(), postponed ones included.
+    void Redistribute(std::uint32_t list)
+    {
+        std::uint32_t index = m_heads[list];
+        while (index != kNil)
+        {
+            const std::uint32_t next = GetNode(index).next;
+            Unlink(index);
+            Link(index, GetList(GetNode(index).expiry));
+            index = next;
+        }
+    }
+
+    // Called when Now() reaches a new tick: the slots that start at it move down a level, coarsest first so
+    // that a timer can fall through several levels at once.
+    void Cascade()
+    {
+        constexpr unsigned kSpanBits = kLevels * kSlotBits;
+        if ((m_now & ((std::uint64_t(1) << kSpanBits) - 1)) == 0)
+        {
+            Redistribute(kOverflowList);
+        }
+
+        for (unsigned level = kLevels - 1; level > 0; level--)
+        {
+            const unsigned shift = level * kSlotBits;
+            if ((m_now & ((std::uint64_t(1) << shift) - 1)) == 0)
+            {
+                Redistribute(static_cast<std::uint32_t>(level * kSlots + ((m_now >> shift) & kMask)));
+            }
+        }
+    }
+
+    // Runs the timers of the current level 0 slot that expire at Now() and relinks the postponed ones.
+    // Timers scheduled meanwhile are due on a later tick, so the loop ends.
+    std::size_t RunExpired()
+    {
+        const auto list = static_cast<std::uint32_t>(m_now & kMask);
+
+        std::size_t fired = 0;
+        while (m_heads[list] != kNil)
+        {
+            const std::uint32_t index = m_heads[list];
+            if (GetNode(index).expiry != m_now)
+            {
+                Unlink(index);
+                Link(index, GetList(GetNode(index).expiry));
+                continue;
+            }
+
+            Callback callback = Release(index);
+            callback.InvokeOnce();
+            ++fired;
+        }
+
+        return fired;
+    }
+
+    std::uint64_t m_now;
+    std::size_t m_size = 0;
+
+    std::array<std::uint32_t, kLevels * kSlots + 1> m_heads;
+    std::array<std::array<std::uint64_t, kWords>, kLevels> m_occupied = {};
+
+    std::vector<std::unique_ptr<Node[]>> m_chunks;
+    std::uint32_t m_nodeCount = 0;
+    std::uint32_t m_freeHead = kNil;
+};
+} // namespace sdaineka
\ No newline at end of file
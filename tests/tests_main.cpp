@@ -1,8 +1,45 @@
+#include "atomic_delegate.hpp"
+#include "coalescing_dispatcher.hpp"
+#include "concurrent_multicast_delegate.hpp"
 #include "delegate.hpp"
+#include "delegate_coroutine.hpp"
+#include "delegate_pipeline.hpp"
+#include "delegate_queue.hpp"
+#include "delegate_ref.hpp"
+#include "delegate_table.hpp"
+#include "delegate_vector.hpp"
+#include "event_reactor.hpp"
+#include "inplace_delegate.hpp"
+#include "memoized_delegate.hpp"
+#include "multicast_delegate.hpp"
 #include "simple_heap_delegate.hpp"
+#include "task_scheduler.hpp"
+#include "timer_wheel.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstring>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 template<typename T>
 T add(const T lhs)
@@ -259,25 +296,2460 @@ buffer operator+(const buffer& lhs, const buffer& rhs)
     return buf;
 }
 
-int main(int argc, char* argv[])
+template<typename T>
+static void test_static_target(const T value, const T bindValue, const T callValue)
 {
-    std::cout << "test_add(int)\n";
-    test_add_value(5, 5, 5);
+    using BarType = Bar<T>;
+    using Delegate = sdaineka::Delegate<T(const T)>;
 
-    std::cout << "test_add(std::string)\n";
-    test_add_ref_value(std::string("hello"), std::string("stan"), std::string("longlonglonglonglonglonglonglonglonglonglongstring"));
+    BarType bar(value);
+    const BarType* constBar = &bar;
 
-    
-    buffer b1, b2, b3;
-    for (int i = 0; i < buffer::kSize; i++)
+    std::vector<Delegate> delegates;
+    delegates.push_back(Delegate::template Create<&add_2<T>>(bindValue));
+    delegates.push_back(Delegate::template Create<&add<T>>());
+    delegates.push_back(Delegate::template Create<&BarType::add_2>(&bar, bindValue));
+    delegates.push_back(Delegate::template Create<&BarType::add_2_const>(constBar, bindValue));
+    delegates.push_back(Delegate::template Create<&BarType::add>(&bar));
+
+    assert(delegates[0](callValue) == add_2(callValue, bindValue));
+    assert(delegates[2](callValue) == bar.add_2(callValue, bindValue));
+    assert(delegates[3](callValue) == bar.add_2_const(callValue, bindValue));
+
+    for (std::size_t i = 0; i < delegates.size(); i++)
     {
-        b1.data[i] = (i + 1) * 5;
-        b2.data[i] = (i + 7) * 7;
-        b3.data[i] = (i + 11) * 11;
+        const auto& d = delegates[i];
+        std::cout << "Delegate::Create<>[" << i << "] - value: " << d(callValue) << ", heapSize: " << d.GetHeapSize() << '\n';
     }
+}
 
-    std::cout << "test_add(POD buffer)\n";
-    test_add_ref_value(b1, b2, b3);
+template<typename T>
+static T visit_values(const std::vector<T>& values, sdaineka::DelegateRef<T(const T)> callback)
+{
+    T result{};
+    for (const T& value : values)
+    {
+        result = result + callback(value);
+    }
+
+    return result;
+}
+
+static void test_delegate_ref()
+{
+    using BarType = Bar<int>;
+    using DelegateRef = sdaineka::DelegateRef<int(const int)>;
+
+    static_assert(std::is_trivially_copyable_v<DelegateRef> && sizeof(DelegateRef) == 2 * sizeof(void*));
+
+    BarType bar(5);
+    const std::vector<int> values = {1, 2, 3};
+    int offset = 100;
+
+    auto delegate = sdaineka::Delegate<int(const int)>::CreateLambda([](const int v, const int b) { return v * b; }, 2);
+    auto heapDelegate = sdaineka::SimpleHeapDelegate<int(const int)>::CreateGlobal(&add_2<int>, 1);
+
+    assert(visit_values<int>(values, [&](const int v) { return v + offset; }) == 306);
+    assert(visit_values<int>(values, &add<int>) == 6);
+    assert(visit_values<int>(values, delegate) == 12);
+    assert(visit_values<int>(values, heapDelegate) == 9);
+    assert(visit_values<int>(values, DelegateRef::Create<&BarType::add>(&bar)) == 36);
+    assert(visit_values<int>(values, DelegateRef::Create<&BarType::add_const>(static_cast<const BarType*>(&bar))) == 36);
+    assert(visit_values<int>(values, DelegateRef::Create<&add<int>>()) == 6);
+    assert(!DelegateRef());
+
+    std::cout << "DelegateRef - size: " << sizeof(DelegateRef) << ", value: " << visit_values<int>(values, delegate) << '\n';
+}
+
+static void test_multicast_delegate()
+{
+    using Event = sdaineka::MulticastDelegate<void(int)>;
+
+    int sum = 0;
+    int calls = 0;
+    auto accumulate = [&sum, &calls](int v, int scale) {
+        sum += v * scale;
+        ++calls;
+    };
+
+    Event event;
+    const Event::Handle h1 = event.Subscribe(Event::DelegateType::CreateLambda(accumulate, 1));
+    const Event::Handle h2 = event.Subscribe(Event::DelegateType::CreateLambda(accumulate, 10));
+    const Event::Handle h3 = event.Subscribe(Event::DelegateType::CreateLambda(accumulate, 100));
+
+    event.Broadcast(2);
+    assert(sum == 222 && calls == 3);
+
+    assert(event.Unsubscribe(h2));
+    assert(!event.Unsubscribe(h2));
+    assert(!event.IsSubscribed(h2));
+    assert(event.IsSubscribed(h1) && event.IsSubscribed(h3));
+
+    // The freed slot is reused with a new generation, the old handle stays invalid.
+    const Event::Handle h4 = event.Subscribe(Event::DelegateType::CreateLambda(accumulate, 1000));
+    assert(h4.slot == h2.slot && !event.IsSubscribed(h2));
+
+    sum = 0;
+    event.Broadcast(1);
+    assert(sum == 1101 && event.Size() == 3);
+
+    event.Clear();
+    assert(event.Empty() && !event.IsSubscribed(h1));
+
+    // A throwing subscriber ends the broadcast, subscriptions can be changed afterwards.
+    event.Subscribe(Event::DelegateType::CreateLambda([](int) { throw std::runtime_error("subscriber failed"); }));
+    bool thrown = false;
+    try
+    {
+        event.Broadcast(1);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    event.Clear();
+    assert(event.Empty());
+
+    std::cout << "MulticastDelegate - calls: " << calls << ", size: " << sizeof(Event::DelegateType) << '\n';
+}
+
+// Counts live instances, invoking a destroyed one fails the test.
+struct Listener
+{
+    static inline std::atomic<int> s_alive{0};
+
+    explicit Listener(std::atomic<long>* sum)
+        : sum(sum)
+    {
+        ++s_alive;
+    }
+
+    Listener(const Listener& other)
+        : sum(other.sum)
+    {
+        ++s_alive;
+    }
+
+    ~Listener()
+    {
+        sum = nullptr;
+        --s_alive;
+    }
+
+    void operator()(int v) const
+    {
+        assert(sum != nullptr);
+        sum->fetch_add(v, std::memory_order_relaxed);
+    }
+
+    std::atomic<long>* sum;
+};
+
+static void test_concurrent_multicast_delegate()
+{
+    using Event = sdaineka::ConcurrentMulticastDelegate<void(int)>;
+
+    {
+        std::atomic<long> sum{0};
+
+        Event event;
+        const Event::Handle h1 = event.Subscribe(Event::DelegateType::CreateLambda(Listener(&sum)));
+        const Event::Handle h2 = event.Subscribe(Event::DelegateType::CreateLambda(Listener(&sum)));
+
+        // A subscriber removing itself during a broadcast stays alive until the broadcast returns.
+        Event::Handle self;
+        self = event.Subscribe(Event::DelegateType::CreateLambda([&event, &self, listener = Listener(&sum)](int v) {
+            const bool removed = event.Unsubscribe(self);
+            assert(removed);
+            listener(v);
+        }));
+
+        event.Broadcast(1);
+        assert(sum == 3 && event.Size() == 2 && !event.IsSubscribed(self));
+
+        event.Broadcast(1);
+        assert(sum == 5);
+
+        assert(event.Unsubscribe(h1));
+        assert(!event.Unsubscribe(h1));
+        assert(event.IsSubscribed(h2));
+
+        event.Clear();
+        event.Broadcast(1);
+        assert(sum == 5 && event.Size() == 0);
+
+        sdaineka::EpochDomain::Get()->Synchronize();
+        assert(Listener::s_alive == 0);
+    }
+
+    // Readers broadcast while writers keep changing the subscriptions.
+    {
+        constexpr int kReaders = 4;
+        constexpr int kWriters = 2;
+        constexpr int kWrites = 2000;
+
+        std::atomic<long> sum{0};
+        std::atomic<bool> done{false};
+        std::atomic<long> broadcasts{0};
+
+        Event event;
+        for (int i = 0; i < 8; i++)
+        {
+            event.Subscribe(Event::DelegateType::CreateLambda(Listener(&sum)));
+        }
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < kReaders; i++)
+        {
+            threads.emplace_back([&] {
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    event.Broadcast(1);
+                    broadcasts.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (int i = 0; i < kWriters; i++)
+        {
+            threads.emplace_back([&] {
+                std::vector<Event::Handle> handles;
+                for (int w = 0; w < kWrites; w++)
+                {
+                    if (handles.size() < 16 && (w % 3 != 2 || handles.empty()))
+                    {
+                        handles.push_back(event.Subscribe(Event::DelegateType::CreateLambda(Listener(&sum))));
+                    }
+                    else
+                    {
+                        const bool removed = event.Unsubscribe(handles.back());
+                        assert(removed);
+                        handles.pop_back();
+                    }
+                }
+
+                for (const Event::Handle handle : handles)
+                {
+                    const bool removed = event.Unsubscribe(handle);
+                    assert(removed);
+                }
+            });
+        }
+
+        for (int i = kReaders; i < kReaders + kWriters; i++)
+        {
+            threads[i].join();
+        }
+
+        done = true;
+        for (int i = 0; i < kReaders; i++)
+        {
+            threads[i].join();
+        }
+
+        assert(event.Size() == 8);
+        event.Clear();
+        sdaineka::EpochDomain::Get()->Synchronize();
+        assert(Listener::s_alive == 0);
+
+        std::cout << "ConcurrentMulticastDelegate - broadcasts: " << broadcasts << ", calls: " << sum << '\n';
+    }
+}
+
+static void test_atomic_delegate()
+{
+    using Slot = sdaineka::AtomicDelegate<void(int)>;
+
+    {
+        std::atomic<long> sum{0};
+
+        Slot slot;
+        assert(!slot && !slot.TryInvoke(1));
+
+        slot.Store(Slot::DelegateType::CreateLambda(Listener(&sum)));
+        slot(1);
+        assert(slot.TryInvoke(2) && sum == 3);
+
+        // A target replacing itself keeps running until it returns.
+        slot.Store(Slot::DelegateType::CreateLambda([&slot, &sum, listener = Listener(&sum)](int v) {
+            slot.Store(Slot::DelegateType::CreateLambda(Listener(&sum)));
+            listener(v * 10);
+        }));
+        slot(1);
+        slot(1);
+        assert(sum == 14);
+
+        // The previous delegate is handed over once no call can be running it.
+        Slot::DelegateType previous;
+        const auto keep = [&previous](Slot::DelegateType&& d) { previous = std::move(d); };
+        slot.Exchange(Slot::DelegateType(), Slot::HandoffType::CreateLambda(keep));
+        assert(!slot);
+        sdaineka::EpochDomain::Get()->Synchronize();
+        assert(previous);
+        previous(1);
+        assert(sum == 15);
+
+        slot.Store(std::move(previous));
+        slot.Reset();
+        sdaineka::EpochDomain::Get()->Synchronize();
+        assert(Listener::s_alive == 0);
+
+        bool emptyHandoff = false;
+        slot.Exchange(Slot::DelegateType::CreateLambda(Listener(&sum)),
+                      Slot::HandoffType::CreateLambda([&emptyHandoff](Slot::DelegateType&& d) { emptyHandoff = !d; }));
+        assert(emptyHandoff);
+        slot.Reset();
+        sdaineka::EpochDomain::Get()->Synchronize();
+        assert(Listener::s_alive == 0);
+
+        sdaineka::AtomicDelegate<int(int)> twice(sdaineka::Delegate<int(int)>::CreateGlobal(&add_2<int>, 1));
+        assert(twice(2) == 3);
+    }
+
+    // Readers call the slot while writers keep replacing its target.
+    {
+        constexpr int kReaders = 4;
+        constexpr int kWriters = 2;
+        constexpr int kWrites = 2000;
+
+        std::atomic<long> sum{0};
+        std::atomic<bool> done{false};
+        std::atomic<long> calls{0};
+
+        Slot slot(Slot::DelegateType::CreateLambda(Listener(&sum)));
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < kReaders; i++)
+        {
+            threads.emplace_back([&] {
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    slot(1);
+                    calls.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (int i = 0; i < kWriters; i++)
+        {
+            threads.emplace_back([&] {
+                for (int w = 0; w < kWrites; w++)
+                {
+                    // Small and heap payloads alternate.
+                    if (w % 2 == 0)
+                    {
+                        slot.Store(Slot::DelegateType::CreateLambda(Listener(&sum)));
+                    }
+                    else
+                    {
+                        slot.Store(Slot::DelegateType::CreateLambda([listener = Listener(&sum), pad = buffer{}](int v) { listener(v); }));
+                    }
+                }
+            });
+        }
+
+        for (int i = kReaders; i < kReaders + kWriters; i++)
+        {
+            threads[i].join();
+        }
+
+        done = true;
+        for (int i = 0; i < kReaders; i++)
+        {
+            threads[i].join();
+        }
+
+        assert(sum == calls);
+        slot.Reset();
+        sdaineka::EpochDomain::Get()->Synchronize();
+        assert(Listener::s_alive == 0);
+
+        std::cout << "AtomicDelegate - calls: " << calls << '\n';
+    }
+}
+
+// Throws when copied while armed.
+struct ThrowingCopy
+{
+    static inline bool armed = false;
+
+    explicit ThrowingCopy(int v)
+        : value(v)
+    {
+    }
+
+    ThrowingCopy(const ThrowingCopy& other)
+        : value(other.value)
+    {
+        if (armed)
+        {
+            throw std::runtime_error("ThrowingCopy");
+        }
+    }
+
+    int value;
+};
+
+static void test_delegate_queue()
+{
+    // Single producer: posting order, full queue, arguments stored by value.
+    {
+        using Queue = sdaineka::DelegateQueue<void(int, const std::string&)>;
+
+        std::string log;
+        auto append = [&log](int v, const std::string& s) { log += std::to_string(v) + s; };
+
+        Queue queue(3);
+        assert(queue.Capacity() == 4 && queue.Empty());
+
+        for (int i = 0; i < 4; i++)
+        {
+            std::string suffix = i % 2 == 0 ? "a" : "b";
+            const bool posted = queue.TryPost(Queue::DelegateType::CreateLambda(append), i, std::move(suffix));
+            assert(posted);
+        }
+
+        auto rejected = Queue::DelegateType::CreateLambda(append);
+        assert(!queue.TryPost(std::move(rejected), 9, std::string("x")));
+        assert(rejected);
+
+        assert(queue.Drain(3) == 3 && log == "0a1b2a");
+        assert(queue.TryPost(std::move(rejected), 9, std::string("x")));
+        assert(queue.Drain() == 2 && log == "0a1b2a3b9x" && queue.Empty());
+
+        std::cout << "DelegateQueue(SingleProducer) - log: " << log << '\n';
+    }
+
+    // Undrained messages are destroyed with the queue.
+    {
+        using Queue = sdaineka::DelegateQueue<void(std::shared_ptr<int>), sdaineka::DelegateQueueMode::MultiProducer>;
+
+        auto counter = std::make_shared<int>(0);
+        {
+            Queue queue(8);
+            for (int i = 0; i < 4; i++)
+            {
+                queue.Post(Queue::DelegateType::CreateLambda([counter](std::shared_ptr<int> p) { *p += 1; }), counter);
+            }
+
+            assert(counter.use_count() == 9);
+            assert(queue.Drain(2) == 2 && *counter == 2);
+            assert(counter.use_count() == 5);
+        }
+        assert(counter.use_count() == 1);
+    }
+
+    // An argument copy that throws publishes an empty cell, which the consumer skips instead of stalling on it.
+    {
+        using Queue = sdaineka::DelegateQueue<void(const ThrowingCopy&), sdaineka::DelegateQueueMode::MultiProducer>;
+
+        int sum = 0;
+        auto add = [&sum](const ThrowingCopy& arg) { sum += arg.value; };
+
+        Queue queue(4);
+        const ThrowingCopy one(1);
+        const ThrowingCopy two(2);
+        assert(queue.TryPost(Queue::DelegateType::CreateLambda(add), one));
+
+        ThrowingCopy::armed = true;
+        auto rejected = Queue::DelegateType::CreateLambda(add);
+        bool caught = false;
+        try
+        {
+            queue.TryPost(std::move(rejected), two);
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        ThrowingCopy::armed = false;
+        assert(caught && rejected);
+
+        assert(queue.TryPost(std::move(rejected), two));
+        assert(queue.Drain() == 2 && sum == 3 && queue.Empty());
+
+        // The skipped cell is reused once the ring wraps around.
+        for (int i = 0; i < 8; i++)
+        {
+            assert(queue.TryPost(Queue::DelegateType::CreateLambda(add), one));
+            assert(queue.Drain() == 1);
+        }
+        assert(sum == 11);
+    }
+
+    // Multiple producers: every message runs once and each producer's messages run in order.
+    {
+        using Queue = sdaineka::DelegateQueue<void(int, int), sdaineka::DelegateQueueMode::MultiProducer>;
+
+        constexpr int kProducers = 4;
+        constexpr int kMessages = 20000;
+
+        std::vector<int> next(kProducers, 0);
+        auto receive = [&next](int producer, int value) {
+            assert(next[producer] == value);
+            next[producer] = value + 1;
+        };
+
+        Queue queue(256);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; p++)
+        {
+            producers.emplace_back([&queue, &receive, p] {
+                for (int i = 0; i < kMessages; i++)
+                {
+                    queue.Post(Queue::DelegateType::CreateLambda(receive), p, i);
+                }
+            });
+        }
+
+        std::size_t received = 0;
+        while (received < static_cast<std::size_t>(kProducers * kMessages))
+        {
+            const std::size_t count = queue.Drain(64);
+            if (count == 0)
+            {
+                std::this_thread::yield();
+            }
+            received += count;
+        }
+
+        for (std::thread& producer : producers)
+        {
+            producer.join();
+        }
+
+        assert(queue.Empty());
+        for (int p = 0; p < kProducers; p++)
+        {
+            assert(next[p] == kMessages);
+        }
+
+        std::cout << "DelegateQueue(MultiProducer) - received: " << received << '\n';
+    }
+}
+
+static void test_task_scheduler()
+{
+    // Groups, nested parallel loops and tasks spawning tasks.
+    {
+        sdaineka::TaskScheduler scheduler(4);
+
+        std::atomic<int> count{0};
+        sdaineka::TaskGroup group;
+        for (int i = 0; i < 1000; i++)
+        {
+            scheduler.Submit(group, sdaineka::TaskScheduler::Task::CreateLambda([&count] { ++count; }));
+        }
+        scheduler.Wait(group);
+        assert(group.IsDone() && count == 1000);
+
+        std::vector<int> values(10000, 0);
+        scheduler.ParallelFor(0, values.size(), 64, [&](std::size_t i) {
+            values[i] = static_cast<int>(i);
+        });
+        for (std::size_t i = 0; i < values.size(); i++)
+        {
+            assert(values[i] == static_cast<int>(i));
+        }
+
+        std::atomic<long> sum{0};
+        scheduler.ParallelFor(0, 64, 1, [&](std::size_t i) {
+            scheduler.ParallelFor(0, 100, 8, [&](std::size_t j) { sum += static_cast<long>(i * 100 + j); });
+        });
+        assert(sum == 6400L * 6399 / 2);
+
+        std::cout << "TaskScheduler - workers: " << scheduler.GetWorkerCount() << ", sum: " << sum << '\n';
+    }
+
+    // Fire and forget tasks complete before the scheduler is destroyed.
+    {
+        std::atomic<int> count{0};
+        {
+            sdaineka::TaskScheduler scheduler(2);
+            for (int i = 0; i < 100; i++)
+            {
+                scheduler.Submit(sdaineka::TaskScheduler::Task::CreateLambda([&scheduler, &count] {
+                    scheduler.Submit(sdaineka::TaskScheduler::Task::CreateLambda([&count] { ++count; }));
+                    ++count;
+                }));
+            }
+        }
+        assert(count == 200);
+    }
+}
+
+static void test_timer_wheel()
+{
+    using Wheel = sdaineka::TimerWheel;
+
+    // Every timer fires exactly at its expiry, across all levels and the overflow list.
+    {
+        Wheel wheel(1000);
+
+        const std::uint64_t delays[] = {1, 2, 255, 256, 257, 300, 65535, 65536, 65537, 70000, 1u << 24, (1u << 24) + 3,
+                                        (std::uint64_t(1) << 32) + 5, (std::uint64_t(1) << 33) + 7};
+        std::vector<std::uint64_t> fired;
+        for (const std::uint64_t delay : delays)
+        {
+            wheel.Schedule(delay, Wheel::Callback::CreateLambda([&wheel, &fired, expiry = 1000 + delay] {
+                assert(wheel.Now() == expiry);
+                fired.push_back(expiry);
+            }));
+        }
+        assert(wheel.Size() == std::size(delays));
+        assert(wheel.GetNextEventTime() == 1001);
+
+        assert(wheel.Advance(256) == 4);
+        assert(wheel.AdvanceTo(1000 + 65536) == 4);
+        assert(wheel.AdvanceTo(std::uint64_t(1) << 34) == std::size(delays) - 8);
+        assert(wheel.Empty() && wheel.GetNextEventTime() == Wheel::kNever);
+
+        assert(std::is_sorted(fired.begin(), fired.end()) && fired.size() == std::size(delays));
+    }
+
+    // Cancellation, and callbacks that reschedule themselves or cancel timers due in the same tick.
+    {
+        Wheel wheel;
+        int ticks = 0;
+        int cancelledRuns = 0;
+
+        const Wheel::Handle cancelled = wheel.Schedule(10, Wheel::Callback::CreateLambda([&cancelledRuns] { ++cancelledRuns; }));
+        assert(wheel.IsPending(cancelled));
+        assert(wheel.Cancel(cancelled));
+        assert(!wheel.IsPending(cancelled) && !wheel.Cancel(cancelled));
+
+        struct Periodic
+        {
+            void operator()() const
+            {
+                if (++*ticks < 5)
+                {
+                    wheel->Schedule(100, Wheel::Callback::CreateLambda(*this));
+                }
+            }
+
+            Wheel* wheel;
+            int* ticks;
+        };
+        wheel.Schedule(100, Wheel::Callback::CreateLambda(Periodic{&wheel, &ticks}));
+
+        Wheel::Handle victim;
+        wheel.Schedule(50, Wheel::Callback::CreateLambda([&wheel, &victim] {
+            const bool removed = wheel.Cancel(victim);
+            assert(removed);
+        }));
+        victim = wheel.Schedule(51, Wheel::Callback::CreateLambda([&cancelledRuns] { ++cancelledRuns; }));
+
+        // Whichever of the two runs first cancels the other.
+        Wheel::Handle pair[2];
+        int pairRuns = 0;
+        for (int i = 0; i < 2; i++)
+        {
+            pair[i] = wheel.Schedule(60, Wheel::Callback::CreateLambda([&wheel, &pair, &pairRuns, i] {
+                ++pairRuns;
+                const bool removed = wheel.Cancel(pair[1 - i]);
+                assert(removed);
+            }));
+        }
+
+        // Postponed across levels and brought forward, the timer fires at its latest expiry only.
+        std::vector<std::uint64_t> moved;
+        const Wheel::Handle postponed = wheel.Schedule(20, Wheel::Callback::CreateLambda([&wheel, &moved] { moved.push_back(wheel.Now()); }));
+        assert(wheel.Reschedule(postponed, 700));
+        assert(wheel.RescheduleAt(postponed, 650) && wheel.Reschedule(postponed, 660) && wheel.IsPending(postponed));
+
+        // A callback scheduled for the past fires on the next tick.
+        wheel.ScheduleAt(0, Wheel::Callback::CreateLambda([&wheel] { assert(wheel.Now() == 1); }));
+
+        // Move-only bound arguments.
+        auto value = std::make_unique<int>(0);
+        wheel.Schedule(3, Wheel::Callback::CreateLambda([](std::unique_ptr<int> v) { assert(*v == 0); }, std::move(value)));
+
+        assert(wheel.Advance(1000) == 5 + 1 + 1 + 1 + 1 + 1);
+        assert(cancelledRuns == 0 && pairRuns == 1 && ticks == 5 && wheel.Empty());
+        assert(moved.size() == 1 && moved[0] == 660 && !wheel.Reschedule(postponed, 1));
+    }
+
+    // Random delays and advance steps against a reference model.
+    {
+        std::mt19937 rng(7);
+        Wheel wheel(12345);
+
+        std::vector<std::uint64_t> expiries;
+        std::vector<Wheel::Handle> handles;
+        std::vector<bool> cancelled;
+        std::size_t fired = 0;
+        for (std::uint32_t i = 0; i < 20000; i++)
+        {
+            const std::uint64_t delay = 1 + (rng() % 4 == 0 ? rng() % (1u << 26) : rng() % 5000);
+            expiries.push_back(wheel.Now() + delay);
+            handles.push_back(wheel.Schedule(delay, Wheel::Callback::CreateLambda([&wheel, &expiries, &fired, i] {
+                assert(wheel.Now() == expiries[i]);
+                ++fired;
+            })));
+            cancelled.push_back(false);
+
+            if (rng() % 3 == 0)
+            {
+                const std::size_t victim = rng() % handles.size();
+                cancelled[victim] = wheel.Cancel(handles[victim]) || cancelled[victim];
+            }
+
+            if (rng() % 3 == 0)
+            {
+                const std::size_t moved = rng() % handles.size();
+                const std::uint64_t later = 1 + rng() % 20000;
+                if (wheel.Reschedule(handles[moved], later))
+                {
+                    expiries[moved] = wheel.Now() + later;
+                }
+            }
+
+            if (rng() % 16 == 0)
+            {
+                wheel.Advance(rng() % 3000);
+            }
+        }
+
+        wheel.Advance(std::uint64_t(1) << 27);
+        assert(wheel.Empty());
+
+        const auto cancelledCount = static_cast<std::size_t>(std::count(cancelled.begin(), cancelled.end(), true));
+        assert(fired + cancelledCount == expiries.size());
+
+        std::cout << "TimerWheel - fired: " << fired << ", cancelled: " << cancelledCount << '\n';
+    }
+}
+
+#if defined(__linux__)
+static void test_event_reactor()
+{
+    using Reactor = sdaineka::EventReactor;
+
+    // Pipe read end, level triggered.
+    {
+        Reactor reactor;
+        int fds[2];
+        const int piped = pipe(fds);
+        assert(piped == 0);
+
+        char received = 0;
+        const bool added = reactor.Add(fds[0], EPOLLIN, Reactor::Handler::CreateLambda([&](int fd, std::uint32_t events) {
+            assert(events & EPOLLIN);
+            const ssize_t n = read(fd, &received, 1);
+            assert(n == 1);
+        }));
+        assert(added);
+        assert(reactor.IsRegistered(fds[0]));
+        assert(reactor.Size() == 1);
+        assert(reactor.Poll(0) == 0);
+
+        const ssize_t written = write(fds[1], "x", 1);
+        assert(written == 1);
+        assert(reactor.Poll(0) == 1);
+        assert(received == 'x');
+        assert(reactor.Poll(0) == 0);
+
+        const bool duplicate = reactor.Add(fds[0], EPOLLIN, Reactor::Handler::CreateLambda([](int, std::uint32_t) {}));
+        assert(!duplicate && errno == EEXIST);
+
+        const bool removed = reactor.Remove(fds[0]);
+        assert(removed);
+        assert(!reactor.IsRegistered(fds[0]));
+        assert(reactor.Size() == 0);
+        const bool removedAgain = reactor.Remove(fds[0]);
+        assert(!removedAgain && errno == ENOENT);
+        const bool modified = reactor.Modify(fds[0], EPOLLIN);
+        assert(!modified && errno == ENOENT);
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    // eventfd counter, edge triggered.
+    {
+        Reactor reactor;
+        const int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        assert(efd >= 0);
+
+        std::uint64_t total = 0;
+        const bool added = reactor.Add(efd, EPOLLIN | EPOLLET, Reactor::Handler::CreateLambda([&](int fd, std::uint32_t) {
+            std::uint64_t value = 0;
+            const ssize_t n = read(fd, &value, sizeof(value));
+            assert(n == sizeof(value));
+            total += value;
+        }));
+        assert(added);
+
+        for (std::uint64_t i = 1; i <= 3; i++)
+        {
+            const ssize_t n = write(efd, &i, sizeof(i));
+            assert(n == sizeof(i));
+        }
+        assert(reactor.Poll(0) == 1);
+        assert(total == 6);
+
+        const bool removed = reactor.Remove(efd);
+        assert(removed);
+        close(efd);
+    }
+
+    // Socket pair switched from reading to writing.
+    {
+        Reactor reactor;
+        int fds[2];
+        const int paired = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds);
+        assert(paired == 0);
+
+        std::uint32_t seen = 0;
+        const bool added = reactor.Add(fds[0], EPOLLIN, Reactor::Handler::CreateLambda([&](int, std::uint32_t events) {
+            seen = events;
+        }));
+        assert(added);
+        assert(reactor.Poll(0) == 0);
+
+        const bool modified = reactor.Modify(fds[0], EPOLLOUT);
+        assert(modified);
+        assert(reactor.Poll(0) == 1);
+        assert(seen & EPOLLOUT);
+
+        // Closing the peer reports a hang up.
+        const bool readable = reactor.Modify(fds[0], EPOLLIN | EPOLLRDHUP);
+        assert(readable);
+        close(fds[1]);
+        assert(reactor.Poll(0) == 1);
+        assert(seen & EPOLLRDHUP);
+
+        const bool removed = reactor.Remove(fds[0]);
+        assert(removed);
+        close(fds[0]);
+    }
+
+    // A handler that removes itself is destroyed after it returns, and may register a new handler.
+    {
+        Reactor reactor;
+        const int efd = eventfd(1, EFD_CLOEXEC);
+        assert(efd >= 0);
+
+        auto alive = std::make_shared<int>(0);
+        int first = 0;
+        int second = 0;
+        const bool added = reactor.Add(efd, EPOLLIN, Reactor::Handler::CreateLambda([&, alive](int fd, std::uint32_t) {
+            ++first;
+            const bool removed = reactor.Remove(fd);
+            assert(removed);
+            assert(alive.use_count() == 1);
+            const bool readded = reactor.Add(fd, EPOLLIN, Reactor::Handler::CreateLambda([&](int, std::uint32_t) { ++second; }));
+            assert(readded);
+        }));
+        assert(added);
+
+        std::weak_ptr<int> weak = alive;
+        alive.reset();
+        assert(reactor.Poll(0) == 1);
+        assert(first == 1 && second == 0);
+        assert(weak.expired());
+        assert(reactor.Size() == 1);
+
+        assert(reactor.Poll(0) == 1);
+        assert(first == 1 && second == 1);
+
+        const bool removed = reactor.Remove(efd);
+        assert(removed);
+        close(efd);
+    }
+
+    // Two ready descriptors that remove each other: the stale event of the second one is dropped, even when its
+    // number is registered again in between.
+    {
+        Reactor reactor;
+        const int a = eventfd(1, EFD_CLOEXEC);
+        const int b = eventfd(1, EFD_CLOEXEC);
+        assert(a >= 0 && b >= 0);
+
+        int calls = 0;
+        int replacementCalls = 0;
+        auto removeOther = [&](int fd, std::uint32_t) {
+            ++calls;
+            const int other = fd == a ? b : a;
+            const bool removed = reactor.Remove(other);
+            assert(removed);
+            const bool readded = reactor.Add(other, EPOLLIN, Reactor::Handler::CreateLambda([&](int, std::uint32_t) { ++replacementCalls; }));
+            assert(readded);
+        };
+        const bool addedA = reactor.Add(a, EPOLLIN, Reactor::Handler::CreateLambda(removeOther));
+        const bool addedB = reactor.Add(b, EPOLLIN, Reactor::Handler::CreateLambda(removeOther));
+        assert(addedA && addedB);
+
+        assert(reactor.Poll(0) == 1);
+        assert(calls == 1 && replacementCalls == 0);
+
+        const bool removedA = reactor.Remove(a);
+        const bool removedB = reactor.Remove(b);
+        assert(removedA && removedB);
+        close(a);
+        close(b);
+    }
+
+    // A handler that replaces itself and then throws: the replacement is installed and later polls dispatch.
+    {
+        Reactor reactor;
+        const int efd = eventfd(1, EFD_CLOEXEC);
+        assert(efd >= 0);
+
+        int replacementCalls = 0;
+        const bool added = reactor.Add(efd, EPOLLIN, Reactor::Handler::CreateLambda([&](int fd, std::uint32_t) {
+            const bool removed = reactor.Remove(fd);
+            assert(removed);
+            const bool readded = reactor.Add(fd, EPOLLIN, Reactor::Handler::CreateLambda([&](int, std::uint32_t) { ++replacementCalls; }));
+            assert(readded);
+            throw std::runtime_error("handler failed");
+        }));
+        assert(added);
+
+        bool thrown = false;
+        try
+        {
+            reactor.Poll(0);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+
+        assert(reactor.Poll(0) == 1);
+        assert(replacementCalls == 1);
+
+        // A throwing handler removed from outside the dispatch is not called again.
+        int throwingCalls = 0;
+        const bool removed = reactor.Remove(efd);
+        assert(removed);
+        const bool readded = reactor.Add(efd, EPOLLIN, Reactor::Handler::CreateLambda([&](int, std::uint32_t) {
+            ++throwingCalls;
+            throw std::runtime_error("handler failed");
+        }));
+        assert(readded);
+        thrown = false;
+        try
+        {
+            reactor.Poll(0);
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        assert(thrown && throwingCalls == 1);
+
+        const bool removedThrowing = reactor.Remove(efd);
+        assert(removedThrowing);
+        assert(reactor.Poll(0) == 0 && throwingCalls == 1);
+        close(efd);
+    }
+
+    // A descriptor closed before Remove still unregisters.
+    {
+        Reactor reactor;
+        const int efd = eventfd(0, EFD_CLOEXEC);
+        const bool added = reactor.Add(efd, EPOLLIN, Reactor::Handler::CreateLambda([](int, std::uint32_t) {}));
+        assert(added);
+        close(efd);
+        const bool removed = reactor.Remove(efd);
+        assert(removed);
+        assert(reactor.Size() == 0);
+    }
+}
+#endif
+
+static void test_inplace_delegate()
+{
+    using BarType = Bar<int>;
+
+    BarType bar(3);
+    std::string prefix = "a long prefix that does not use the small string buffer: ";
+    auto concat = [prefix](const std::string& v) { return prefix + v; };
+
+    // Capacity computed from the bindings that will be stored.
+    using Target1 = sdaineka::delegate_target_t<decltype(&add_2<int>), int>;
+    using Target2 = sdaineka::delegate_target_t<decltype(&BarType::add_2), BarType*, int>;
+    using Target3 = sdaineka::delegate_target_t<BarType*, int>;
+    using Inplace = sdaineka::InplaceDelegateFor<int(int), Target1, Target2, Target3>;
+
+    static_assert(Inplace::GetCapacity() == sizeof(Target2));
+    static_assert(Inplace::Fits<Target1>() && Inplace::Fits<Target3>());
+    static_assert(!Inplace::Fits<sdaineka::delegate_target_t<decltype(&add_2<int>), buffer, buffer, buffer>>());
+
+    Inplace d1 = Inplace::CreateGlobal(&add_2<int>, 5);
+    Inplace d2 = Inplace::CreateMember(&bar, &BarType::add_2, 5);
+    Inplace d3 = Inplace::Create<&BarType::add_2>(&bar, 5);
+    Inplace d4 = Inplace::CreateLambda([](int x) { return x * 2; });
+    assert(d1(1) == 6 && d2(1) == 9 && d3(1) == 9 && d4(4) == 8);
+
+    Inplace moved = std::move(d2);
+    assert(!d2 && moved(1) == 9);
+
+    const Inplace clone = moved.Clone();
+    assert(clone(2) == 10);
+
+    const int inputs[] = {1, 2, 3};
+    int results[3] = {};
+    d1.InvokeBatch(results, 3, inputs);
+    assert(results[0] == 6 && results[1] == 7 && results[2] == 8);
+
+    // Non-trivial payloads are relocated through their move constructor.
+    using StringDelegate = sdaineka::InplaceDelegateFor<std::string(const std::string&), decltype(concat)>;
+    std::vector<StringDelegate> delegates;
+    for (int i = 0; i < 8; i++)
+    {
+        delegates.push_back(StringDelegate::CreateLambda(concat));
+    }
+    assert(delegates.back()("x") == prefix + "x");
+
+    std::cout << "InplaceDelegate - capacity: " << Inplace::GetCapacity() << ", size: " << sizeof(Inplace)
+              << ", string capacity: " << StringDelegate::GetCapacity() << '\n';
+}
+
+template<typename TDelegate>
+static void test_invoke_batch(const char* name)
+{
+    using BarType = Bar<int>;
+
+    BarType bar(3);
+    std::vector<int> lhs(100);
+    std::vector<int> rhs(100);
+    for (int i = 0; i < 100; i++)
+    {
+        lhs[i] = i;
+        rhs[i] = 2 * i;
+    }
+
+    std::vector<int> results(100, -1);
+    const auto d1 = TDelegate::CreateMember(&bar, &BarType::add_2);
+    d1.InvokeBatch(results.data(), results.size(), lhs.data(), rhs.data());
+    for (int i = 0; i < 100; i++)
+    {
+        assert(results[i] == d1(lhs[i], rhs[i]));
+    }
+
+    int sum = 0;
+    const auto d2 = TDelegate::CreateLambda([&sum](int a, int b) {
+        sum += a * b;
+        return sum;
+    });
+    d2.InvokeBatch(lhs.size(), lhs.data(), rhs.data());
+    assert(sum == 2 * 328350);
+
+    using Visitor = typename std::conditional_t<std::is_same_v<TDelegate, sdaineka::Delegate<int(int, int)>>,
+                                                sdaineka::Delegate<void(const std::string&)>, sdaineka::SimpleHeapDelegate<void(const std::string&)>>;
+    std::string joined;
+    const auto visitor = Visitor::CreateLambda([&joined](const std::string& s) { joined += s; });
+    const std::vector<std::string> words = {"batch", "ed", " ", "call"};
+    visitor.ForEach(words);
+    assert(joined == "batched call");
+
+    std::cout << name << " - InvokeBatch: " << results[99] << ", " << sum << ", ForEach: " << joined << '\n';
+}
+
+struct Weight
+{
+    void Add(int& total) const
+    {
+        total += weight;
+    }
+
+    int weight;
+};
+
+static void test_delegate_vector()
+{
+    using Vector = sdaineka::DelegateVector<void(int&)>;
+    using Delegate = Vector::DelegateType;
+
+    std::vector<Weight> weights;
+    for (int i = 0; i < 100; i++)
+    {
+        weights.push_back({i});
+    }
+
+    // Inline trivial, inline relocated through the move constructor and heap payloads, added interleaved.
+    const auto counter = std::make_shared<int>(1);
+    const std::string text(64, 'x');
+
+    Vector vector;
+    std::vector<Vector::Handle> handles;
+    for (const Weight& weight : weights)
+    {
+        handles.push_back(vector.Add(Delegate::Create<&Weight::Add>(&weight)));
+        handles.push_back(vector.Add(Delegate::CreateLambda([counter](int& total) { total += *counter; })));
+        handles.push_back(vector.Add(Delegate::CreateLambda([text](int& total) { total += static_cast<int>(text.size()); })));
+    }
+    assert(vector.Size() == 300 && vector.GetBucketCount() == 3 && counter.use_count() == 101);
+
+    int total = 0;
+    vector.InvokeAll(total);
+    assert(total == 4950 + 100 + 6400);
+
+    // Removing every other element swaps the last payload of each bucket into the freed position.
+    for (std::size_t i = 0; i < handles.size(); i += 2)
+    {
+        const bool removed = vector.Remove(handles[i]);
+        assert(removed);
+    }
+    assert(!vector.Remove(handles[0]) && !vector.Contains(handles[0]) && vector.Contains(handles[1]));
+    assert(vector.Size() == 150 && counter.use_count() == 51);
+
+    total = 0;
+    vector.InvokeAll(total);
+    assert(total == 2500 + 50 + 3200);
+
+    // The freed slot is reused with a new generation, the old handle stays invalid.
+    const Vector::Handle reused = vector.Add(Delegate::CreateGlobal(+[](int& value) { value += 1000000; }));
+    assert(reused.slot == handles.back().slot - 1 && vector.Contains(reused) && vector.GetBucketCount() == 4);
+
+    total = 0;
+    vector.InvokeAll(total);
+    assert(total == 1000000 + 2500 + 50 + 3200);
+
+    vector.Clear();
+    assert(vector.Empty() && !vector.Contains(reused) && !vector.Contains(handles[1]) && counter.use_count() == 1);
+
+    total = 0;
+    vector.InvokeAll(total);
+    assert(total == 0);
+
+    // A throwing target ends the call, elements can be changed afterwards.
+    const Vector::Handle throwing = vector.Add(Delegate::CreateLambda([](int&) { throw std::runtime_error("target failed"); }));
+    bool thrown = false;
+    try
+    {
+        vector.InvokeAll(total);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    const bool removedThrowing = vector.Remove(throwing);
+    assert(removedThrowing && vector.Empty());
+
+    std::cout << "DelegateVector - buckets: " << vector.GetBucketCount() << ", size: " << sizeof(Vector) << '\n';
+}
+
+#if SDAINEKA_DELEGATE_INSTRUMENTATION
+static int instrumented_twice(int x)
+{
+    return 2 * x;
+}
+
+static int instrumented_thrice(int x)
+{
+    return 3 * x;
+}
+
+static void test_instrumentation()
+{
+    using Delegate = sdaineka::Delegate<int(int)>;
+
+    // Sums the targets whose name contains part.
+    const auto findTarget = [](std::string_view part) {
+        sdaineka::DelegateCallStats result = {};
+        for (const sdaineka::DelegateCallStats& stats : sdaineka::DelegateInstrumentation::Get()->Collect())
+        {
+            if (stats.target.find(part) != std::string_view::npos)
+            {
+                result.target = stats.target;
+                result.calls += stats.calls;
+                result.totalNs += stats.totalNs;
+                result.maxNs = std::max(result.maxNs, stats.maxNs);
+            }
+        }
+        return result;
+    };
+
+    // CreateGlobal targets are identified by the function pointer, whose address ends their name.
+    const auto addressOf = [](int (*func)(int)) {
+        std::uintptr_t address = 0;
+        std::memcpy(&address, &func, sizeof(func));
+        std::ostringstream name;
+        name << " at 0x" << std::hex << std::setfill('0') << std::setw(sizeof(address) * 2) << address;
+        return name.str();
+    };
+
+    const Delegate twice = Delegate::Create<&instrumented_twice>();
+    const Delegate globalTwice = Delegate::CreateGlobal(&instrumented_twice);
+    const Delegate globalThrice = Delegate::CreateGlobal(&instrumented_thrice);
+    const auto heapTwice = sdaineka::SimpleHeapDelegate<int(int)>::CreateGlobal(&instrumented_twice);
+    for (int i = 0; i < 10; i++)
+    {
+        twice(i);
+        globalTwice(i);
+        heapTwice(i);
+    }
+    globalThrice(1);
+
+    // Other threads record into their own tables, counts are summed.
+    std::thread([&twice] {
+        for (int i = 0; i < 5; i++)
+        {
+            twice(i);
+        }
+    }).join();
+
+    const sdaineka::DelegateCallStats stats = findTarget("instrumented_twice");
+    assert(stats.calls == 15 && stats.totalNs >= stats.maxNs);
+    assert(findTarget(addressOf(&instrumented_twice)).calls == 20);
+    assert(findTarget(addressOf(&instrumented_thrice)).calls == 1);
+
+    std::ostringstream csv;
+    sdaineka::DelegateInstrumentation::Get()->WriteCsv(csv);
+    assert(csv.str().rfind("target,calls,total_ns,max_ns\n", 0) == 0);
+
+    std::ostringstream json;
+    sdaineka::DelegateInstrumentation::Get()->WriteJson(json);
+    assert(json.str().find("instrumented_twice") != std::string::npos);
+
+    std::cout << "DelegateInstrumentation - " << stats.target << ": " << stats.calls << " calls\n";
+}
+#endif
+
+#if SDAINEKA_DELEGATE_TELEMETRY
+static void test_storage_telemetry()
+{
+    // A signature no other test uses, so the counts start at zero.
+    using Delegate = sdaineka::Delegate<int(short)>;
+
+    std::vector<Delegate> delegates;
+    for (int i = 0; i < 99; i++)
+    {
+        delegates.push_back(Delegate::CreateLambda([i](short x) { return x + i; }));
+    }
+
+    std::array<char, 64> large = {};
+    delegates.push_back(Delegate::CreateLambda([large](short x) { return x + large[0]; }));
+    sdaineka::SimpleHeapDelegate<int(short)>::CreateLambda([](short x) { return x + 1; });
+
+    sdaineka::DelegateStorageStats stats = {};
+    std::size_t heapDelegates = 0;
+    for (const sdaineka::DelegateStorageStats& s : sdaineka::DelegateStorageTelemetry::Get()->Collect())
+    {
+        if (s.delegate.find("int(short int)") == std::string_view::npos)
+        {
+            continue;
+        }
+
+        if (s.delegate.find("SimpleHeapDelegate") != std::string_view::npos)
+        {
+            heapDelegates += s.heapFallbacks;
+        }
+        else
+        {
+            stats = s;
+        }
+    }
+
+    assert(stats.constructed == 100 && stats.heapFallbacks == 1 && stats.heapBytes == 64 && stats.maxSize == 64);
+    assert(stats.inlineCapacity == Delegate::GetStorageStackSize() && heapDelegates == 1);
+    assert(stats.GetPercentileSize(0.99) == 8 && stats.GetPercentileSize(1.0) == 64 && stats.GetRecommendedSize() == 16);
+
+    std::ostringstream csv;
+    sdaineka::DelegateStorageTelemetry::Get()->WriteCsv(csv);
+    assert(csv.str().find("int(short int)") != std::string::npos);
+
+    std::cout << "DelegateStorageTelemetry - " << stats.delegate << ": p99 " << stats.GetPercentileSize(0.99) << ", recommended "
+              << stats.GetRecommendedSize() << '\n';
+}
+#endif
+
+static void test_lifetime()
+{
+    // Inline payload with non-trivially relocatable state, moved around by vector reallocation.
+    {
+        using Delegate = sdaineka::Delegate<std::string(const std::string&)>;
+
+        std::vector<Delegate> delegates;
+        for (int i = 0; i < 16; i++)
+        {
+            delegates.push_back(Delegate::CreateLambda([prefix = std::string("sso")](const std::string& v) { return prefix + v; }));
+        }
+
+        const auto& d = delegates.back();
+        assert(d("!") == "sso!");
+        assert(d.GetHeapSize() == 0);
+        std::cout << "Delegate(std::string capture) - value: " << d("!") << ", heapSize: " << d.GetHeapSize() << '\n';
+    }
+
+    // Captured shared_ptr must be released exactly once, both for inline and heap storage.
+    {
+        using Delegate = sdaineka::Delegate<int(int)>;
+
+        auto counter = std::make_shared<int>(5);
+        {
+            std::vector<Delegate> delegates;
+            for (int i = 0; i < 16; i++)
+            {
+                delegates.push_back(Delegate::CreateLambda([counter](int v) { return *counter + v; }));
+                delegates.push_back(Delegate::CreateLambda([counter, pad = buffer{}](int v) { return *counter + v + pad.data[0]; }));
+            }
+
+            assert(counter.use_count() == 33);
+            assert(delegates[0].GetHeapSize() == 0);
+            assert(delegates[1].GetHeapSize() != 0);
+
+            const Delegate clone = delegates[0].Clone();
+            assert(clone(1) == 6);
+            assert(counter.use_count() == 34);
+
+            std::cout << "Delegate(shared_ptr capture) - use_count: " << counter.use_count() << '\n';
+        }
+        assert(counter.use_count() == 1);
+        std::cout << "Delegate(shared_ptr capture) - use_count after destroy: " << counter.use_count() << '\n';
+    }
+
+    // Move-only payloads can not be cloned.
+    {
+        using Delegate = sdaineka::Delegate<int()>;
+
+        const auto d = Delegate::CreateLambda([p = std::make_unique<int>(7)]() { return *p; });
+        assert(d() == 7);
+        assert(!d.IsCopyable());
+        assert(!d.Clone());
+    }
+}
+
+// Large bound buffer that counts its copies.
+struct TrackedBuffer
+{
+    static inline int copies = 0;
+
+    TrackedBuffer(std::size_t size)
+        : data(size, 1)
+    {
+    }
+
+    TrackedBuffer(const TrackedBuffer& other)
+        : data(other.data)
+    {
+        ++copies;
+    }
+
+    TrackedBuffer(TrackedBuffer&&) noexcept = default;
+
+    std::vector<int> data;
+};
+
+// Targets take the buffer by value: copied on a regular call, moved on a one-shot call.
+template<>
+struct sdaineka::DelegateBindArg<TrackedBuffer> : sdaineka::DelegateBindByValue<TrackedBuffer>
+{};
+
+static int consume_buffer(int base, TrackedBuffer buffer)
+{
+    return base + static_cast<int>(buffer.data.size());
+}
+
+static int consume_unique(int base, std::unique_ptr<int>&& value)
+{
+    const std::unique_ptr<int> owned = std::move(value);
+    return base + *owned;
+}
+
+static int consume_buffers(int base, std::vector<TrackedBuffer>&& buffers)
+{
+    const std::vector<TrackedBuffer> owned = std::move(buffers);
+    return base + static_cast<int>(owned.size());
+}
+
+struct UniqueSink
+{
+    int Take(int base, std::unique_ptr<int>&& value)
+    {
+        const std::unique_ptr<int> owned = std::move(value);
+        taken += *owned;
+        return base + taken;
+    }
+
+    int TakeBuffers(int base, std::vector<TrackedBuffer>&& buffers) const
+    {
+        const std::vector<TrackedBuffer> owned = std::move(buffers);
+        return base + static_cast<int>(owned.size());
+    }
+
+    int taken = 0;
+};
+
+static void test_invoke_once()
+{
+    using Delegate = sdaineka::Delegate<int(int)>;
+
+    // Bound buffer taken by value: regular calls copy it, the one-shot call hands it over.
+    {
+        TrackedBuffer::copies = 0;
+
+        auto d = Delegate::CreateGlobal(&consume_buffer, TrackedBuffer(1000));
+        assert(TrackedBuffer::copies == 0);
+        assert(d(1) == 1001 && d(2) == 1002);
+        assert(TrackedBuffer::copies == 2);
+
+        assert(d.InvokeOnce(3) == 1003);
+        assert(TrackedBuffer::copies == 2 && !d);
+
+        auto other = Delegate::CreateLambda([](int base, TrackedBuffer buffer) { return base + static_cast<int>(buffer.data.size()); },
+                                            TrackedBuffer(10));
+        assert(std::move(other)(5) == 15);
+        assert(TrackedBuffer::copies == 2 && !other);
+
+        std::cout << "Delegate(InvokeOnce) - buffer copies: " << TrackedBuffer::copies << '\n';
+    }
+
+    // Move-only bound arguments in every factory.
+    {
+        auto global = Delegate::CreateGlobal(&consume_unique, std::make_unique<int>(7));
+        assert(!global.IsCopyable());
+        assert(std::move(global)(1) == 8 && !global);
+
+        UniqueSink sink;
+        auto member = Delegate::CreateMember(&sink, &UniqueSink::Take, std::make_unique<int>(2));
+        assert(member.InvokeOnce(1) == 3);
+
+        auto target = Delegate::Create<&UniqueSink::Take>(&sink, std::make_unique<int>(3));
+        assert(target.InvokeOnce(1) == 6);
+
+        auto lambda = Delegate::CreateLambda([](int base, std::unique_ptr<int> value) { return base + *value; }, std::make_unique<int>(4));
+        assert(lambda.InvokeOnce(1) == 5);
+
+        // Heap payload, released by the one-shot call.
+        auto take = [pad = std::array<char, 64>{}](int base, std::unique_ptr<int> value) { return base + *value + pad[0]; };
+        auto big = Delegate::CreateLambda(take, std::make_unique<int>(5));
+        assert(big.GetHeapSize() != 0);
+        assert(big.InvokeOnce(1) == 6);
+        assert(!big && big.GetHeapSize() == 0);
+    }
+
+    // Copyable bound vector taken over through an rvalue reference parameter: no element is copied.
+    {
+        std::vector<TrackedBuffer> buffers(3, TrackedBuffer(10));
+        std::vector<TrackedBuffer> memberBuffers(2, TrackedBuffer(10));
+        std::vector<TrackedBuffer> pooledBuffers(4, TrackedBuffer(1));
+        TrackedBuffer::copies = 0;
+
+        auto global = Delegate::CreateGlobal(&consume_buffers, std::move(buffers));
+        assert(global.IsCopyable());
+        assert(global.InvokeOnce(1) == 4 && !global);
+
+        const UniqueSink sink;
+        auto member = Delegate::CreateMember(&sink, &UniqueSink::TakeBuffers, std::move(memberBuffers));
+        assert(std::move(member)(1) == 3 && !member);
+
+        auto pooled = Delegate::CreateGlobal(std::allocator_arg, std::pmr::new_delete_resource(), &consume_buffers, std::move(pooledBuffers));
+        assert(pooled.InvokeOnce(0) == 4);
+
+        assert(TrackedBuffer::copies == 0);
+    }
+
+    // InplaceDelegate hands bound arguments over the same way.
+    {
+        using Target = sdaineka::delegate_target_t<decltype(&consume_buffers), std::vector<TrackedBuffer>>;
+        using Inplace = sdaineka::InplaceDelegateFor<int(int), Target>;
+
+        std::vector<TrackedBuffer> buffers(3, TrackedBuffer(10));
+        TrackedBuffer::copies = 0;
+
+        auto global = Inplace::CreateGlobal(&consume_buffers, std::move(buffers));
+        assert(global.InvokeOnce(1) == 4 && !global);
+
+        auto buffer = Inplace::Create<&consume_buffer>(TrackedBuffer(10));
+        assert(buffer(1) == 11 && TrackedBuffer::copies == 1);
+        assert(std::move(buffer)(2) == 12 && !buffer);
+        assert(TrackedBuffer::copies == 1);
+
+        auto unique = Inplace::CreateGlobal(&consume_unique, std::make_unique<int>(7));
+        assert(!unique.IsCopyable());
+        assert(unique.InvokeOnce(1) == 8 && !unique);
+    }
+
+    // So does SimpleHeapDelegate, regular calls keep copying.
+    {
+        using Heap = sdaineka::SimpleHeapDelegate<int(int)>;
+
+        std::vector<TrackedBuffer> buffers(3, TrackedBuffer(10));
+        std::vector<TrackedBuffer> memberBuffers(2, TrackedBuffer(10));
+        TrackedBuffer::copies = 0;
+
+        auto global = Heap::CreateGlobal(&consume_buffers, std::move(buffers));
+        assert(global.InvokeOnce(1) == 4 && !global);
+
+        const UniqueSink sink;
+        auto member = Heap::CreateMember(&sink, &UniqueSink::TakeBuffers, std::move(memberBuffers));
+        assert(std::move(member)(1) == 3 && !member);
+        assert(TrackedBuffer::copies == 0);
+
+        auto buffer = Heap::CreateGlobal(&consume_buffer, TrackedBuffer(10));
+        assert(buffer(1) == 11 && TrackedBuffer::copies == 1);
+        assert(std::move(buffer)(2) == 12 && !buffer);
+        assert(TrackedBuffer::copies == 1);
+
+        auto unique = Heap::CreateGlobal(std::allocator_arg, std::pmr::new_delete_resource(), &consume_unique, std::make_unique<int>(7));
+        assert(unique.InvokeOnce(1) == 8 && !unique);
+
+        auto lambda = Heap::CreateLambda([](int base, std::unique_ptr<int> value) { return base + *value; }, std::make_unique<int>(4));
+        assert(lambda.InvokeOnce(1) == 5 && !lambda);
+    }
+
+    // Queued completion callbacks run once, the buffer is never copied.
+    {
+        using Queue = sdaineka::DelegateQueue<void(int)>;
+
+        TrackedBuffer::copies = 0;
+
+        int received = 0;
+        auto complete = [&received](int base, TrackedBuffer buffer) { received = base + static_cast<int>(buffer.data.size()); };
+
+        Queue queue(4);
+        const bool posted = queue.TryPost(Queue::DelegateType::CreateLambda(complete, TrackedBuffer(100)), 1);
+        assert(posted);
+        assert(queue.Drain() == 1);
+        assert(received == 101 && TrackedBuffer::copies == 0);
+    }
+}
+
+// Forwards to new/delete and counts outstanding blocks.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    int allocations = 0;
+    int outstanding = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++allocations;
+        ++outstanding;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        --outstanding;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+static void test_allocator()
+{
+    using BarType = Bar<buffer>;
+
+    buffer b1 = {};
+    b1.data[0] = 1;
+    BarType bar(b1);
+
+    CountingResource counting;
+
+    // Too large for the default stack storage of Delegate<int(int)>.
+    struct Payload
+    {
+        char data[32];
+    };
+
+    // Delegate only touches the resource when the bound arguments overflow the stack storage.
+    {
+        using Delegate = sdaineka::Delegate<buffer(const buffer&)>;
+
+        std::vector<Delegate> delegates;
+        delegates.push_back(Delegate::CreateGlobal(std::allocator_arg, &counting, &add_ref_2<buffer>, b1));
+        delegates.push_back(Delegate::CreateMember(std::allocator_arg, &counting, &bar, &BarType::add_ref_2, b1));
+        delegates.push_back(Delegate::CreateMember(std::allocator_arg, &counting, static_cast<const BarType*>(&bar),
+                                                   &BarType::add_ref_2_const, b1));
+        delegates.push_back(Delegate::CreateLambda(std::allocator_arg, &counting, [](const buffer& v) { return v; }));
+        delegates.push_back(delegates[1].Clone());
+
+        assert(counting.allocations == 3);
+        assert(delegates[0].GetHeapSize() == 0);
+        assert(delegates[3].GetHeapSize() == 0);
+        assert(delegates[4](b1).data[0] == 3);
+
+        std::cout << "Delegate(memory_resource) - allocations: " << counting.allocations << ", outstanding: " << counting.outstanding
+                  << '\n';
+    }
+    assert(counting.outstanding == 0);
+
+    // SimpleHeapDelegate allocates every storage from the resource.
+    {
+        using Delegate = sdaineka::SimpleHeapDelegate<buffer(const buffer&)>;
+
+        auto lambda = [](const buffer& lhs, const buffer& rhs) { return lhs + rhs; };
+
+        std::vector<Delegate> delegates;
+        delegates.push_back(Delegate::CreateGlobal(std::allocator_arg, &counting, &add_ref_2<buffer>, b1));
+        delegates.push_back(Delegate::CreateMember(std::allocator_arg, &counting, &bar, &BarType::add_ref_2, b1));
+        delegates.push_back(Delegate::CreateLambda(std::allocator_arg, &counting, lambda, b1));
+
+        assert(counting.outstanding == 3);
+        assert(delegates[2](b1).data[0] == 2);
+    }
+    assert(counting.outstanding == 0);
+
+    // Frame arena: blocks are released in bulk once the delegates are gone.
+    {
+        using Delegate = sdaineka::Delegate<int(int)>;
+
+        std::pmr::monotonic_buffer_resource arena(4096, &counting);
+        {
+            std::vector<Delegate> delegates;
+            for (int i = 0; i < 64; i++)
+            {
+                delegates.push_back(
+                    Delegate::CreateLambda(std::allocator_arg, &arena, [pad = Payload{}, i](int v) { return v + i + pad.data[0]; }));
+            }
+            assert(delegates[63](1) == 64);
+            assert(delegates[63].GetHeapSize() == sizeof(Payload) + sizeof(int));
+        }
+        std::cout << "Delegate(monotonic_buffer_resource) - upstream blocks: " << counting.outstanding << '\n';
+        arena.release();
+    }
+    assert(counting.outstanding == 0);
+
+    // Built-in size-class pool.
+    {
+        using Delegate = sdaineka::Delegate<int(int)>;
+
+        std::vector<Delegate> delegates;
+        for (int i = 0; i < 256; i++)
+        {
+            delegates.push_back(Delegate::CreateLambda(std::allocator_arg, sdaineka::DelegatePoolResource::Get(),
+                                                       [pad = Payload{}, i](int v) { return v + i + pad.data[0]; }));
+        }
+        assert(delegates[255](1) == 256);
+        std::cout << "Delegate(DelegatePoolResource) - heapSize: " << delegates[0].GetHeapSize() << '\n';
+    }
+
+    // SimpleHeapDelegate storage comes from slabs per block size by default, blocks may be freed on any thread.
+    {
+        using Delegate = sdaineka::SimpleHeapDelegate<int(int)>;
+        sdaineka::DelegateSlabResource* slabs = sdaineka::DelegateSlabResource::Get();
+
+        struct Padding
+        {
+            char data[200];
+        };
+
+        const auto getStats = [slabs](std::size_t blockSize) {
+            for (const sdaineka::DelegateSlabResource::Stats& stats : slabs->GetStats())
+            {
+                if (stats.blockSize == blockSize)
+                {
+                    return stats;
+                }
+            }
+            return sdaineka::DelegateSlabResource::Stats{blockSize, 0, 0, 0, 0, 0, 0, 0};
+        };
+
+        std::vector<Delegate> delegates;
+        for (int i = 0; i < 1000; i++)
+        {
+            delegates.push_back(Delegate::CreateLambda([pad = Padding{}, i](int v) { return v + i + pad.data[0]; }));
+        }
+        assert(delegates[999](1) == 1000);
+
+        const std::size_t blockSize = (delegates[0].GetHeapSize() + alignof(void*) - 1) / alignof(void*) * alignof(void*);
+        slabs->Trim();
+        const sdaineka::DelegateSlabResource::Stats live = getStats(blockSize);
+        assert(live.slabs * live.blocksPerSlab - live.freeBlocks >= 1000);
+
+        std::vector<Delegate> moved(std::make_move_iterator(delegates.begin() + 500), std::make_move_iterator(delegates.end()));
+        delegates.resize(500);
+        std::thread([&moved] { moved.clear(); }).join();
+        delegates.clear();
+
+        const std::size_t released = slabs->Trim();
+        const sdaineka::DelegateSlabResource::Stats stats = getStats(blockSize);
+        assert(stats.slabs == 0 && stats.freeBlocks == 0 && released >= live.slabs);
+        assert(live.allocations >= 1000 && stats.deallocations - live.deallocations == 1000);
+
+        std::cout << "SimpleHeapDelegate(DelegateSlabResource) - block: " << blockSize << ", blocks per slab: " << stats.blocksPerSlab
+                  << ", slabs released: " << stats.slabsReleased << '\n';
+    }
+}
+
+static int memo_square_calls = 0;
+
+static int memo_square(int x)
+{
+    ++memo_square_calls;
+    return x * x;
+}
+
+static void test_memoized_delegate()
+{
+    // Repeated arguments skip the target.
+    {
+        memo_square_calls = 0;
+        sdaineka::MemoizedDelegate<int(int)> square(sdaineka::Delegate<int(int)>::CreateGlobal(&memo_square), 16);
+        assert(square.GetCapacity() == 16);
+
+        for (int round = 0; round < 3; round++)
+        {
+            for (int i = 0; i < 10; i++)
+            {
+                assert(square(i) == i * i);
+            }
+        }
+        assert(memo_square_calls == 10);
+
+        const sdaineka::MemoizedDelegateStats stats = square.GetStats();
+        assert(stats.hits == 20 && stats.misses == 10 && stats.evictions == 0 && stats.size == 10);
+
+        square.Clear();
+        assert(square.GetStats().size == 0);
+        assert(square(3) == 9);
+        assert(memo_square_calls == 11);
+    }
+
+    // Full cache: CLOCK keeps the entry that was hit and replaces the others in order.
+    {
+        memo_square_calls = 0;
+        sdaineka::MemoizedDelegate<int(int)> square(sdaineka::Delegate<int(int)>::CreateGlobal(&memo_square), 4);
+        for (int i = 0; i < 4; i++)
+        {
+            square(i);
+        }
+        square(0);
+
+        square(100);
+        assert(square.GetStats().evictions == 1);
+        assert(square.GetStats().size == 4);
+
+        const int before = memo_square_calls;
+        square(0);
+        assert(memo_square_calls == before);
+        square(1);
+        assert(memo_square_calls == before + 1);
+
+        // Many keys through a small cache keep the table consistent.
+        for (int i = 0; i < 1000; i++)
+        {
+            assert(square(i % 7) == (i % 7) * (i % 7));
+        }
+        assert(square.GetStats().size == 4);
+    }
+
+    // Several arguments, a bound target, a custom hasher and a recursive target.
+    {
+        int calls = 0;
+        sdaineka::MemoizedDelegate<std::string(const std::string&, int)> repeat(
+            sdaineka::Delegate<std::string(const std::string&, int)>::CreateLambda([&calls](const std::string& s, int n) {
+                ++calls;
+                std::string result;
+                for (int i = 0; i < n; i++)
+                {
+                    result += s;
+                }
+                return result;
+            }),
+            8);
+        assert(repeat("ab", 3) == "ababab");
+        assert(repeat(std::string("ab"), 3) == "ababab");
+        assert(repeat("ab", 2) == "abab");
+        assert(calls == 2);
+
+        struct FirstOnly
+        {
+            std::size_t operator()(const std::tuple<int, int>& key) const
+            {
+                return static_cast<std::size_t>(std::get<0>(key));
+            }
+        };
+        sdaineka::MemoizedDelegate<int(int, int), FirstOnly> sum(
+            sdaineka::Delegate<int(int, int)>::CreateLambda([](int a, int b) { return a + b; }), 8);
+        assert(sum(1, 2) == 3 && sum(1, 3) == 4 && sum(1, 2) == 3);
+        assert(sum.GetStats().hits == 1);
+
+        std::unique_ptr<sdaineka::MemoizedDelegate<std::uint64_t(int)>> fib;
+        fib = std::make_unique<sdaineka::MemoizedDelegate<std::uint64_t(int)>>(
+            sdaineka::Delegate<std::uint64_t(int)>::CreateLambda([&fib](int n) -> std::uint64_t { return n < 2 ? n : (*fib)(n - 1) + (*fib)(n - 2); }),
+            128);
+        assert((*fib)(90) == 2880067194370816120ull);
+        assert(fib->GetStats().misses == 91);
+    }
+
+    // Sharded mode called from several threads.
+    {
+        std::atomic<int> calls{0};
+        sdaineka::MemoizedDelegate<int(int)> square(sdaineka::Delegate<int(int)>::CreateLambda([&calls](int x) {
+                                                        calls.fetch_add(1, std::memory_order_relaxed);
+                                                        return x * x;
+                                                    }),
+                                                    256, 4);
+        assert(square.GetCapacity() >= 256);
+
+        std::vector<std::thread> threads;
+        std::atomic<bool> wrong{false};
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&square, &wrong, t] {
+                for (int i = 0; i < 20000; i++)
+                {
+                    const int x = (i * 7 + t) % 512;
+                    if (square(x) != x * x)
+                    {
+                        wrong = true;
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        assert(!wrong);
+        const sdaineka::MemoizedDelegateStats stats = square.GetStats();
+        assert(stats.hits + stats.misses == 80000);
+        assert(stats.misses == static_cast<std::uint64_t>(calls.load()));
+        assert(stats.size <= square.GetCapacity());
+    }
+}
+
+static int pipeline_parse(const std::string& text)
+{
+    return std::stoi(text);
+}
+
+static void test_pipeline()
+{
+    // Compile time stages: a global function, a lambda and a stateful sink.
+    {
+        int sum = 0;
+        auto pipeline = sdaineka::Compose<void(const std::string&)>(sdaineka::StaticStage<&pipeline_parse>(),
+                                                                    [](int x) { return x * 3; }, [&sum](int x) { sum += x; });
+        pipeline("4");
+        pipeline("10");
+        assert(sum == 42);
+    }
+
+    // Filtering stages end the call on an empty std::optional.
+    {
+        std::vector<int> seen;
+        auto evens = sdaineka::Compose<void(int)>([](int x) { return x % 2 == 0 ? std::optional<int>(x) : std::nullopt; },
+                                                  [](int x) { return x + 1; }, [&seen](int x) { seen.push_back(x); });
+        for (int i = 0; i < 6; i++)
+        {
+            evens(i);
+        }
+        assert((seen == std::vector<int>{1, 3, 5}));
+
+        auto half = sdaineka::Compose<std::optional<int>(int)>(
+            [](int x) { return x % 2 == 0 ? std::optional<int>(x) : std::nullopt; }, [](int x) { return std::optional<int>(x / 2); });
+        assert(half(8) == 4);
+        assert(!half(7));
+    }
+
+    // Intermediate results are moved, so move only values pass through.
+    {
+        auto pipeline = sdaineka::Compose<int(int)>([](int x) { return std::make_unique<int>(x); },
+                                                    [](std::unique_ptr<int> p) {
+                                                        *p *= 2;
+                                                        return p;
+                                                    },
+                                                    [](std::unique_ptr<int>&& p) { return *p + 1; });
+        assert(pipeline(20) == 41);
+
+        std::string moved;
+        auto strings = sdaineka::Compose<std::size_t(std::string)>([](std::string s) { return s + s; },
+                                                                  [&moved](std::string&& s) {
+                                                                      moved = std::move(s);
+                                                                      return moved.size();
+                                                                  });
+        assert(strings("abc") == 6 && moved == "abcabc");
+    }
+
+    // Runtime fallback: existing delegates as stages.
+    {
+        auto parse = sdaineka::Delegate<int(const std::string&)>::CreateGlobal(&pipeline_parse);
+        auto twice = sdaineka::Delegate<int(int)>::CreateLambda([](int x) { return 2 * x; });
+        auto pipeline = sdaineka::Compose<int(const std::string&)>(std::move(parse), std::move(twice), [](int x) { return x - 1; });
+        assert(pipeline("21") == 41);
+
+        auto nested = sdaineka::Compose<int(const std::string&)>(std::move(pipeline), sdaineka::StaticStage<&add<int>>());
+        assert(nested("5") == 9);
+    }
+}
+
+static void test_coalescing_dispatcher()
+{
+    using Dispatcher = sdaineka::CoalescingDispatcher<int, void(int)>;
+
+    // The last value wins and keys are delivered once, in the order of their first post.
+    {
+        std::vector<std::pair<int, int>> delivered;
+        Dispatcher dispatcher(Dispatcher::Handler::CreateLambda([&delivered](const int& key, int value) { delivered.emplace_back(key, value); }));
+
+        assert(dispatcher.Post(7, 1));
+        assert(dispatcher.Post(3, 2));
+        assert(!dispatcher.Post(7, 3));
+        for (int i = 0; i < 100; i++)
+        {
+            dispatcher.Post(i % 10, i);
+        }
+        assert(dispatcher.Size() == 10);
+        assert(dispatcher.IsPending(7) && !dispatcher.IsPending(10));
+
+        assert(dispatcher.Flush() == 10);
+        assert(delivered.size() == 10);
+        assert((delivered[0] == std::pair<int, int>(7, 97)));
+        assert((delivered[1] == std::pair<int, int>(3, 93)));
+        assert(dispatcher.Empty() && !dispatcher.IsPending(7));
+        assert(dispatcher.GetCoalescedCount() == 93 && dispatcher.GetDeliveredCount() == 10);
+
+        assert(dispatcher.Flush() == 0);
+
+        dispatcher.Post(1, 1);
+        dispatcher.Clear();
+        assert(dispatcher.Flush() == 0);
+    }
+
+    // A merge delegate folds the calls together.
+    {
+        using Summing = sdaineka::CoalescingDispatcher<std::string, void(int, const std::string&)>;
+        std::vector<std::string> delivered;
+        Summing dispatcher(Summing::Handler::CreateLambda([&delivered](const std::string& key, int count, const std::string& last) {
+                               delivered.push_back(key + ":" + std::to_string(count) + ":" + last);
+                           }),
+                           Summing::Merge::CreateLambda([](int& count, std::string& last, int incoming, const std::string& text) {
+                               count += incoming;
+                               last = text;
+                           }));
+
+        dispatcher.Post("a", 1, "x");
+        dispatcher.Post("b", 5, "y");
+        dispatcher.Post("a", 2, "z");
+        assert(dispatcher.Flush() == 2);
+        assert((delivered == std::vector<std::string>{"a:3:z", "b:5:y"}));
+    }
+
+    // Handlers may post, the calls go to the next flush; the table grows past its initial size.
+    {
+        int calls = 0;
+        Dispatcher* self = nullptr;
+        Dispatcher dispatcher(Dispatcher::Handler::CreateLambda([&](const int& key, int value) {
+            ++calls;
+            if (value > 0)
+            {
+                self->Post(key, value - 1);
+            }
+        }));
+        self = &dispatcher;
+
+        for (int key = 0; key < 1000; key++)
+        {
+            dispatcher.Post(key, 2);
+        }
+        assert(dispatcher.Flush() == 1000);
+        assert(dispatcher.Size() == 1000);
+        assert(dispatcher.Flush() == 1000);
+        assert(dispatcher.Flush() == 1000);
+        assert(dispatcher.Flush() == 0);
+        assert(calls == 3000);
+    }
+
+    // Debounce: a key is delivered once it was quiet for the window, or after the maximum wait.
+    {
+        std::vector<int> delivered;
+        Dispatcher dispatcher(Dispatcher::Handler::CreateLambda([&delivered](const int& key, int) { delivered.push_back(key); }));
+        dispatcher.SetDebounce(3, 10);
+
+        std::uint64_t now = 0;
+        dispatcher.Post(1, 0);
+        dispatcher.Post(2, 0);
+        for (now = 1; now <= 12; now++)
+        {
+            // Key 2 keeps being posted, key 1 goes quiet.
+            dispatcher.Post(2, 0);
+            dispatcher.Flush(now);
+            if (now == 3)
+            {
+                assert((delivered == std::vector<int>{1}));
+            }
+        }
+        assert((delivered == std::vector<int>{1, 2}));
+        assert(dispatcher.IsPending(2));
+    }
+}
+
+enum class TableOp : std::uint8_t
+{
+    Push,
+    Add,
+    Mul,
+    Halt,
+    Nop,
+};
+
+struct TableVm
+{
+    void Push(int value)
+    {
+        stack.push_back(value);
+    }
+
+    void Add(int)
+    {
+        const int rhs = stack.back();
+        stack.pop_back();
+        stack.back() += rhs;
+    }
+
+    void Mul(int) const
+    {
+        ++constCalls;
+    }
+
+    std::vector<int> stack;
+    mutable int constCalls = 0;
+    bool halted = false;
+};
+
+static void table_halt(TableVm& vm, int)
+{
+    vm.halted = true;
+}
+
+static int table_double(int x)
+{
+    return 2 * x;
+}
+
+static long table_negate(long x)
+{
+    return -x;
+}
+
+template<int I>
+static int table_index(int x)
+{
+    return I + x;
+}
+
+constexpr std::uint32_t table_sparse_key(int i)
+{
+    return static_cast<std::uint32_t>(i) * 0x9e3779b1u + 17u;
+}
+
+template<int... Is>
+auto make_sparse_table(std::integer_sequence<int, Is...>)
+    -> sdaineka::DelegateTable<std::uint32_t, int(int), sdaineka::DelegateTableEntry<table_sparse_key(Is), &table_index<Is>>...>;
+
+static void test_delegate_table()
+{
+    // Dense enum keys with free and member function targets.
+    {
+        using OpTable = sdaineka::DelegateTable<TableOp, void(TableVm&, int), sdaineka::DelegateTableEntry<TableOp::Push, &TableVm::Push>,
+                                                sdaineka::DelegateTableEntry<TableOp::Add, &TableVm::Add>,
+                                                sdaineka::DelegateTableEntry<TableOp::Mul, &TableVm::Mul>,
+                                                sdaineka::DelegateTableEntry<TableOp::Halt, &table_halt>>;
+
+        static_assert(OpTable::Size() == 4);
+        static_assert(OpTable::Contains(TableOp::Halt));
+        static_assert(!OpTable::Contains(TableOp::Nop));
+        static_assert(OpTable::Find(TableOp::Halt) == &table_halt);
+
+        TableVm vm;
+        OpTable::Invoke(TableOp::Push, vm, 40);
+        OpTable::Invoke(TableOp::Push, vm, 2);
+        const OpTable table;
+        table(TableOp::Add, vm, 0);
+        table(TableOp::Mul, vm, 0);
+        assert((vm.stack == std::vector<int>{42}));
+        assert(vm.constCalls == 1);
+
+        const bool halted = OpTable::TryInvoke(TableOp::Halt, vm, 0);
+        assert(halted && vm.halted);
+        const bool nop = OpTable::TryInvoke(TableOp::Nop, vm, 0);
+        assert(!nop);
+
+        auto push = OpTable::GetDelegate(TableOp::Push);
+        push(vm, 7);
+        assert(vm.stack.back() == 7);
+        assert(!OpTable::GetDelegate(TableOp::Nop));
+    }
+
+    // Sparse integer keys are remapped to a dense table; keys next to them are not found.
+    {
+        using IdTable = sdaineka::DelegateTable<std::uint32_t, long(int), sdaineka::DelegateTableEntry<0x1001u, &table_double>,
+                                                sdaineka::DelegateTableEntry<0x2002u, &table_negate>,
+                                                sdaineka::DelegateTableEntry<0x80000000u, &add<long>>,
+                                                sdaineka::DelegateTableEntry<7u, &table_double>>;
+
+        static_assert(IdTable::Contains(0x1001u) && IdTable::Contains(0x2002u) && IdTable::Contains(0x80000000u) && IdTable::Contains(7u));
+        assert(IdTable::Invoke(0x1001u, 21) == 42);
+        assert(IdTable::Invoke(0x2002u, 5) == -5);
+        assert(IdTable::Invoke(0x80000000u, 9) == 9);
+        assert(IdTable::Invoke(7u, 4) == 8);
+
+        for (std::uint32_t key = 0; key < 0x3000; key++)
+        {
+            assert(IdTable::Contains(key) == (key == 0x1001u || key == 0x2002u || key == 7u));
+        }
+        assert(!IdTable::Contains(0xffffffffu));
+    }
+
+    // Hundreds of sparse keys stay within the constant evaluation limits and at most 2.5 slots per key.
+    {
+        using LargeTable = decltype(make_sparse_table(std::make_integer_sequence<int, 256>()));
+        static_assert(LargeTable::Size() == 256 && LargeTable::GetSlotCount() <= 640);
+        static_assert(LargeTable::Contains(table_sparse_key(255)) && !LargeTable::Contains(table_sparse_key(256)));
+
+        for (int i = 0; i < 256; i++)
+        {
+            assert(LargeTable::Invoke(table_sparse_key(i), 1000) == i + 1000);
+            assert(!LargeTable::Contains(table_sparse_key(i) + 1));
+        }
+    }
+
+    // Negative keys.
+    {
+        using SignedTable = sdaineka::DelegateTable<int, int(int), sdaineka::DelegateTableEntry<-2, &table_double>,
+                                                    sdaineka::DelegateTableEntry<3, &add<int>>>;
+        assert(SignedTable::Invoke(-2, 5) == 10);
+        assert(SignedTable::Invoke(3, 5) == 5);
+        assert(!SignedTable::Contains(0) && !SignedTable::Contains(-3));
+    }
+}
+
+#if SDAINEKA_DELEGATE_COROUTINES
+static sdaineka::Task<int> co_square(int x)
+{
+    co_return x * x;
+}
+
+static sdaineka::Task<int> co_sum_of_squares(int a, int b)
+{
+    const int x = co_await co_square(a);
+    const int y = co_await co_square(b);
+    co_return x + y;
+}
+
+static sdaineka::Task<void> co_throw()
+{
+    throw std::runtime_error("co_throw");
+    co_return;
+}
+
+static void test_coroutines()
+{
+    // Tasks are lazy, awaiting one runs it and continues with its result.
+    {
+        sdaineka::Task<int> task = co_sum_of_squares(3, 4);
+        assert(task && !task.IsDone());
+        task.Start();
+        assert(task.IsDone());
+        assert(task.GetResult() == 25);
+
+        sdaineka::Task<void> failing = co_throw();
+        failing.Start();
+        bool caught = false;
+        try
+        {
+            failing.GetResult();
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        assert(caught);
+    }
+
+    // Awaiting an event: subscribers run first, then the waiters in order; awaiting again waits for the next broadcast.
+    {
+        sdaineka::AsyncEvent<void(int)> event;
+        std::vector<int> log;
+        event.Subscribe(sdaineka::Delegate<void(int)>::CreateLambda([&log](int value) { log.push_back(value); }));
+
+        auto waiter = [&](int id) -> sdaineka::Task<void>
+        {
+            const int first = co_await event;
+            log.push_back(id * 100 + first);
+            const int second = co_await event;
+            log.push_back(id * 100 + second);
+        };
+
+        sdaineka::Task<void> a = waiter(1);
+        sdaineka::Task<void> b = waiter(2);
+        a.Start();
+        b.Start();
+        assert(event.HasWaiters());
+
+        event.Broadcast(5);
+        assert((log == std::vector<int>{5, 105, 205}));
+        assert(!a.IsDone() && !b.IsDone());
+
+        event.Broadcast(6);
+        assert((log == std::vector<int>{5, 105, 205, 6, 106, 206}));
+        assert(a.IsDone() && b.IsDone());
+        assert(!event.HasWaiters());
+    }
+
+    // Several arguments arrive as a tuple, none as void; a task destroyed while waiting leaves the event.
+    {
+        sdaineka::AsyncEvent<void(int, const std::string&)> pairs;
+        sdaineka::AsyncEvent<void()> signal;
+        std::string received;
+
+        auto pairWaiter = [&]() -> sdaineka::Task<void>
+        {
+            auto [count, text] = co_await pairs;
+            received = std::to_string(count) + text;
+        };
+        auto signalWaiter = [&](int& fired) -> sdaineka::Task<void>
+        {
+            co_await signal;
+            ++fired;
+        };
+
+        sdaineka::Task<void> pairTask = pairWaiter();
+        pairTask.Start();
+        pairs.Broadcast(3, "x");
+        assert(pairTask.IsDone() && received == "3x");
+
+        int fired = 0;
+        std::optional<sdaineka::Task<void>> cancelled(signalWaiter(fired));
+        sdaineka::Task<void> kept = signalWaiter(fired);
+        cancelled->Start();
+        kept.Start();
+        cancelled.reset();
+        signal.Broadcast();
+        assert(fired == 1 && kept.IsDone());
+        assert(!signal.HasWaiters());
+    }
+
+    // A resumed waiter destroying another waiter of the same broadcast: the destroyed one is not resumed.
+    {
+        sdaineka::AsyncEvent<void(int)> event;
+        std::optional<sdaineka::Task<void>> second;
+        std::vector<int> log;
+
+        auto destroyer = [&]() -> sdaineka::Task<void>
+        {
+            log.push_back(co_await event);
+            second.reset();
+        };
+        auto victim = [&]() -> sdaineka::Task<void> { log.push_back(-co_await event); };
+        auto third = [&]() -> sdaineka::Task<void> { log.push_back(10 * co_await event); };
+
+        sdaineka::Task<void> first = destroyer();
+        second.emplace(victim());
+        sdaineka::Task<void> last = third();
+        first.Start();
+        second->Start();
+        last.Start();
+
+        event.Broadcast(4);
+        assert((log == std::vector<int>{4, 40}));
+        assert(first.IsDone() && last.IsDone() && !second);
+        assert(!event.HasWaiters());
+    }
+
+    // AsyncDelegate over a coroutine and over callback style operations, completing inline or later.
+    {
+        sdaineka::AsyncDelegate<sdaineka::Task<int>(int)> coroutine(
+            sdaineka::Delegate<sdaineka::Task<int>(int)>::CreateGlobal(&co_square));
+
+        using Callback = sdaineka::AsyncDelegate<sdaineka::Task<int>(int)>;
+        Callback inlineCallback(Callback::CallbackType::CreateLambda([](int x, Callback::CompletionType&& done) { done(x + 1); }));
+
+        Callback::CompletionType pending;
+        Callback deferredCallback(Callback::CallbackType::CreateLambda([&pending](int x, Callback::CompletionType&& done)
+                                                                       {
+                                                                           assert(x == 7);
+                                                                           pending = std::move(done);
+                                                                       }));
+
+        using VoidCallback = sdaineka::AsyncDelegate<sdaineka::Task<void>()>;
+        VoidCallback::CompletionType pendingVoid;
+        VoidCallback voidCallback(VoidCallback::CallbackType::CreateLambda([&pendingVoid](VoidCallback::CompletionType&& done)
+                                                                           { pendingVoid = std::move(done); }));
+
+        std::vector<int> results;
+        auto chain = [&]() -> sdaineka::Task<void>
+        {
+            results.push_back(co_await coroutine(6));
+            results.push_back(co_await inlineCallback(1));
+            results.push_back(co_await deferredCallback(7));
+            co_await voidCallback();
+            results.push_back(-1);
+        };
+
+        sdaineka::Task<void> task = chain();
+        task.Start();
+        assert((results == std::vector<int>{36, 2}));
+        assert(pending && !task.IsDone());
+
+        pending(70);
+        assert((results == std::vector<int>{36, 2, 70}));
+        assert(pendingVoid && !task.IsDone());
+
+        pendingVoid();
+        assert((results == std::vector<int>{36, 2, 70, -1}));
+        assert(task.IsDone());
+    }
+
+    // Arguments passed by reference are copied into the task, which may start after the caller's temporaries are gone;
+    // non-const references still reach the operation.
+    {
+        using Measure = sdaineka::AsyncDelegate<sdaineka::Task<std::size_t>(const std::string&, int&)>;
+        const Measure measure(Measure::CallbackType::CreateLambda([](const std::string& text, int& calls, Measure::CompletionType&& done)
+                                                                  {
+                                                                      ++calls;
+                                                                      done(text.size());
+                                                                  }));
+
+        int calls = 0;
+        std::size_t size = 0;
+        sdaineka::Task<std::size_t> pending = measure(std::string(100, 'x'), calls);
+        auto run = [&]() -> sdaineka::Task<void> { size = co_await std::move(pending); };
+        sdaineka::Task<void> task = run();
+        task.Start();
+        assert(task.IsDone() && size == 100 && calls == 1);
+    }
+
+    // Completion from another thread resumes the coroutine there.
+    {
+        using Callback = sdaineka::AsyncDelegate<sdaineka::Task<int>(int)>;
+        std::thread worker;
+        Callback threaded(Callback::CallbackType::CreateLambda([&worker](int x, Callback::CompletionType&& done)
+                                                               { worker = std::thread([x, done = std::move(done)]() { done(x * 2); }); }));
+
+        std::atomic<int> result{0};
+        auto run = [&]() -> sdaineka::Task<void> { result = co_await threaded(21); };
+        sdaineka::Task<void> task = run();
+        task.Start();
+        worker.join();
+        assert(result == 42);
+        assert(task.IsDone());
+    }
+
+    // ResumeOn hands the continuation to an executor as a Delegate<void()>.
+    {
+        std::vector<sdaineka::Delegate<void()>> queue;
+        const sdaineka::DelegateExecutor executor =
+            sdaineka::DelegateExecutor::CreateLambda([&queue](sdaineka::Delegate<void()>&& resume) { queue.push_back(std::move(resume)); });
+
+        int step = 0;
+        auto hop = [&]() -> sdaineka::Task<void>
+        {
+            step = 1;
+            co_await sdaineka::ResumeOn(executor);
+            step = 2;
+        };
+
+        sdaineka::Task<void> task = hop();
+        task.Start();
+        assert(step == 1 && queue.size() == 1);
+        queue.front()();
+        assert(step == 2 && task.IsDone());
+    }
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    std::cout << "test_add(int)\n";
+    test_add_value(5, 5, 5);
+
+    std::cout << "test_add(std::string)\n";
+    test_add_ref_value(std::string("hello"), std::string("stan"), std::string("longlonglonglonglonglonglonglonglonglonglongstring"));
+
+    
+    buffer b1, b2, b3;
+    for (int i = 0; i < buffer::kSize; i++)
+    {
+        b1.data[i] = (i + 1) * 5;
+        b2.data[i] = (i + 7) * 7;
+        b3.data[i] = (i + 11) * 11;
+    }
+
+    std::cout << "test_add(POD buffer)\n";
+    test_add_ref_value(b1, b2, b3);
+
+    std::cout << "test_static_target(int)\n";
+    test_static_target(5, 5, 5);
+
+    std::cout << "test_delegate_ref\n";
+    test_delegate_ref();
+
+    std::cout << "test_invoke_batch\n";
+    test_invoke_batch<sdaineka::Delegate<int(int, int)>>("Delegate");
+    test_invoke_batch<sdaineka::SimpleHeapDelegate<int(int, int)>>("SimpleHeapDelegate");
+
+    std::cout << "test_timer_wheel\n";
+    test_timer_wheel();
+
+#if defined(__linux__)
+    std::cout << "test_event_reactor\n";
+    test_event_reactor();
+#endif
+
+    std::cout << "test_inplace_delegate\n";
+    test_inplace_delegate();
+
+    std::cout << "test_multicast_delegate\n";
+    test_multicast_delegate();
+
+    std::cout << "test_concurrent_multicast_delegate\n";
+    test_concurrent_multicast_delegate();
+
+    std::cout << "test_atomic_delegate\n";
+    test_atomic_delegate();
+
+    std::cout << "test_delegate_queue\n";
+    test_delegate_queue();
+
+    std::cout << "test_task_scheduler\n";
+    test_task_scheduler();
+
+    std::cout << "test_delegate_vector\n";
+    test_delegate_vector();
+
+#if SDAINEKA_DELEGATE_INSTRUMENTATION
+    std::cout << "test_instrumentation\n";
+    test_instrumentation();
+#endif
+
+#if SDAINEKA_DELEGATE_TELEMETRY
+    std::cout << "test_storage_telemetry\n";
+    test_storage_telemetry();
+#endif
+
+    std::cout << "test_lifetime\n";
+    test_lifetime();
+
+    std::cout << "test_invoke_once\n";
+    test_invoke_once();
+
+    std::cout << "test_allocator\n";
+    test_allocator();
+
+    std::cout << "test_memoized_delegate\n";
+    test_memoized_delegate();
+
+    std::cout << "test_pipeline\n";
+    test_pipeline();
+
+    std::cout << "test_coalescing_dispatcher\n";
+    test_coalescing_dispatcher();
+
+    std::cout << "test_delegate_table\n";
+    test_delegate_table();
+
+#if SDAINEKA_DELEGATE_COROUTINES
+    std::cout << "test_coroutines\n";
+    test_coroutines();
+#endif
 
     return 0;
 }
\ No newline at end of file